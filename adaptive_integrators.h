@@ -0,0 +1,1313 @@
+#pragma once
+#ifndef ADAPTIVE_INTEGRATORS_H
+#define ADAPTIVE_INTEGRATORS_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "numerical_integration_methods.h"
+
+/*  Adaptive step-size integrators.
+
+	Same right-hand side interface as the fixed-step steppers
+	(numerical_integration_methods.h): any callable
+
+		f(double t, std::span<const double> x, std::span<double> dx)
+
+	The step is chosen so the local error estimate of every state stays within
+	abs_tol[i] + rel_tol[i] * |x[i]|, which lets one tolerance set cover states
+	of very different scales (metres of position against rad/s of rates).
+	interpolate(t, x_out) is the stepper's own dense output over the last
+	accepted step; integrate_adaptive_sampled() uses it for an output clock
+	independent of the steps taken.
+*/
+
+// Tolerances and step limits of an adaptive stepper. abs_tol and rel_tol hold
+// either one value per state or a single value used for every state.
+struct StepSizeControl
+{
+	std::vector<double> abs_tol = { 1e-6 };
+	std::vector<double> rel_tol = { 1e-6 };
+	double h_min_s = 1e-10;
+	double h_max_s = 1.0;
+	double h_initial_s = 0.0;  // 0 picks the first step from the initial derivative
+	double safety = 0.9;
+};
+
+namespace integrator_detail
+{
+	// Expands a one-value tolerance to num_states entries
+	inline std::vector<double> per_state(const std::vector<double>& tol, std::size_t num_states, const char* name)
+	{
+		if (tol.size() == 1)
+		{
+			return std::vector<double>(num_states, tol[0]);
+		}
+		if (tol.size() != num_states)
+		{
+			throw std::invalid_argument(std::string("StepSizeControl: ") + name + " needs one value or one per state");
+		}
+		return tol;
+	}
+}
+
+// Dormand-Prince 5(4) (the ode45 / DOPRI5 pair) with first-same-as-last: the
+// derivative at the end of an accepted step is the first stage of the next,
+// so an accepted step costs six RHS evaluations. The step size follows the PI
+// controller of Hairer & Wanner (DOPRI5). Steps must be consecutive on one
+// trajectory; call reset() after changing the state from outside.
+template <class F>
+class DormandPrince45Stepper
+{
+public:
+	DormandPrince45Stepper(F f, std::size_t num_states, const StepSizeControl& control = StepSizeControl())
+		: f(std::move(f)), control(control),
+		abs_tol(integrator_detail::per_state(control.abs_tol, num_states, "abs_tol")),
+		rel_tol(integrator_detail::per_state(control.rel_tol, num_states, "rel_tol")),
+		x_stage(num_states), x_new(num_states),
+		k1(num_states), k2(num_states), k3(num_states), k4(num_states), k5(num_states), k6(num_states), k7(num_states),
+		last(num_states), h_s(control.h_initial_s)
+	{
+		if (control.h_min_s <= 0.0 || control.h_max_s < control.h_min_s)
+		{
+			throw std::invalid_argument("StepSizeControl: need 0 < h_min_s <= h_max_s");
+		}
+	}
+
+	std::size_t size() const { return x_stage.size(); }
+	std::size_t rhs_evals() const { return num_evals; }
+	std::size_t steps() const { return num_accepted; }
+	std::size_t accepted_steps() const { return num_accepted; }
+	std::size_t rejected_steps() const { return num_rejected; }
+
+	// Step size the next attempt will start from
+	double step_size() const { return h_s; }
+
+	// Drop the stored first stage, e.g. after the state was changed from outside
+	void reset() { have_k1 = false; }
+
+	double step(double t, std::span<double> x, double t_max)
+	{
+		/*  Arguments:
+
+			t - time of x [s]
+
+			x - state, advanced in place by one accepted step
+
+			t_max - the step does not go past this time [s]
+
+			Returns the size of the accepted step [s]. Rejected attempts are
+			retried with a smaller step; throws std::runtime_error if the step
+			would have to drop below h_min_s.
+		*/
+
+		integrator_detail::check_size(x, x_stage.size());
+		std::size_t nx = x.size();
+
+		if (!have_k1)
+		{
+			f(t, std::span<const double>(x), std::span<double>(k1));
+			++num_evals;
+			have_k1 = true;
+		}
+		if (h_s <= 0.0)
+		{
+			h_s = initial_step(t, x);
+		}
+
+		bool rejected = false;
+
+		while (true)
+		{
+			double h_try = std::min(h_s, t_max - t);
+			bool clipped = h_try < h_s;
+
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				x_stage[j] = x[j] + h_try * (a21 * k1[j]);
+			}
+			f(t + c2 * h_try, std::span<const double>(x_stage), std::span<double>(k2));
+
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				x_stage[j] = x[j] + h_try * (a31 * k1[j] + a32 * k2[j]);
+			}
+			f(t + c3 * h_try, std::span<const double>(x_stage), std::span<double>(k3));
+
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				x_stage[j] = x[j] + h_try * (a41 * k1[j] + a42 * k2[j] + a43 * k3[j]);
+			}
+			f(t + c4 * h_try, std::span<const double>(x_stage), std::span<double>(k4));
+
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				x_stage[j] = x[j] + h_try * (a51 * k1[j] + a52 * k2[j] + a53 * k3[j] + a54 * k4[j]);
+			}
+			f(t + c5 * h_try, std::span<const double>(x_stage), std::span<double>(k5));
+
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				x_stage[j] = x[j] + h_try * (a61 * k1[j] + a62 * k2[j] + a63 * k3[j] + a64 * k4[j] + a65 * k5[j]);
+			}
+			f(t + h_try, std::span<const double>(x_stage), std::span<double>(k6));
+
+			// 5th order solution; its derivative is the FSAL stage
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				x_new[j] = x[j] + h_try * (a71 * k1[j] + a73 * k3[j] + a74 * k4[j] + a75 * k5[j] + a76 * k6[j]);
+			}
+			f(t + h_try, std::span<const double>(x_new), std::span<double>(k7));
+			num_evals += 6;
+
+			// RMS of the embedded error estimate, scaled by the per-state tolerance
+			double sum = 0.0;
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				double error = h_try * (e1 * k1[j] + e3 * k3[j] + e4 * k4[j] + e5 * k5[j] + e6 * k6[j] + e7 * k7[j]);
+				double scale = abs_tol[j] + rel_tol[j] * std::max(std::abs(x[j]), std::abs(x_new[j]));
+				sum += (error / scale) * (error / scale);
+			}
+			double err = std::sqrt(sum / static_cast<double>(nx));
+
+			if (err <= 1.0)
+			{
+				// PI control: the previous error damps the step size changes
+				double fac11 = std::pow(err, expo1);
+				double fac = fac11 / std::pow(err_prev, beta) / control.safety;
+				fac = std::clamp(fac, 1.0 / max_growth, 1.0 / min_shrink);
+				double h_new = h_try / fac;
+				if (rejected)
+				{
+					h_new = std::min(h_new, h_try);
+				}
+
+				// A step shortened to land on t_max says nothing about the step size
+				h_s = std::clamp(clipped ? std::max(h_new, h_s) : h_new, control.h_min_s, control.h_max_s);
+				err_prev = std::max(err, 1e-4);
+
+				last.begin(t, x, h_try);
+				last.end(x_new);
+
+				std::copy(x_new.begin(), x_new.end(), x.begin());
+				std::swap(k1, k7);
+				integrator_detail::renormalize(x);
+
+				++num_accepted;
+				return h_try;
+			}
+
+			++num_rejected;
+			rejected = true;
+
+			double shrink = std::isfinite(err) ? 1.0 / std::min(1.0 / min_shrink, std::pow(err, expo1) / control.safety) : min_shrink;
+			h_s = h_try * shrink;
+			if (h_s < control.h_min_s)
+			{
+				throw std::runtime_error("DormandPrince45Stepper: step size fell below h_min_s");
+			}
+		}
+	}
+
+	// State at time t within the last accepted step from the 4th order
+	// continuous extension of Dormand-Prince (Hairer's DOPRI5 dense output)
+	void interpolate(double t, std::span<double> x_out) const
+	{
+		double theta = last.theta(t);
+		double theta1 = 1.0 - theta;
+		double h = last.h_s;
+
+		// After the FSAL swap k7 holds the step's first stage and k1 its last
+		for (std::size_t j = 0; j < x_out.size(); ++j)
+		{
+			double x_diff = last.x_end[j] - last.x_start[j];
+			double bspl = h * k7[j] - x_diff;
+			double r4 = x_diff - h * k1[j] - bspl;
+			double r5 = h * (d1 * k7[j] + d3 * k3[j] + d4 * k4[j] + d5 * k5[j] + d6 * k6[j] + d7 * k1[j]);
+			x_out[j] = last.x_start[j] + theta * (x_diff + theta1 * (bspl + theta * (r4 + theta1 * r5)));
+		}
+		integrator_detail::renormalize(x_out);
+	}
+
+	// Saves or restores the stages, the next step size and the controller's
+	// previous error (see integrator_checkpoint.h). The StepSizeControl is not
+	// saved; build the stepper with the same one.
+	template <class Archive>
+	void checkpoint(Archive& archive)
+	{
+		archive(k1, k2, k3, k4, k5, k6, k7);
+		last.checkpoint(archive);
+		archive(h_s, err_prev, have_k1, num_evals, num_accepted, num_rejected);
+	}
+
+	integrator_detail::StepperTag checkpoint_tag() const { return { "DormandPrince45", 5 }; }
+
+private:
+	// Hairer & Wanner's starting step: an explicit Euler probe estimates the
+	// second derivative, and the step makes a 5th order error of 0.01 (Solving
+	// ODEs I, II.4). k1 must hold f(t, x).
+	double initial_step(double t, std::span<const double> x)
+	{
+		std::size_t nx = x.size();
+
+		double d0 = 0.0;
+		double d1 = 0.0;
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			double scale = abs_tol[j] + rel_tol[j] * std::abs(x[j]);
+			d0 += (x[j] / scale) * (x[j] / scale);
+			d1 += (k1[j] / scale) * (k1[j] / scale);
+		}
+		d0 = std::sqrt(d0 / static_cast<double>(nx));
+		d1 = std::sqrt(d1 / static_cast<double>(nx));
+
+		double h0 = d0 < 1e-5 || d1 < 1e-5 ? 1e-6 : 0.01 * d0 / d1;
+		h0 = std::min(h0, control.h_max_s);
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			x_stage[j] = x[j] + h0 * k1[j];
+		}
+		f(t + h0, std::span<const double>(x_stage), std::span<double>(k2));
+		++num_evals;
+
+		double d2 = 0.0;
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			double scale = abs_tol[j] + rel_tol[j] * std::abs(x[j]);
+			d2 += ((k2[j] - k1[j]) / scale) * ((k2[j] - k1[j]) / scale);
+		}
+		d2 = std::sqrt(d2 / static_cast<double>(nx)) / h0;
+
+		double d_max = std::max(d1, d2);
+		double h1 = d_max <= 1e-15 ? std::max(1e-6, h0 * 1e-3) : std::pow(0.01 / d_max, 0.2);
+
+		return std::clamp(std::min(100.0 * h0, h1), control.h_min_s, control.h_max_s);
+	}
+
+	// Dormand-Prince tableau
+	static constexpr double c2 = 1.0 / 5.0, c3 = 3.0 / 10.0, c4 = 4.0 / 5.0, c5 = 8.0 / 9.0;
+	static constexpr double a21 = 1.0 / 5.0;
+	static constexpr double a31 = 3.0 / 40.0, a32 = 9.0 / 40.0;
+	static constexpr double a41 = 44.0 / 45.0, a42 = -56.0 / 15.0, a43 = 32.0 / 9.0;
+	static constexpr double a51 = 19372.0 / 6561.0, a52 = -25360.0 / 2187.0, a53 = 64448.0 / 6561.0, a54 = -212.0 / 729.0;
+	static constexpr double a61 = 9017.0 / 3168.0, a62 = -355.0 / 33.0, a63 = 46732.0 / 5247.0, a64 = 49.0 / 176.0, a65 = -5103.0 / 18656.0;
+	static constexpr double a71 = 35.0 / 384.0, a73 = 500.0 / 1113.0, a74 = 125.0 / 192.0, a75 = -2187.0 / 6784.0, a76 = 11.0 / 84.0;
+
+	// 5th minus 4th order weights, for the error estimate
+	static constexpr double e1 = 71.0 / 57600.0, e3 = -71.0 / 16695.0, e4 = 71.0 / 1920.0, e5 = -17253.0 / 339200.0,
+		e6 = 22.0 / 525.0, e7 = -1.0 / 40.0;
+
+	// Dense output weights
+	static constexpr double d1 = -12715105075.0 / 11282082432.0, d3 = 87487479700.0 / 32700410799.0,
+		d4 = -10690763975.0 / 1880347072.0, d5 = 701980252875.0 / 199316789632.0, d6 = -1453857185.0 / 822651844.0,
+		d7 = 69997945.0 / 29380423.0;
+
+	// PI controller constants of DOPRI5
+	static constexpr double beta = 0.04;
+	static constexpr double expo1 = 0.2 - beta * 0.75;
+	static constexpr double max_growth = 10.0;
+	static constexpr double min_shrink = 0.2;
+
+	F f;
+	StepSizeControl control;
+	std::vector<double> abs_tol, rel_tol;
+	std::vector<double> x_stage, x_new;
+	std::vector<double> k1, k2, k3, k4, k5, k6, k7;
+	integrator_detail::LastStep last;
+	double h_s;
+	double err_prev = 1e-4;
+	bool have_k1 = false;
+	std::size_t num_evals = 0;
+	std::size_t num_accepted = 0;
+	std::size_t num_rejected = 0;
+};
+
+namespace integrator_detail
+{
+	// In-place LU factorization with partial pivoting of the n x n row-major A.
+	// Returns false if A is singular.
+	inline bool lu_factor(std::span<double> A, std::size_t n, std::span<std::size_t> pivot)
+	{
+		for (std::size_t k = 0; k < n; ++k)
+		{
+			std::size_t p = k;
+			for (std::size_t i = k + 1; i < n; ++i)
+			{
+				if (std::abs(A[i * n + k]) > std::abs(A[p * n + k]))
+				{
+					p = i;
+				}
+			}
+			pivot[k] = p;
+
+			if (A[p * n + k] == 0.0)
+			{
+				return false;
+			}
+			if (p != k)
+			{
+				for (std::size_t j = 0; j < n; ++j)
+				{
+					std::swap(A[k * n + j], A[p * n + j]);
+				}
+			}
+
+			double inv_pivot = 1.0 / A[k * n + k];
+			for (std::size_t i = k + 1; i < n; ++i)
+			{
+				double l = A[i * n + k] * inv_pivot;
+				A[i * n + k] = l;
+				for (std::size_t j = k + 1; j < n; ++j)
+				{
+					A[i * n + j] -= l * A[k * n + j];
+				}
+			}
+		}
+		return true;
+	}
+
+	// Solves A x = b in place with the factors from lu_factor
+	inline void lu_solve(std::span<const double> LU, std::size_t n, std::span<const std::size_t> pivot, std::span<double> b)
+	{
+		for (std::size_t k = 0; k < n; ++k)
+		{
+			std::swap(b[k], b[pivot[k]]);
+		}
+		for (std::size_t i = 1; i < n; ++i)
+		{
+			for (std::size_t j = 0; j < i; ++j)
+			{
+				b[i] -= LU[i * n + j] * b[j];
+			}
+		}
+		for (std::size_t i = n; i-- > 0;)
+		{
+			for (std::size_t j = i + 1; j < n; ++j)
+			{
+				b[i] -= LU[i * n + j] * b[j];
+			}
+			b[i] /= LU[i * n + i];
+		}
+	}
+}
+
+// Forward-difference Jacobian of any RHS callable, in the form the Rosenbrock
+// stepper calls: jac(t, x, dx, J) returns f(t, x) in dx and df/dx row-major in
+// J, for num_states + 1 RHS evaluations
+template <class F>
+class FiniteDifferenceJacobian
+{
+public:
+	FiniteDifferenceJacobian(F f, std::size_t num_states) : f(std::move(f)), x_shift(num_states), dx_shift(num_states) {}
+
+	void operator()(double t, std::span<const double> x, std::span<double> dx, std::span<double> J)
+	{
+		std::size_t n = x.size();
+		f(t, x, dx);
+
+		std::copy(x.begin(), x.end(), x_shift.begin());
+		for (std::size_t j = 0; j < n; ++j)
+		{
+			double delta = std::sqrt(std::numeric_limits<double>::epsilon()) * std::max(1e-5, std::abs(x[j]));
+			x_shift[j] = x[j] + delta;
+			delta = x_shift[j] - x[j];
+
+			f(t, std::span<const double>(x_shift), std::span<double>(dx_shift));
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				J[i * n + j] = (dx_shift[i] - dx[i]) / delta;
+			}
+			x_shift[j] = x[j];
+		}
+	}
+
+private:
+	F f;
+	std::vector<double> x_shift, dx_shift;
+};
+
+// Linearly implicit Rosenbrock method RODAS3 (Sandu et al., 1997, as in KPP):
+// four stages, order 3 with an embedded order 2 estimate, L-stable and stiffly
+// accurate, so heavily damped rate modes cost neither stability nor tiny
+// steps. Each attempt factors (I / (h gamma) - J) once and reuses the LU for
+// all four stages; the Jacobian comes from jac(t, x, dx, J) (analytic, e.g.
+// FlatEarthJacobian, or FiniteDifferenceJacobian) with f(t, x) once per
+// accepted step and is kept for any retries. The first two stages both sit at
+// x, so an attempt costs two more RHS evaluations. The RHS is treated as
+// autonomous, as the flat-earth EoM is; set time_dependent to add the df/dt
+// term by forward difference.
+template <class F, class Jac>
+class RosenbrockStepper
+{
+public:
+	RosenbrockStepper(F f, Jac jac, std::size_t num_states, const StepSizeControl& control = StepSizeControl(), bool time_dependent = false)
+		: f(std::move(f)), jac(std::move(jac)), control(control), time_dependent(time_dependent),
+		abs_tol(integrator_detail::per_state(control.abs_tol, num_states, "abs_tol")),
+		rel_tol(integrator_detail::per_state(control.rel_tol, num_states, "rel_tol")),
+		J(num_states * num_states), LU(num_states * num_states), pivot(num_states),
+		f0(num_states), dfdt(num_states), x_stage(num_states), f_stage(num_states), x_new(num_states),
+		K{ std::vector<double>(num_states), std::vector<double>(num_states), std::vector<double>(num_states), std::vector<double>(num_states) },
+		last(num_states), h_s(control.h_initial_s)
+	{
+		if (control.h_min_s <= 0.0 || control.h_max_s < control.h_min_s)
+		{
+			throw std::invalid_argument("StepSizeControl: need 0 < h_min_s <= h_max_s");
+		}
+	}
+
+	std::size_t size() const { return f0.size(); }
+	std::size_t rhs_evals() const { return num_evals; }
+	std::size_t jacobian_evals() const { return num_jacobians; }
+	std::size_t lu_factorizations() const { return num_factorizations; }
+	std::size_t steps() const { return num_accepted; }
+	std::size_t accepted_steps() const { return num_accepted; }
+	std::size_t rejected_steps() const { return num_rejected; }
+	double step_size() const { return h_s; }
+
+	// No state is carried between steps apart from the step size
+	void reset() {}
+
+	double step(double t, std::span<double> x, double t_max)
+	{
+		/*  Arguments and return value as DormandPrince45Stepper::step. Also
+			throws std::runtime_error if the iteration matrix is singular at
+			the smallest step.
+		*/
+
+		integrator_detail::check_size(x, f0.size());
+		std::size_t n = x.size();
+
+		// Jacobian and f(t, x) at the start of the step, shared by all attempts
+		jac(t, std::span<const double>(x), std::span<double>(f0), std::span<double>(J));
+		++num_jacobians;
+		++num_evals;
+
+		if (time_dependent)
+		{
+			double delta = std::sqrt(std::numeric_limits<double>::epsilon()) * std::max(1e-5, std::abs(t));
+			f(t + delta, std::span<const double>(x), std::span<double>(f_stage));
+			++num_evals;
+			for (std::size_t j = 0; j < n; ++j)
+			{
+				dfdt[j] = (f_stage[j] - f0[j]) / delta;
+			}
+		}
+
+		if (h_s <= 0.0)
+		{
+			h_s = std::clamp(initial_step(x), control.h_min_s, control.h_max_s);
+		}
+
+		bool rejected = false;
+
+		while (true)
+		{
+			double h_try = std::min(h_s, t_max - t);
+			bool clipped = h_try < h_s;
+
+			// Iteration matrix I / (h gamma) - J
+			double gh_inv = 1.0 / (gamma[0] * h_try);
+			for (std::size_t i = 0; i < n * n; ++i)
+			{
+				LU[i] = -J[i];
+			}
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				LU[i * n + i] += gh_inv;
+			}
+			++num_factorizations;
+
+			if (!integrator_detail::lu_factor(LU, n, pivot))
+			{
+				++num_rejected;
+				rejected = true;
+				h_s = 0.5 * h_try;
+				if (h_s < control.h_min_s)
+				{
+					throw std::runtime_error("RosenbrockStepper: singular iteration matrix");
+				}
+				continue;
+			}
+
+			for (std::size_t s = 0; s < stages; ++s)
+			{
+				std::span<double> K_s(K[s]);
+
+				// A stage at x itself (the first, and the second with a21 = 0)
+				// takes f0 instead of a new evaluation, as KPP's ros_NewF
+				if (std::all_of(a[s], a[s] + s, [](double a_sr) { return a_sr == 0.0; }))
+				{
+					std::copy(f0.begin(), f0.end(), K_s.begin());
+				}
+				else
+				{
+					for (std::size_t j = 0; j < n; ++j)
+					{
+						double x_j = x[j];
+						for (std::size_t r = 0; r < s; ++r)
+						{
+							x_j += a[s][r] * K[r][j];
+						}
+						x_stage[j] = x_j;
+					}
+					f(t + alpha[s] * h_try, std::span<const double>(x_stage), K_s);
+					++num_evals;
+				}
+
+				for (std::size_t r = 0; r < s; ++r)
+				{
+					double c_h = c[s][r] / h_try;
+					for (std::size_t j = 0; j < n; ++j)
+					{
+						K_s[j] += c_h * K[r][j];
+					}
+				}
+
+				if (time_dependent)
+				{
+					for (std::size_t j = 0; j < n; ++j)
+					{
+						K_s[j] += h_try * gamma[s] * dfdt[j];
+					}
+				}
+
+				integrator_detail::lu_solve(LU, n, pivot, K_s);
+			}
+
+			// Solution and the embedded error estimate (the last stage)
+			double sum = 0.0;
+			for (std::size_t j = 0; j < n; ++j)
+			{
+				x_new[j] = x[j] + m[0] * K[0][j] + m[2] * K[2][j] + m[3] * K[3][j];
+				double scale = abs_tol[j] + rel_tol[j] * std::max(std::abs(x[j]), std::abs(x_new[j]));
+				sum += (K[3][j] / scale) * (K[3][j] / scale);
+			}
+			double err = std::sqrt(sum / static_cast<double>(n));
+
+			double fac = std::isfinite(err) ? control.safety / std::pow(std::max(err, 1e-10), 1.0 / 3.0) : min_shrink;
+			fac = std::clamp(fac, min_shrink, max_growth);
+
+			if (err <= 1.0)
+			{
+				double h_new = h_try * fac;
+				if (rejected)
+				{
+					h_new = std::min(h_new, h_try);
+				}
+				h_s = std::clamp(clipped ? std::max(h_new, h_s) : h_new, control.h_min_s, control.h_max_s);
+
+				last.begin(t, x, h_try);
+				std::copy(x_new.begin(), x_new.end(), x.begin());
+				integrator_detail::renormalize(x);
+				last.end(x);
+
+				++num_accepted;
+				return h_try;
+			}
+
+			++num_rejected;
+			rejected = true;
+			h_s = h_try * fac;
+			if (h_s < control.h_min_s)
+			{
+				throw std::runtime_error("RosenbrockStepper: step size fell below h_min_s");
+			}
+		}
+	}
+
+	// State at time t within the last accepted step: quadratic Hermite through
+	// both ends with the derivative at the start
+	void interpolate(double t, std::span<double> x_out) const
+	{
+		double theta = last.theta(t);
+		integrator_detail::hermite_quadratic(theta, last.h_s, last.x_start, f0, last.x_end, x_out);
+		integrator_detail::renormalize(x_out);
+	}
+
+private:
+	// Starting step from the size of f(t, x) against the tolerances
+	double initial_step(std::span<const double> x) const
+	{
+		double d0 = 0.0;
+		double d1 = 0.0;
+		for (std::size_t j = 0; j < x.size(); ++j)
+		{
+			double scale = abs_tol[j] + rel_tol[j] * std::abs(x[j]);
+			d0 += (x[j] / scale) * (x[j] / scale);
+			d1 += (f0[j] / scale) * (f0[j] / scale);
+		}
+		d0 = std::sqrt(d0 / static_cast<double>(x.size()));
+		d1 = std::sqrt(d1 / static_cast<double>(x.size()));
+		return d0 < 1e-5 || d1 < 1e-5 ? 1e-6 : 0.01 * d0 / d1;
+	}
+
+	// RODAS3 coefficients, stage form: (I / (h gamma) - J) K_s = f(x + sum a K) + sum (c / h) K
+	static constexpr std::size_t stages = 4;
+	static constexpr double a[4][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 2, 0, 0 }, { 2, 0, 1 } };
+	static constexpr double c[4][3] = { { 0, 0, 0 }, { 4, 0, 0 }, { 1, -1, 0 }, { 1, -1, -8.0 / 3.0 } };
+	static constexpr double m[4] = { 2, 0, 1, 1 };
+	static constexpr double alpha[4] = { 0, 0, 1, 1 };
+	static constexpr double gamma[4] = { 0.5, 1.5, 0, 0 };
+
+	static constexpr double max_growth = 6.0;
+	static constexpr double min_shrink = 0.2;
+
+	F f;
+	Jac jac;
+	StepSizeControl control;
+	bool time_dependent;
+	std::vector<double> abs_tol, rel_tol;
+	std::vector<double> J, LU;
+	std::vector<std::size_t> pivot;
+	std::vector<double> f0, dfdt, x_stage, f_stage, x_new;
+	std::array<std::vector<double>, 4> K;
+	integrator_detail::LastStep last;
+	double h_s;
+	std::size_t num_evals = 0;
+	std::size_t num_jacobians = 0;
+	std::size_t num_factorizations = 0;
+	std::size_t num_accepted = 0;
+	std::size_t num_rejected = 0;
+};
+
+// Gragg-Bulirsch-Stoer extrapolation, after Hairer & Wanner's ODEX (Solving
+// ODEs I, II.9). Column k of a step runs the modified midpoint rule with n_k
+// substeps and extrapolates the results of columns 0..k to zero substep size
+// with the Aitken-Neville tableau in h^2, giving order 2k + 2. The number of
+// columns and the step are chosen together to minimise RHS evaluations per
+// unit time, so at tight tolerances (1e-8 to 1e-12) it takes large steps of
+// high order where RK4 needs a tiny step.
+//
+// With dense_output the sequence is n_k = 2, 6, 10, 14, ..., whose midpoints
+// fall on odd substeps. The midpoint value and central differences of the
+// stored stage derivatives around it then extrapolate like the end values and
+// give the solution's derivatives at the middle of the step, and
+// interpolate() is the Hermite polynomial through both ends and those
+// derivatives (ODEX's dense output, order about 2k at no extra RHS
+// evaluations). As in ODEX (ERRINT), a step whose last interpolant term peaks
+// above 10x the tolerance is rejected and retried shorter. That term is only
+// an estimate: a step spanning about an oscillation of the solution can still
+// pass with samples between its ends well off the tolerance, so cap h_max_s
+// below the period of interest when they matter. Without dense output the
+// cheaper sequence n_k = 2, 4, 6, 8, ... is used and interpolate() throws.
+template <class F>
+class GraggBulirschStoerStepper
+{
+public:
+	static constexpr std::size_t max_columns = 9;
+
+	GraggBulirschStoerStepper(F f, std::size_t num_states, const StepSizeControl& control = StepSizeControl(), bool dense_output = true)
+		: f(std::move(f)), control(control), dense_output(dense_output),
+		abs_tol(integrator_detail::per_state(control.abs_tol, num_states, "abs_tol")),
+		rel_tol(integrator_detail::per_state(control.rel_tol, num_states, "rel_tol")),
+		f0(num_states), f1(num_states), dx(num_states), z(num_states), z_prev(num_states),
+		table(max_columns, std::vector<double>(num_states)),
+		table_mid(dense_output ? max_columns : 0, std::vector<double>(num_states)),
+		stage_derivatives(dense_output ? max_columns : 0),
+		dense((4 + 2 * max_columns) * num_states), last(num_states), h_s(control.h_initial_s)
+	{
+		if (control.h_min_s <= 0.0 || control.h_max_s < control.h_min_s)
+		{
+			throw std::invalid_argument("StepSizeControl: need 0 < h_min_s <= h_max_s");
+		}
+
+		for (std::size_t k = 0; k < max_columns; ++k)
+		{
+			substeps[k] = dense_output ? 4 * k + 2 : 2 * k + 2;
+			work[k] = (k == 0 ? 1 : work[k - 1]) + substeps[k];
+			if (dense_output)
+			{
+				stage_derivatives[k].resize((substeps[k] + 1) * num_states);
+			}
+		}
+
+		// Starting column from the tolerance, as ODEX: more columns for tighter tolerances
+		double tol = *std::min_element(rel_tol.begin(), rel_tol.end());
+		double k_start = -std::log10(tol + 1e-40) * 0.6 + 0.5;
+		k_target = std::clamp(static_cast<std::size_t>(std::max(k_start, 0.0)), std::size_t(1), max_columns - 2);
+	}
+
+	std::size_t size() const { return f0.size(); }
+	std::size_t rhs_evals() const { return num_evals; }
+	std::size_t steps() const { return num_accepted; }
+	std::size_t accepted_steps() const { return num_accepted; }
+	std::size_t rejected_steps() const { return num_rejected; }
+	double step_size() const { return h_s; }
+
+	// Order (2 * columns) the next step will aim for
+	std::size_t order() const { return 2 * k_target + 2; }
+
+	// Drop the stored f(t, x), e.g. after the state was changed from outside
+	void reset() { have_f0 = false; }
+
+	double step(double t, std::span<double> x, double t_max)
+	{
+		/*  Arguments and return value as DormandPrince45Stepper::step */
+
+		integrator_detail::check_size(x, f0.size());
+		std::size_t nx = x.size();
+
+		if (!have_f0)
+		{
+			f(t, std::span<const double>(x), std::span<double>(f0));
+			++num_evals;
+			have_f0 = true;
+		}
+		if (h_s <= 0.0)
+		{
+			h_s = initial_step(x);
+		}
+
+		bool rejected = false;
+
+		while (true)
+		{
+			double h_try = std::min(h_s, t_max - t);
+			bool clipped = h_try < h_s;
+
+			// Columns up to one past the target; convergence is checked from the
+			// column before it, as ODEX does
+			std::size_t k_last = k_target + 1;
+			std::size_t k_accepted = 0;
+			bool converged = false;
+
+			for (std::size_t k = 0; k <= k_last; ++k)
+			{
+				double err = column(t, x, h_try, k);
+				if (k == 0)
+				{
+					continue;
+				}
+
+				// Step that column k would have needed for err = 1, and its work per unit time
+				double expo = 1.0 / static_cast<double>(2 * k + 1);
+				double fac_min = std::pow(fac1, expo);
+				double fac = std::isfinite(err) ? std::min(fac2 / fac_min, std::max(fac_min, std::pow(err / safe1, expo) / control.safety)) : fac2 / fac_min;
+				h_opt[k] = std::min(h_try / fac, control.h_max_s);
+				work_per_time[k] = static_cast<double>(work[k]) / h_opt[k];
+
+				if (k + 1 < k_target)
+				{
+					continue;
+				}
+				if (err <= 1.0)
+				{
+					k_accepted = k;
+					converged = true;
+					break;
+				}
+
+				// Give up early when the remaining columns cannot bring err below 1
+				double n0 = static_cast<double>(substeps[0]);
+				double hopeless = k + 1 == k_target
+					? std::pow(static_cast<double>(substeps[k_target] * substeps[k_target + 1]) / (n0 * n0), 2)
+					: std::pow(static_cast<double>(substeps[k_target + 1]) / n0, 2);
+				if (k == k_last || !std::isfinite(err) || err > hopeless)
+				{
+					k_accepted = k;
+					break;
+				}
+			}
+
+			if (!converged)
+			{
+				++num_rejected;
+				rejected = true;
+
+				k_target = std::min({ k_target, k_accepted, max_columns - 2 });
+				if (k_target > 1 && work_per_time[k_target - 1] < work_per_time[k_target] * fac3)
+				{
+					--k_target;
+				}
+				h_s = h_opt[k_target];
+				if (h_s < control.h_min_s)
+				{
+					throw std::runtime_error("GraggBulirschStoerStepper: step size fell below h_min_s");
+				}
+				continue;
+			}
+
+			// The new state, and f there, which starts the next step and closes
+			// the dense output
+			std::size_t kc = k_accepted;
+			last.begin(t, x, h_try);
+			std::copy(table[kc].begin(), table[kc].end(), x.begin());
+			integrator_detail::renormalize(x);
+			last.end(x);
+
+			f(t + h_try, std::span<const double>(x), std::span<double>(f1));
+			++num_evals;
+
+			if (dense_output)
+			{
+				fit_dense(kc, h_try, nx);
+
+				// ODEX's ERRINT: an interpolant far off between the step ends
+				// rejects the step, even though the ends passed their test
+				double error = interpolation_error(nx);
+				if (error > 10.0)
+				{
+					std::copy(last.x_start.begin(), last.x_start.end(), x.begin());
+					++num_rejected;
+					rejected = true;
+
+					h_s = h_try / std::max(std::pow(error, 1.0 / static_cast<double>(dense_terms + 3)), 0.01);
+					if (h_s < control.h_min_s)
+					{
+						throw std::runtime_error("GraggBulirschStoerStepper: step size fell below h_min_s");
+					}
+					continue;
+				}
+			}
+
+			// Next order and step from the work per unit time of the columns computed
+			std::size_t k_opt;
+			if (kc == 1)
+			{
+				k_opt = rejected ? 1 : std::min<std::size_t>(2, max_columns - 2);
+			}
+			else if (kc <= k_target)
+			{
+				k_opt = kc;
+				if (work_per_time[kc - 1] < work_per_time[kc] * fac3)
+				{
+					k_opt = kc - 1;
+				}
+				if (work_per_time[kc] < work_per_time[kc - 1] * fac4)
+				{
+					k_opt = std::min(kc + 1, max_columns - 2);
+				}
+			}
+			else
+			{
+				k_opt = kc - 1;
+				if (kc > 2 && work_per_time[kc - 2] < work_per_time[kc - 1] * fac3)
+				{
+					k_opt = kc - 2;
+				}
+				if (work_per_time[kc] < work_per_time[k_opt] * fac4)
+				{
+					k_opt = std::min(kc, max_columns - 2);
+				}
+			}
+
+			double h_new;
+			if (rejected)
+			{
+				k_opt = std::min(k_opt, kc);
+				h_new = std::min(h_try, h_opt[k_opt]);
+			}
+			else if (k_opt <= kc)
+			{
+				h_new = h_opt[k_opt];
+			}
+			else
+			{
+				// Going up an order: scale the step by the extra work of the new column
+				std::size_t k_work = kc < k_target && work_per_time[kc] < work_per_time[kc - 1] * fac4 ? k_opt + 1 : k_opt;
+				h_new = h_opt[kc] * static_cast<double>(work[k_work]) / static_cast<double>(work[kc]);
+			}
+			k_target = k_opt;
+
+			// A step shortened to land on t_max says nothing about the step size
+			h_s = std::clamp(clipped ? std::max(h_new, h_s) : h_new, control.h_min_s, control.h_max_s);
+
+			std::swap(f0, f1);
+			++num_accepted;
+			return h_try;
+		}
+	}
+
+	// State at time t within the last accepted step; needs dense_output
+	void interpolate(double t, std::span<double> x_out) const
+	{
+		if (!dense_output)
+		{
+			throw std::logic_error("GraggBulirschStoerStepper: built without dense output");
+		}
+
+		double theta = last.theta(t);
+		double theta1 = 1.0 - theta;
+		double u = theta - 0.5;
+		std::size_t nx = x_out.size();
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			// Cubic Hermite through both ends, plus (theta (1 - theta))^2 times
+			// the Taylor polynomial in u = theta - 1/2 that matches the midpoint
+			double hermite = dense[j] + theta * (dense[nx + j] + theta1 * (dense[2 * nx + j] * theta + dense[3 * nx + j] * theta1));
+
+			double correction = dense[(4 + dense_terms - 1) * nx + j];
+			for (std::size_t i = dense_terms - 1; i > 0; --i)
+			{
+				correction = dense[(4 + i - 1) * nx + j] + correction * u / static_cast<double>(i);
+			}
+
+			x_out[j] = hermite + (theta * theta1) * (theta * theta1) * correction;
+		}
+		integrator_detail::renormalize(x_out);
+	}
+
+private:
+	// Modified midpoint rule over [t, t + h_try] with substeps[k] substeps and
+	// Gragg's smoothing step, extrapolated into row k of the tableau. Returns
+	// the scaled RMS difference of the two most extrapolated values (0 for
+	// column 0). Costs substeps[k] RHS evaluations.
+	double column(double t, std::span<const double> x, double h_try, std::size_t k)
+	{
+		std::size_t nx = x.size();
+		std::size_t n = substeps[k];
+		double h = h_try / static_cast<double>(n);
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			z_prev[j] = x[j];
+			z[j] = x[j] + h * f0[j];
+		}
+		if (dense_output)
+		{
+			std::copy(f0.begin(), f0.end(), stage_derivatives[k].begin());
+		}
+
+		for (std::size_t m = 1; m < n; ++m)
+		{
+			if (dense_output && m == n / 2)
+			{
+				std::copy(z.begin(), z.end(), table_mid[k].begin());
+			}
+
+			f(t + static_cast<double>(m) * h, std::span<const double>(z), std::span<double>(dx));
+			if (dense_output)
+			{
+				std::copy(dx.begin(), dx.end(), stage_derivatives[k].begin() + m * nx);
+			}
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				double z_next = z_prev[j] + 2.0 * h * dx[j];
+				z_prev[j] = z[j];
+				z[j] = z_next;
+			}
+		}
+
+		f(t + h_try, std::span<const double>(z), std::span<double>(dx));
+		num_evals += n;
+		if (dense_output)
+		{
+			std::copy(dx.begin(), dx.end(), stage_derivatives[k].begin() + n * nx);
+		}
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			table[k][j] = 0.5 * (z_prev[j] + z[j] + h * dx[j]);
+		}
+
+		extrapolate(table, k);
+		if (dense_output)
+		{
+			extrapolate(table_mid, k);
+		}
+
+		if (k == 0)
+		{
+			return 0.0;
+		}
+
+		double sum = 0.0;
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			double error = table[k][j] - table[k - 1][j];
+			double scale = abs_tol[j] + rel_tol[j] * std::max(std::abs(x[j]), std::abs(table[k][j]));
+			sum += (error / scale) * (error / scale);
+		}
+		return std::sqrt(sum / static_cast<double>(nx));
+	}
+
+	// Aitken-Neville in h^2. On entry rows[l] holds T(k-1, l) for l < k and
+	// rows[k] the new midpoint result T(k, 0); on exit rows[l] holds T(k, l)
+	// for l <= k, so rows[k] - rows[k - 1] is the error estimate.
+	void extrapolate(std::vector<std::vector<double>>& rows, std::size_t k)
+	{
+		std::size_t nx = rows[k].size();
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			double current = rows[k][j];
+			for (std::size_t l = 1; l <= k; ++l)
+			{
+				double ratio = static_cast<double>(substeps[k]) / static_cast<double>(substeps[k - l]);
+				double previous = rows[l - 1][j];
+				rows[l - 1][j] = current;
+				current += (current - previous) / (ratio * ratio - 1.0);
+			}
+			rows[k][j] = current;
+		}
+	}
+
+	// Coefficients of the dense output of a step accepted at column kc. The
+	// derivatives of order q = 1..2 kc - 1 at the midpoint come from central
+	// differences of order q - 1 of the stored stage derivatives (step 2h, so
+	// one parity of substeps and an expansion in h^2), scaled by H^q and
+	// extrapolated over the columns long enough to hold them.
+	void fit_dense(std::size_t kc, double h, std::size_t nx)
+	{
+		dense_terms = 2 * kc;
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			double y_diff = last.x_end[j] - last.x_start[j];
+			dense[j] = last.x_start[j];
+			dense[nx + j] = y_diff;
+			dense[2 * nx + j] = y_diff - h * f1[j];
+			dense[3 * nx + j] = h * f0[j] - y_diff;
+		}
+
+		// Coefficient a_q of the correction (1/16 - u^2 / 2 + u^4) * sum a_i u^i / i!
+		// makes the q-th derivative at the midpoint D_q, so
+		// a_q = 16 (D_q - P^(q)(1/2) + C(q, 2) a_(q-2) - 24 C(q, 4) a_(q-4))
+		std::array<double, 2 * max_columns> weights;
+		std::array<double, max_columns> scale;
+		std::array<double, max_columns> column_values;
+
+		for (std::size_t q = 0; q < dense_terms; ++q)
+		{
+			std::size_t k_begin = q == 0 ? kc : (q - 1) / 2;
+			if (q > 0)
+			{
+				// Signed binomial weights of the central difference of order q - 1,
+				// and H^q / (2h)^(q-1) = H (n_k / 2)^(q-1) for each column
+				weights[0] = 1.0;
+				for (std::size_t i = 1; i < q; ++i)
+				{
+					weights[i] = -weights[i - 1] * static_cast<double>(q - i) / static_cast<double>(i);
+				}
+				for (std::size_t k = k_begin; k <= kc; ++k)
+				{
+					scale[k] = h;
+					for (std::size_t i = 1; i < q; ++i)
+					{
+						scale[k] *= 0.5 * static_cast<double>(substeps[k]);
+					}
+				}
+			}
+
+			double qd = static_cast<double>(q);
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				double target;
+				if (q == 0)
+				{
+					target = table_mid[kc][j];
+				}
+				else
+				{
+					for (std::size_t k = k_begin; k <= kc; ++k)
+					{
+						const double* fk = stage_derivatives[k].data() + (substeps[k] / 2 + q - 1) * nx + j;
+						double difference = 0.0;
+						for (std::size_t i = 0; i < q; ++i)
+						{
+							difference += weights[i] * fk[-static_cast<std::ptrdiff_t>(2 * i * nx)];
+						}
+						column_values[k] = scale[k] * difference;
+					}
+
+					for (std::size_t k = k_begin + 1; k <= kc; ++k)
+					{
+						for (std::size_t l = k; l > k_begin; --l)
+						{
+							double ratio = static_cast<double>(substeps[k]) / static_cast<double>(substeps[l - 1]);
+							column_values[l - 1] = column_values[l] + (column_values[l] - column_values[l - 1]) / (ratio * ratio - 1.0);
+						}
+					}
+					target = column_values[k_begin];
+				}
+
+				// Derivatives of the cubic Hermite at theta = 1/2
+				double y_diff = dense[nx + j];
+				double a_spl = dense[2 * nx + j];
+				double b_spl = dense[3 * nx + j];
+				double hermite_mid = 0.0;
+				switch (q)
+				{
+				case 0: hermite_mid = dense[j] + 0.5 * y_diff + 0.125 * (a_spl + b_spl); break;
+				case 1: hermite_mid = y_diff + 0.25 * (a_spl - b_spl); break;
+				case 2: hermite_mid = -(a_spl + b_spl); break;
+				case 3: hermite_mid = 6.0 * (b_spl - a_spl); break;
+				default: break;
+				}
+
+				double value = target - hermite_mid;
+				if (q >= 2)
+				{
+					value += 0.5 * qd * (qd - 1.0) * dense[(2 + q) * nx + j];
+				}
+				if (q >= 4)
+				{
+					value -= qd * (qd - 1.0) * (qd - 2.0) * (qd - 3.0) * dense[q * nx + j];
+				}
+				dense[(4 + q) * nx + j] = 16.0 * value;
+			}
+		}
+	}
+
+	// Scaled RMS of the last correction term at its largest over the step, as
+	// ODEX's ERRINT: (theta (1 - theta))^2 |u|^mu / mu! peaks at
+	// u^2 = mu / (4 (mu + 4)), where it is ERRFAC(mu) below
+	double interpolation_error(std::size_t nx) const
+	{
+		std::size_t mu = dense_terms - 1;
+		double mud = static_cast<double>(mu);
+		double factor = 1.0 / ((mud + 4.0) * (mud + 4.0));
+		for (std::size_t i = 1; i <= mu; ++i)
+		{
+			factor *= 0.5 * std::sqrt(mud / (mud + 4.0)) / static_cast<double>(i);
+		}
+
+		double sum = 0.0;
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			double scale = abs_tol[j] + rel_tol[j] * std::max(std::abs(last.x_start[j]), std::abs(last.x_end[j]));
+			double term = dense[(4 + mu) * nx + j] / scale;
+			sum += term * term;
+		}
+		return std::sqrt(sum / static_cast<double>(nx)) * factor;
+	}
+
+	// First step from the scale of x against its derivative (f0 must hold f(t, x))
+	double initial_step(std::span<const double> x) const
+	{
+		std::size_t nx = x.size();
+
+		double d0 = 0.0;
+		double d1 = 0.0;
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			double scale = abs_tol[j] + rel_tol[j] * std::abs(x[j]);
+			d0 += (x[j] / scale) * (x[j] / scale);
+			d1 += (f0[j] / scale) * (f0[j] / scale);
+		}
+		d0 = std::sqrt(d0 / static_cast<double>(nx));
+		d1 = std::sqrt(d1 / static_cast<double>(nx));
+
+		double h0 = d0 < 1e-5 || d1 < 1e-5 ? 1e-6 : 0.01 * d0 / d1;
+		return std::clamp(h0, control.h_min_s, control.h_max_s);
+	}
+
+	// Step size control constants of ODEX; control.safety takes the place of its SAFE2
+	static constexpr double fac1 = 0.02;   // largest growth is fac1^(-1 / (2k + 1))
+	static constexpr double fac2 = 4.0;    // largest shrink is fac2 * fac1^(-1 / (2k + 1))
+	static constexpr double fac3 = 0.8;    // drop a column if that saves 20% of the work
+	static constexpr double fac4 = 0.9;    // add a column if that saves 10% of the work
+	static constexpr double safe1 = 0.65;
+
+	F f;
+	StepSizeControl control;
+	bool dense_output;
+	std::vector<double> abs_tol, rel_tol;
+	std::vector<double> f0, f1, dx, z, z_prev;
+	std::vector<std::vector<double>> table, table_mid;
+	std::vector<std::vector<double>> stage_derivatives;  // f at substeps 0..n_k of each column, for dense output
+	std::vector<double> dense;                           // dense output coefficients, state-minor
+	std::size_t dense_terms = 0;
+	std::array<std::size_t, max_columns> substeps{};
+	std::array<std::size_t, max_columns> work{};
+	std::array<double, max_columns> h_opt{};
+	std::array<double, max_columns> work_per_time{};
+	integrator_detail::LastStep last;
+	double h_s;
+	std::size_t k_target = 1;
+	bool have_f0 = false;
+	std::size_t num_evals = 0;
+	std::size_t num_accepted = 0;
+	std::size_t num_rejected = 0;
+};
+
+template <class Stepper>
+Trajectory integrate_adaptive(Stepper& stepper, double t0_s, const std::vector<double>& x0, double tf_s, TrajectoryLayout layout = TrajectoryLayout::TimeMajor)
+{
+	/*  Arguments:
+
+		stepper - adaptive stepper built for x0.size() states
+
+		t0_s, tf_s - start and end time [s]
+
+		x0 - initial state
+
+		layout - storage order of the result
+
+		Returns the solution at t0_s and at every accepted step end. The last
+		step lands exactly on tf_s.
+	*/
+
+	std::vector<double> x = x0;
+	Trajectory trajectory(x0.size(), 0, layout);
+	trajectory.append(t0_s, x0);
+
+	double t = t0_s;
+	while (t < tf_s)
+	{
+		double h = stepper.step(t, x, tf_s);
+		t = tf_s - t <= h ? tf_s : t + h;
+		trajectory.append(t, x);
+	}
+
+	return trajectory;
+}
+
+template <class Stepper>
+Trajectory integrate_adaptive_sampled(Stepper& stepper, double t0_s, const std::vector<double>& x0, const std::vector<double>& t_out, TrajectoryLayout layout = TrajectoryLayout::TimeMajor)
+{
+	/*  Arguments:
+
+		stepper - adaptive stepper built for x0.size() states
+
+		t0_s - initial time [s]
+
+		x0 - initial state
+
+		t_out - output times [s], ascending, none before t0_s (sample_times)
+
+		layout - storage order of the result
+
+		Returns the solution at t_out[k]. The stepper
+		takes the steps its tolerances allow and the outputs come from its
+		dense output, so they cost no extra RHS evaluations.
+	*/
+
+	integrator_detail::check_output_times(t0_s, t_out);
+
+	std::size_t nx = x0.size();
+	std::vector<double> x = x0;
+	std::vector<double> x_out(nx);
+	Trajectory trajectory(nx, t_out, layout);
+
+	std::size_t k = 0;
+	for (; k < t_out.size() && t_out[k] <= t0_s; ++k)
+	{
+		trajectory.set_row(k, x0);
+	}
+
+	double t = t0_s;
+	while (k < t_out.size())
+	{
+		double h = stepper.step(t, x, t_out.back());
+		t = t_out.back() - t <= h ? t_out.back() : t + h;
+
+		for (; k < t_out.size() && t_out[k] <= t; ++k)
+		{
+			stepper.interpolate(t_out[k], x_out);
+			trajectory.set_row(k, x_out);
+		}
+	}
+
+	return trajectory;
+}
+
+#endif // ADAPTIVE_INTEGRATORS_H
@@ -0,0 +1,86 @@
+#include <cmath>
+#include <algorithm>
+#include <numbers>
+#include "attitude.h"
+
+std::array<double, 4> euler_to_quaternion(double phi_rad, double theta_rad, double psi_rad)
+{
+	double c_phi = std::cos(0.5 * phi_rad);
+	double s_phi = std::sin(0.5 * phi_rad);
+	double c_theta = std::cos(0.5 * theta_rad);
+	double s_theta = std::sin(0.5 * theta_rad);
+	double c_psi = std::cos(0.5 * psi_rad);
+	double s_psi = std::sin(0.5 * psi_rad);
+
+	return {
+		c_phi * c_theta * c_psi + s_phi * s_theta * s_psi,
+		s_phi * c_theta * c_psi - c_phi * s_theta * s_psi,
+		c_phi * s_theta * c_psi + s_phi * c_theta * s_psi,
+		c_phi * c_theta * s_psi - s_phi * s_theta * c_psi };
+}
+
+std::array<double, 3> quaternion_to_euler(double q0, double q1, double q2, double q3)
+{
+	// Elements of C_b2n used by the 3-2-1 extraction
+	double C_b2n_11 = q0 * q0 + q1 * q1 - q2 * q2 - q3 * q3;
+	double C_b2n_21 = 2.0 * (q1 * q2 + q0 * q3);
+	double C_b2n_31 = 2.0 * (q1 * q3 - q0 * q2);
+	double C_b2n_32 = 2.0 * (q2 * q3 + q0 * q1);
+	double C_b2n_33 = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+
+	double phi_rad = std::atan2(C_b2n_32, C_b2n_33);
+	double theta_rad = -std::asin(std::clamp(C_b2n_31, -1.0, 1.0));
+	double psi_rad = std::atan2(C_b2n_21, C_b2n_11);
+
+	return { phi_rad, theta_rad, psi_rad };
+}
+
+void normalize_quaternion(std::span<double, 4> q)
+{
+	double norm = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+
+	if (norm == 0.0)
+	{
+		return;
+	}
+
+	for (double& qi : q)
+	{
+		qi /= norm;
+	}
+}
+
+std::array<double, 4> quaternion_multiply(const std::array<double, 4>& a, const std::array<double, 4>& b)
+{
+	return {
+		a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3],
+		a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+		a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1],
+		a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0] };
+}
+
+std::array<double, 4> rotation_vector_to_quaternion(const std::array<double, 3>& theta_rad)
+{
+	double angle2 = theta_rad[0] * theta_rad[0] + theta_rad[1] * theta_rad[1] + theta_rad[2] * theta_rad[2];
+	double angle = std::sqrt(angle2);
+
+	// sin(angle / 2) / angle; its series below 1e-4 rad covers the 0 / 0 at zero
+	double c = std::cos(0.5 * angle);
+	double s_over_angle = angle < 1e-4 ? 0.5 - angle2 / 48.0 : std::sin(0.5 * angle) / angle;
+
+	return { c, s_over_angle * theta_rad[0], s_over_angle * theta_rad[1], s_over_angle * theta_rad[2] };
+}
+
+std::vector<double> euler_state_to_quaternion_state(std::span<const double> x)
+{
+	std::array<double, 4> q = euler_to_quaternion(x[6], x[7], x[8]);
+
+	return { x[0], x[1], x[2], x[3], x[4], x[5], q[0], q[1], q[2], q[3], x[9], x[10], x[11] };
+}
+
+std::vector<double> quaternion_state_to_euler_state(std::span<const double> x)
+{
+	std::array<double, 3> euler = quaternion_to_euler(x[6], x[7], x[8], x[9]);
+
+	return { x[0], x[1], x[2], x[3], x[4], x[5], euler[0], euler[1], euler[2], x[10], x[11], x[12] };
+}
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef ATTITUDE_H
+#define ATTITUDE_H
+
+#include <array>
+#include <span>
+#include <vector>
+
+// Quaternions are scalar first, q = [q0 q1 q2 q3], and rotate body axes into NED
+// (the same sense as C_b2n in flat_earth_eom). Euler angles are the 3-2-1
+// (yaw, pitch, roll) sequence used by the 12-state model.
+
+// Number of states in each layout
+constexpr std::size_t EULER_STATE_SIZE = 12;
+constexpr std::size_t QUATERNION_STATE_SIZE = 13;
+
+// Index of q0 in the 13-state layout [u v w p q r q0 q1 q2 q3 p1 p2 p3]
+constexpr std::size_t QUATERNION_INDEX = 6;
+
+std::array<double, 4> euler_to_quaternion(double phi_rad, double theta_rad, double psi_rad);
+
+// Returns [phi, theta, psi]; theta is clamped at +-90 deg
+std::array<double, 3> quaternion_to_euler(double q0, double q1, double q2, double q3);
+
+// Scales q back to unit length (no-op for a zero quaternion)
+void normalize_quaternion(std::span<double, 4> q);
+
+// Hamilton product a * b: the rotation b followed by a, for b relative to the
+// axes rotated by a (q_b2n * dq_body)
+std::array<double, 4> quaternion_multiply(const std::array<double, 4>& a, const std::array<double, 4>& b);
+
+// Unit quaternion of a rotation by |theta| about theta / |theta| (the exponential
+// map of so(3)); exact to rounding for any angle
+std::array<double, 4> rotation_vector_to_quaternion(const std::array<double, 3>& theta_rad);
+
+// Converts a 12-state Euler-angle state to the 13-state quaternion layout
+std::vector<double> euler_state_to_quaternion_state(std::span<const double> x);
+
+// Converts a 13-state quaternion state back to the 12-state Euler-angle layout.
+// Meant for output; integrate in the quaternion layout.
+std::vector<double> quaternion_state_to_euler_state(std::span<const double> x);
+
+#endif // ATTITUDE_H
@@ -0,0 +1,818 @@
+// flat_earth_bench: timings and accuracy reports kept out of the simulator.
+// Runs every section, or only the ones named on the command line:
+//
+//   flat_earth_bench dispatch quaternion rkmk jacobian float trig parareal compression gbs stiff multirate
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "adaptive_integrators.h"
+#include "attitude.h"
+#include "flat_earth_compression.h"
+#include "flat_earth_eom.h"
+#include "flat_earth_eom_kernel.h"
+#include "flat_earth_ensemble.h"
+#include "flat_earth_jacobian.h"
+#include "flat_earth_parareal.h"
+#include "fast_math.h"
+#include "lie_group_integrators.h"
+#include "multirate_integrators.h"
+#include "numerical_integration_methods.h"
+
+namespace
+{
+	// Keeps results alive so the timed loops are not optimized away
+	volatile double sink = 0.0;
+
+	// Best wall time [s] of repeats calls of run
+	template <class F>
+	double best_time_s(F&& run, int repeats = 5)
+	{
+		double best = 1e300;
+		for (int k = 0; k < repeats; ++k)
+		{
+			auto start = std::chrono::steady_clock::now();
+			run();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	// Check case initial state with the rates, angles and velocity spread out,
+	// so the timings do not depend on one point of the flight envelope
+	std::vector<std::array<double, 12>> sample_states(VehiclePreset preset, std::size_t count)
+	{
+		std::vector<std::array<double, 12>> states(count, check_case_initial_state(preset));
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			double s = static_cast<double>(i) / static_cast<double>(count);
+			states[i][0] = 10.0 + 200.0 * s;
+			states[i][2] = 20.0 * s;
+			states[i][3] += 0.3 * s;
+			states[i][6] = 1.5 * s;
+			states[i][7] = 0.8 - 1.6 * s;
+			states[i][11] = -9000.0 * s;
+		}
+		return states;
+	}
+
+	// Time per call [ns] of eom over num_evals evaluations cycling through states
+	template <class Eom, std::size_t N>
+	double ns_per_eval(Eom eom, const std::vector<std::array<double, N>>& states, std::size_t num_evals)
+	{
+		std::array<double, N> dx{};
+		double seconds = best_time_s([&]()
+		{
+			double sum = 0.0;
+			for (std::size_t i = 0; i < num_evals; ++i)
+			{
+				eom(static_cast<double>(i), states[i % states.size()], dx);
+				sum += dx[0];
+			}
+			sink = sink + sum;
+		});
+		return 1e9 * seconds / static_cast<double>(num_evals);
+	}
+
+	// Each selectFlatEarthEom entry against the kernel with every term
+	// (flat_earth_eom_inplace) on a vehicle that has only that entry's terms.
+	// Starts from the Atmos03 brick and switches drag, damping and Jxz on or off.
+	void bench_dispatch(std::ostream& out)
+	{
+		constexpr std::size_t NUM_EVALS = 2000000;
+		const VehicleParams brick = makeVehicle(VehiclePreset::NASA_Atmos03_Brick);
+		const std::vector<std::array<double, 12>> states = sample_states(VehiclePreset::NASA_Atmos03_Brick, 64);
+		const FlatEarthEomFn all_terms = static_cast<FlatEarthEomFn>(&flat_earth_eom_inplace);
+
+		out << "selectFlatEarthEom entries against the all-terms kernel (Atmos03 brick, " << NUM_EVALS << " evaluations):\n";
+		out << std::left << std::setw(7) << "entry" << std::setw(6) << "drag" << std::setw(9) << "damping" << std::setw(5) << "Jxz" << std::right
+			<< std::setw(16) << "entry [ns/eval]" << std::setw(20) << "all terms [ns/eval]" << std::setw(10) << "speedup" << "\n";
+
+		std::ios_base::fmtflags flags = out.flags();
+		for (unsigned entry = 0; entry < 8; ++entry)
+		{
+			bool has_drag = entry & 4;
+			bool has_damping = entry & 2;
+			bool has_Jxz = entry & 1;
+
+			VehicleParams vehicle = brick;
+			vehicle.CD_approx = has_drag ? 0.5 : 0.0;
+			if (!has_damping)
+			{
+				vehicle.Clp = vehicle.Clr = vehicle.Cmq = vehicle.Cnp = vehicle.Cnr = 0.0;
+			}
+			vehicle.Jxz_b_kgm2 = has_Jxz ? 0.1 * vehicle.Jxx_b_kgm2 : 0.0;
+			compileVehicle(vehicle);
+
+			FlatEarthEomFn selected = selectFlatEarthEom(vehicle);
+			auto run_selected = [&](double t, std::span<const double> x, std::span<double, 12> dx) { selected(t, x, vehicle, dx); };
+			auto run_all_terms = [&](double t, std::span<const double> x, std::span<double, 12> dx) { all_terms(t, x, vehicle, dx); };
+
+			double selected_ns = ns_per_eval(run_selected, states, NUM_EVALS);
+			double all_terms_ns = ns_per_eval(run_all_terms, states, NUM_EVALS);
+
+			out << std::left << std::setw(7) << entry << std::setw(6) << (has_drag ? "yes" : "-") << std::setw(9) << (has_damping ? "yes" : "-")
+				<< std::setw(5) << (has_Jxz ? "yes" : "-") << std::right << std::fixed << std::setprecision(1)
+				<< std::setw(16) << selected_ns << std::setw(20) << all_terms_ns
+				<< std::setprecision(2) << std::setw(9) << all_terms_ns / selected_ns << "x\n";
+		}
+		out.flags(flags);
+	}
+
+	struct LayoutRun
+	{
+		std::size_t steps = 0;      // accepted and rejected
+		std::size_t rhs_evals = 0;
+		double wall_ms = 0.0;
+		double error = 0.0;         // against the reference, relative to 1 + |x|
+		bool failed = false;
+	};
+
+	// Largest difference in the states both layouts share (velocities, rates,
+	// position), relative to 1 + |reference|; the attitude feeds all of them
+	double shared_state_error(std::span<const double> x, std::span<const double> reference)
+	{
+		double error = 0.0;
+		for (std::size_t j = 0; j < 6; ++j)
+		{
+			error = std::max(error, std::abs(x[j] - reference[j]) / (1.0 + std::abs(reference[j])));
+		}
+		for (std::size_t j = 1; j <= 3; ++j)
+		{
+			error = std::max(error, std::abs(x[x.size() - j] - reference[reference.size() - j]) / (1.0 + std::abs(reference[reference.size() - j])));
+		}
+		return std::isnan(error) ? INFINITY : error;
+	}
+
+	template <class Rhs>
+	LayoutRun rk4_layout_run(Rhs rhs, const std::vector<double>& x0, double tf_s, double h_s, const std::vector<double>& reference)
+	{
+		std::size_t nt = static_cast<std::size_t>(std::floor(tf_s / h_s + 0.5));
+		std::vector<double> x;
+		LayoutRun run;
+		run.wall_ms = 1e3 * best_time_s([&]()
+		{
+			RK4Stepper stepper(rhs, x0.size());
+			x = x0;
+			for (std::size_t i = 0; i < nt; ++i)
+			{
+				stepper.step(static_cast<double>(i) * h_s, x, h_s);
+			}
+			run.steps = stepper.steps();
+			run.rhs_evals = stepper.rhs_evals();
+		}, 3);
+		run.error = shared_state_error(x, reference);
+		return run;
+	}
+
+	template <class Rhs>
+	LayoutRun dp45_layout_run(Rhs rhs, const std::vector<double>& x0, double tf_s, double tol, const std::vector<double>& reference)
+	{
+		StepSizeControl control;
+		control.abs_tol = { tol };
+		control.rel_tol = { tol };
+
+		std::vector<double> x;
+		LayoutRun run;
+		try
+		{
+			run.wall_ms = 1e3 * best_time_s([&]()
+			{
+				DormandPrince45Stepper stepper(rhs, x0.size(), control);
+				x = x0;
+				double t = 0.0;
+				while (t < tf_s)
+				{
+					t += stepper.step(t, x, tf_s);
+				}
+				run.steps = stepper.accepted_steps() + stepper.rejected_steps();
+				run.rhs_evals = stepper.rhs_evals();
+			}, 3);
+			run.error = shared_state_error(x, reference);
+		}
+		catch (const std::runtime_error&)
+		{
+			run.failed = true;
+		}
+		return run;
+	}
+
+	// Euler-angle (12 states) against quaternion (13 states) attitude on the
+	// tumbling bricks, which pitch through 90 deg: fixed-step RK4 error and
+	// time, and the steps Dormand-Prince needs for the same tolerance
+	void bench_quaternion(std::ostream& out)
+	{
+		constexpr double TF_S = 10.0;
+		constexpr double H_REFERENCE_S = 0.00025;
+		constexpr double TOL = 1e-8;
+		const VehiclePreset presets[] = { VehiclePreset::NASA_Atmos02_Brick, VehiclePreset::NASA_Atmos03_Brick };
+
+		out << "Euler-angle against quaternion attitude, " << TF_S << " s tumble (error relative to 1 + |x|, quaternion RK4 h = "
+			<< H_REFERENCE_S << " s reference):\n";
+		out << std::left << std::setw(20) << "preset" << std::setw(18) << "method" << std::setw(12) << "layout" << std::right
+			<< std::setw(9) << "steps" << std::setw(11) << "RHS evals" << std::setw(11) << "wall [ms]" << std::setw(11) << "error" << "\n";
+
+		std::ios_base::fmtflags flags = out.flags();
+		for (VehiclePreset preset : presets)
+		{
+			const VehicleParams vehicle = makeVehicle(preset);
+			const std::array<double, 12> initial = check_case_initial_state(preset);
+
+			// Pitching at 60 deg/s, so theta reaches 90 deg within the first 1.5 s
+			std::vector<double> x0_euler(initial.begin(), initial.end());
+			x0_euler[4] = 60.0 * std::numbers::pi / 180.0;
+			const std::vector<double> x0_quat = euler_state_to_quaternion_state(x0_euler);
+
+			FlatEarthRhs<> euler{ vehicle };
+			FlatEarthRhs<ConstantDragForces, BrickDampingMoments, GeneralInertia, QuaternionAttitude> quat{ vehicle };
+
+			std::vector<double> reference = x0_quat;
+			RK4Stepper reference_stepper(quat, reference.size());
+			std::size_t nt = static_cast<std::size_t>(std::floor(TF_S / H_REFERENCE_S + 0.5));
+			for (std::size_t i = 0; i < nt; ++i)
+			{
+				reference_stepper.step(static_cast<double>(i) * H_REFERENCE_S, reference, H_REFERENCE_S);
+			}
+
+			auto print = [&](const char* method, const char* layout, const LayoutRun& run)
+			{
+				out << std::left << std::setw(20) << preset_name(preset) << std::setw(18) << method << std::setw(12) << layout << std::right;
+				if (run.failed)
+				{
+					out << std::setw(53) << "step size underflow" << "\n";
+					return;
+				}
+				out << std::setw(9) << run.steps << std::setw(11) << run.rhs_evals
+					<< std::fixed << std::setprecision(2) << std::setw(11) << run.wall_ms
+					<< std::scientific << std::setprecision(1) << std::setw(11) << run.error << "\n";
+				out.flags(flags);
+			};
+
+			for (double h_s : { 0.01, 0.05 })
+			{
+				std::string method = "RK4, h = " + std::to_string(h_s).substr(0, 4);
+				print(method.c_str(), "Euler", rk4_layout_run(euler, x0_euler, TF_S, h_s, reference));
+				print(method.c_str(), "quaternion", rk4_layout_run(quat, x0_quat, TF_S, h_s, reference));
+			}
+			print("DP45, tol 1e-8", "Euler", dp45_layout_run(euler, x0_euler, TF_S, TOL, reference));
+			print("DP45, tol 1e-8", "quaternion", dp45_layout_run(quat, x0_quat, TF_S, TOL, reference));
+		}
+		out.flags(flags);
+	}
+
+	// Rotation angle between two attitude quaternions, neither assumed unit length
+	double attitude_error(std::span<const double> q, std::span<const double> q_reference)
+	{
+		std::array<double, 4> dq = quaternion_multiply({ q_reference[0], -q_reference[1], -q_reference[2], -q_reference[3] }, { q[0], q[1], q[2], q[3] });
+		double angle = 2.0 * std::atan2(std::hypot(dq[1], dq[2], dq[3]), std::abs(dq[0]));
+		return std::isnan(angle) ? INFINITY : angle;
+	}
+
+	template <class Stepper>
+	std::vector<double> fixed_step_final(Stepper stepper, std::vector<double> x, double tf_s, double h_s)
+	{
+		std::size_t nt = static_cast<std::size_t>(std::floor(tf_s / h_s + 0.5));
+		for (std::size_t i = 0; i < nt; ++i)
+		{
+			stepper.step(static_cast<double>(i) * h_s, x, h_s);
+		}
+		return x;
+	}
+
+	// RKMK4 against quaternion and Euler-angle RK4 on the bricks: attitude
+	// error after 10 s at equal steps, so at equal work (4 RHS evaluations per
+	// step for all three), for a constant-rate spin and two tumbles
+	void bench_rkmk(std::ostream& out)
+	{
+		constexpr double TF_S = 10.0;
+		constexpr double H_REFERENCE_S = 1e-5;
+		constexpr double REV_S = 2.0 * std::numbers::pi;
+		constexpr double DEG = std::numbers::pi / 180.0;
+		const VehiclePreset presets[] = { VehiclePreset::NASA_Atmos02_Brick, VehiclePreset::NASA_Atmos03_Brick };
+
+		struct Case
+		{
+			const char* name;
+			std::array<double, 3> pqr_rad_s;  // NaN: the check-case rates
+			double theta_rad;
+			std::vector<double> h_s;
+		};
+		const Case cases[] = {
+			{ "5 rev/s about body z, level", { 0.0, 0.0, 5.0 * REV_S }, 0.0, { 0.02, 0.005 } },
+			{ "5 rev/s about body z, pitched 60 deg", { 0.0, 0.0, 5.0 * REV_S }, 60.0 * DEG, { 0.02, 0.005 } },
+			{ "tumble at (1, 0.5, 0.25) rev/s, pitched 60 deg", { REV_S, 0.5 * REV_S, 0.25 * REV_S }, 60.0 * DEG, { 0.01, 0.005 } },
+			{ "check-case tumble", { NAN, NAN, NAN }, NAN, { 0.05, 0.025 } }
+		};
+
+		out << "RKMK4 against RK4 on quaternions and Euler angles, attitude error after " << TF_S
+			<< " s [rad] (quaternion RK4 h = " << H_REFERENCE_S << " s reference):\n";
+		out << std::left << std::setw(20) << "preset" << std::setw(48) << "case" << std::right << std::setw(7) << "h [s]"
+			<< std::setw(11) << "Euler RK4" << std::setw(16) << "quaternion RK4" << std::setw(10) << "RKMK4" << "\n";
+
+		std::ios_base::fmtflags flags = out.flags();
+		for (VehiclePreset preset : presets)
+		{
+			const VehicleParams vehicle = makeVehicle(preset);
+			const std::array<double, 12> initial = check_case_initial_state(preset);
+			FlatEarthRhs<> euler{ vehicle };
+			FlatEarthRhs<ConstantDragForces, BrickDampingMoments, GeneralInertia, QuaternionAttitude> quat{ vehicle };
+
+			for (const Case& c : cases)
+			{
+				std::vector<double> x0_euler(initial.begin(), initial.end());
+				if (!std::isnan(c.theta_rad))
+				{
+					std::copy(c.pqr_rad_s.begin(), c.pqr_rad_s.end(), x0_euler.begin() + 3);
+					x0_euler[7] = c.theta_rad;
+				}
+				const std::vector<double> x0_quat = euler_state_to_quaternion_state(x0_euler);
+				const std::vector<double> reference = fixed_step_final(RK4Stepper(quat, x0_quat.size()), x0_quat, TF_S, H_REFERENCE_S);
+				std::span<const double> q_reference(reference.data() + QUATERNION_INDEX, 4);
+
+				for (double h_s : c.h_s)
+				{
+					std::vector<double> x_euler = fixed_step_final(RK4Stepper(euler, x0_euler.size()), x0_euler, TF_S, h_s);
+					std::vector<double> x_quat = fixed_step_final(RK4Stepper(quat, x0_quat.size()), x0_quat, TF_S, h_s);
+					std::vector<double> x_rkmk = fixed_step_final(RKMK4Stepper(quat, x0_quat.size()), x0_quat, TF_S, h_s);
+					std::array<double, 4> q_euler = euler_to_quaternion(x_euler[6], x_euler[7], x_euler[8]);
+
+					out << std::left << std::setw(20) << preset_name(preset) << std::setw(48) << c.name << std::right
+						<< std::setprecision(3) << std::setw(7) << h_s << std::scientific << std::setprecision(2)
+						<< std::setw(11) << attitude_error(q_euler, q_reference)
+						<< std::setw(16) << attitude_error(std::span<const double>(x_quat.data() + QUATERNION_INDEX, 4), q_reference)
+						<< std::setw(10) << attitude_error(std::span<const double>(x_rkmk.data() + QUATERNION_INDEX, 4), q_reference) << "\n";
+					out.flags(flags);
+				}
+			}
+		}
+		out.flags(flags);
+	}
+
+	// Largest difference relative to 1 + |reference|
+	double state_error(StridedView<const double> x, StridedView<const double> reference)
+	{
+		double error = 0.0;
+		for (std::size_t j = 0; j < reference.size(); ++j)
+		{
+			double e = std::abs(x[j] - reference[j]) / (1.0 + std::abs(reference[j]));
+			error = std::isnan(e) ? INFINITY : std::max(error, e);
+		}
+		return error;
+	}
+
+	// state_error over every time of two trajectories on the same clock
+	double trajectory_error(const Trajectory& x, const Trajectory& reference)
+	{
+		double error = 0.0;
+		for (std::size_t k = 0; k < reference.num_times(); ++k)
+		{
+			error = std::max(error, state_error(x.row(k), reference.row(k)));
+		}
+		return error;
+	}
+
+	// Gragg-Bulirsch-Stoer against Dormand-Prince and RK4 over 30 s of the
+	// check cases: RHS evaluations, and the error at 30 s and on a 7.3 Hz
+	// output clock (dense output) against GBS at tol 1e-15
+	void bench_gbs(std::ostream& out)
+	{
+		constexpr double TF_S = 30.0;
+		constexpr double H_RK4_S = 0.001;
+		constexpr double TOL = 1e-12;
+		const VehiclePreset presets[] = { VehiclePreset::NASA_Atmos01_Sphere, VehiclePreset::NASA_Atmos02_Brick, VehiclePreset::NASA_Atmos03_Brick };
+
+		std::vector<double> t_out = sample_times(0.0, TF_S, 7.3);
+		t_out.push_back(TF_S);
+
+		StepSizeControl control;
+		control.abs_tol = { TOL };
+		control.rel_tol = { TOL };
+		StepSizeControl reference_control;
+		reference_control.abs_tol = { 1e-15 };
+		reference_control.rel_tol = { 1e-15 };
+
+		out << "Extrapolation against Dormand-Prince and RK4, " << TF_S << " s (error relative to 1 + |x| against GBS at tol 1e-15):\n";
+		out << std::left << std::setw(22) << "preset" << std::setw(24) << "method" << std::right << std::setw(12) << "RHS evals"
+			<< std::setw(9) << "steps" << std::setw(14) << "error 30 s" << std::setw(14) << "error 7.3 Hz" << "\n";
+
+		std::ios_base::fmtflags flags = out.flags();
+		for (VehiclePreset preset : presets)
+		{
+			const VehicleParams vehicle = makeVehicle(preset);
+			const std::array<double, 12> initial = check_case_initial_state(preset);
+			const std::vector<double> x0(initial.begin(), initial.end());
+			FlatEarthRhs<> rhs{ vehicle };
+
+			GraggBulirschStoerStepper reference_stepper(rhs, 12, reference_control);
+			const Trajectory reference = integrate_adaptive_sampled(reference_stepper, 0.0, x0, t_out);
+
+			auto print = [&](const char* method, std::size_t rhs_evals, std::size_t steps, const Trajectory& x, bool sampled)
+			{
+				// Without dense output x holds the step ends, the last at 30 s
+				out << std::left << std::setw(22) << preset_name(preset) << std::setw(24) << method << std::right
+					<< std::setw(12) << rhs_evals << std::setw(9) << steps << std::scientific << std::setprecision(1)
+					<< std::setw(14) << state_error(x.row(x.num_times() - 1), reference.row(reference.num_times() - 1));
+				if (sampled)
+				{
+					out << std::setw(14) << trajectory_error(x, reference) << "\n";
+				}
+				else
+				{
+					out << std::setw(14) << "-" << "\n";
+				}
+				out.flags(flags);
+			};
+
+			RK4Stepper rk4(rhs, 12);
+			Trajectory rk4_x = integrate_sampled(rk4, 0.0, x0, H_RK4_S, t_out);
+			print("RK4, h = 0.001 s", rk4.rhs_evals(), rk4.steps(), rk4_x, true);
+
+			DormandPrince45Stepper dp45(rhs, 12, control);
+			Trajectory dp45_x = integrate_adaptive_sampled(dp45, 0.0, x0, t_out);
+			print("DP45, tol 1e-12", dp45.rhs_evals(), dp45.accepted_steps() + dp45.rejected_steps(), dp45_x, true);
+
+			GraggBulirschStoerStepper gbs(rhs, 12, control, false);
+			Trajectory gbs_x = integrate_adaptive(gbs, 0.0, x0, TF_S);
+			print("GBS, tol 1e-12", gbs.rhs_evals(), gbs.accepted_steps() + gbs.rejected_steps(), gbs_x, false);
+
+			GraggBulirschStoerStepper gbs_dense(rhs, 12, control, true);
+			Trajectory gbs_dense_x = integrate_adaptive_sampled(gbs_dense, 0.0, x0, t_out);
+			print("GBS dense, tol 1e-12", gbs_dense.rhs_evals(), gbs_dense.accepted_steps() + gbs_dense.rejected_steps(), gbs_dense_x, true);
+		}
+		out.flags(flags);
+	}
+
+	// The stiff case of the Rosenbrock and multirate sections: the Atmos03
+	// brick with its inertia divided by 1000, so the aerodynamic rate damping
+	// acts 1000x faster, thrown at 100 m/s from 500 m
+	VehicleParams light_brick()
+	{
+		VehicleParams vehicle = makeVehicle(VehiclePreset::NASA_Atmos03_Brick);
+		vehicle.Jxx_b_kgm2 /= 1000.0;
+		vehicle.Jyy_b_kgm2 /= 1000.0;
+		vehicle.Jzz_b_kgm2 /= 1000.0;
+		vehicle.Jxz_b_kgm2 /= 1000.0;
+		compileVehicle(vehicle);
+		return vehicle;
+	}
+
+	std::vector<double> light_brick_state()
+	{
+		std::array<double, 12> x0 = check_case_initial_state(VehiclePreset::NASA_Atmos03_Brick);
+		x0[0] = 100.0;
+		x0[11] = -500.0;
+		return std::vector<double>(x0.begin(), x0.end());
+	}
+
+	// RK4 over tf_s at h_s; false once a body rate passes 100 rad/s (diverged)
+	template <class Rhs>
+	bool rk4_stays_bounded(Rhs rhs, const std::vector<double>& x0, double tf_s, double h_s)
+	{
+		RK4Stepper stepper(rhs, x0.size());
+		std::vector<double> x = x0;
+		std::size_t nt = static_cast<std::size_t>(std::floor(tf_s / h_s + 0.5));
+		for (std::size_t i = 0; i < nt; ++i)
+		{
+			stepper.step(static_cast<double>(i) * h_s, x, h_s);
+			if (!(std::abs(x[3]) < 100.0 && std::abs(x[4]) < 100.0 && std::abs(x[5]) < 100.0))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Largest RK4 step that stays bounded, bisected between 1e-5 s and 0.1 s
+	template <class Rhs>
+	double rk4_stability_limit_s(Rhs rhs, const std::vector<double>& x0, double tf_s)
+	{
+		double stable = 1e-5;
+		double unstable = 0.1;
+		while (unstable - stable > 1e-3 * stable)
+		{
+			double h_s = std::sqrt(stable * unstable);
+			(rk4_stays_bounded(rhs, x0, tf_s, h_s) ? stable : unstable) = h_s;
+		}
+		return stable;
+	}
+
+	// RODAS3 with the analytic Jacobian on the light brick: steps, RHS
+	// evaluations and LU factorizations per tolerance, against the largest
+	// step at which RK4 stays stable. Error relative to 1 + |x| at 5 s,
+	// against RK4 at h = 1e-5 s.
+	void bench_stiff(std::ostream& out)
+	{
+		constexpr double TF_S = 5.0;
+		constexpr double H_REFERENCE_S = 1e-5;
+		const VehicleParams vehicle = light_brick();
+		const std::vector<double> x0 = light_brick_state();
+		FlatEarthRhs<> rhs{ vehicle };
+
+		std::array<double, 12> dx{};
+		std::array<double, 144> J{};
+		FlatEarthJacobian{ vehicle }(0.0, x0, dx, J);
+
+		std::vector<double> reference = x0;
+		RK4Stepper reference_stepper(rhs, 12);
+		std::size_t nt = static_cast<std::size_t>(std::floor(TF_S / H_REFERENCE_S + 0.5));
+		for (std::size_t i = 0; i < nt; ++i)
+		{
+			reference_stepper.step(static_cast<double>(i) * H_REFERENCE_S, reference, H_REFERENCE_S);
+		}
+
+		std::ios_base::fmtflags flags = out.flags();
+		out << "Atmos03 brick, inertia / 1000, 100 m/s at 500 m, " << TF_S << " s (error relative to 1 + |x| at "
+			<< TF_S << " s against RK4 h = " << H_REFERENCE_S << " s):\n";
+		out << "  roll and pitch damping at the start: dp'/dp = " << std::fixed << std::setprecision(0) << J[3 * 12 + 3]
+			<< " 1/s, dq'/dq = " << J[4 * 12 + 4] << " 1/s\n";
+		out.flags(flags);
+
+		double h_limit = rk4_stability_limit_s(rhs, x0, TF_S);
+		out << "  RK4 stays stable up to h = " << std::setprecision(3) << h_limit * 1e3 << " ms ("
+			<< static_cast<std::size_t>(std::ceil(4.0 * TF_S / h_limit)) << " RHS evaluations)\n";
+		out.flags(flags);
+
+		out << std::left << std::setw(18) << "method" << std::right << std::setw(10) << "accepted" << std::setw(10) << "rejected"
+			<< std::setw(11) << "RHS evals" << std::setw(11) << "Jacobians" << std::setw(6) << "LUs" << std::setw(11) << "error" << "\n";
+		for (double tol : { 1e-3, 1e-4, 1e-6 })
+		{
+			StepSizeControl control;
+			control.abs_tol = { tol };
+			control.rel_tol = { tol };
+
+			RosenbrockStepper stepper(rhs, FlatEarthJacobian{ vehicle }, 12, control);
+			std::vector<double> x = x0;
+			double t = 0.0;
+			while (t < TF_S)
+			{
+				t += stepper.step(t, x, TF_S);
+			}
+
+			out << std::left << std::setw(18) << ("RODAS3, tol 1e-" + std::to_string(std::lround(-std::log10(tol)))) << std::right
+				<< std::setw(10) << stepper.accepted_steps() << std::setw(10) << stepper.rejected_steps() << std::setw(11) << stepper.rhs_evals()
+				<< std::setw(11) << stepper.jacobian_evals() << std::setw(6) << stepper.lu_factorizations()
+				<< std::scientific << std::setprecision(1) << std::setw(11) << state_error(std::span<const double>(x), std::span<const double>(reference)) << "\n";
+			out.flags(flags);
+		}
+	}
+
+	// Error of a fixed-step stepper at h_s, on the output clock of reference
+	template <class Stepper>
+	double sampled_error(Stepper& stepper, const std::vector<double>& x0, double h_s, const Trajectory& reference)
+	{
+		std::vector<double> t_out(reference.times().begin(), reference.times().end());
+		return trajectory_error(integrate_sampled(stepper, 0.0, x0, h_s, t_out), reference);
+	}
+
+	// Largest RK4 step whose error on the reference clock is at most target,
+	// bisected between 1e-5 s and 0.1 s
+	template <class Rhs>
+	double rk4_step_for_error_s(Rhs rhs, const std::vector<double>& x0, const Trajectory& reference, double target)
+	{
+		double good = 1e-5;
+		double bad = 0.1;
+		while (bad - good > 1e-3 * good)
+		{
+			double h_s = std::sqrt(good * bad);
+			RK4Stepper stepper(rhs, x0.size());
+			(sampled_error(stepper, x0, h_s, reference) <= target ? good : bad) = h_s;
+		}
+		return good;
+	}
+
+	// MultirateRK4Stepper against single-rate RK4 on a 0.1 s output clock.
+	// Work counts fast-block evaluations at their measured cost relative to a
+	// full one; each multirate run is set against the largest RK4 step with the
+	// same error.
+	void bench_multirate(std::ostream& out)
+	{
+		struct Case
+		{
+			const char* name;
+			VehiclePreset preset;
+			VehicleParams vehicle;
+			std::vector<double> x0;
+			double tf_s;
+			double h_reference_s;
+			std::vector<double> rk4_steps_s;
+			std::vector<std::pair<double, std::size_t>> multirate_steps;   // H [s], substeps
+		};
+
+		const std::array<double, 12> atmos02 = check_case_initial_state(VehiclePreset::NASA_Atmos02_Brick);
+		const Case cases[] = {
+			{ "Atmos02 tumble, 30 s", VehiclePreset::NASA_Atmos02_Brick, makeVehicle(VehiclePreset::NASA_Atmos02_Brick), std::vector<double>(atmos02.begin(), atmos02.end()),
+				30.0, 0.0005, { 0.02 }, { { 0.02, 2 }, { 0.02, 8 } } },
+			{ "Atmos03, inertia / 1000, 5 s", VehiclePreset::NASA_Atmos03_Brick, light_brick(), light_brick_state(),
+				5.0, 1e-5, { 0.0007, 0.000625 }, { { 0.01, 16 }, { 0.005, 8 }, { 0.02, 24 } } }
+		};
+
+		out << "Multirate RK4 (rates and attitude substepped) against single-rate RK4, error relative to 1 + |x| on a 0.1 s clock:\n";
+		std::ios_base::fmtflags flags = out.flags();
+		for (const Case& c : cases)
+		{
+			FlatEarthRhs<> rhs{ c.vehicle };
+			FlatEarthRotationalRhs<> rotational{ c.vehicle };
+
+			const std::vector<std::array<double, 12>> states = sample_states(c.preset, 64);
+			double full_ns = ns_per_eval([&](double t, std::span<const double> x, std::span<double, 12> dx) { rhs(t, x, dx); }, states, 1000000);
+			double fast_ns = ns_per_eval([&](double t, std::span<const double> x, std::span<double, 12> dx) { rotational(t, x, dx); }, states, 1000000);
+			double fast_cost = fast_ns / full_ns;
+
+			RK4Stepper reference_stepper(rhs, 12);
+			const Trajectory reference = integrate_sampled(reference_stepper, 0.0, c.x0, c.h_reference_s, sample_times(0.0, c.tf_s, 10.0));
+
+			out << c.name << " (fast evaluation = " << std::fixed << std::setprecision(2) << fast_cost << " full; RK4 h = "
+				<< std::defaultfloat << c.h_reference_s << " s reference)\n";
+			out.flags(flags);
+			out << std::left << std::setw(34) << "  method" << std::right << std::setw(12) << "full evals" << std::setw(12) << "fast evals"
+				<< std::setw(10) << "work" << std::setw(10) << "error" << std::setw(22) << "RK4 at same error" << std::setw(9) << "saving" << "\n";
+
+			for (double h_s : c.rk4_steps_s)
+			{
+				RK4Stepper stepper(rhs, 12);
+				double error = sampled_error(stepper, c.x0, h_s, reference);
+				std::string method = "  RK4, h = " + std::to_string(h_s * 1e3).substr(0, 5) + " ms";
+				out << std::left << std::setw(34) << method << std::right << std::setw(12) << stepper.rhs_evals() << std::setw(12) << "-"
+					<< std::setw(10) << stepper.rhs_evals() << std::scientific << std::setprecision(1) << std::setw(10) << error << "\n";
+				out.flags(flags);
+			}
+
+			for (const auto& [h_s, substeps] : c.multirate_steps)
+			{
+				MultirateRK4Stepper stepper(rhs, rotational, 12, substeps);
+				double error = sampled_error(stepper, c.x0, h_s, reference);
+				double work = static_cast<double>(stepper.rhs_evals()) + fast_cost * static_cast<double>(stepper.fast_rhs_evals());
+
+				double h_rk4 = rk4_step_for_error_s(rhs, c.x0, reference, error);
+				RK4Stepper rk4(rhs, 12);
+				sampled_error(rk4, c.x0, h_rk4, reference);
+
+				std::string method = "  multirate, H = " + std::to_string(h_s * 1e3).substr(0, 4) + " ms, k = " + std::to_string(substeps);
+				std::string equal = std::to_string(rk4.rhs_evals()) + " (h = " + std::to_string(h_rk4 * 1e3).substr(0, 5) + " ms)";
+				out << std::left << std::setw(34) << method << std::right << std::setw(12) << stepper.rhs_evals() << std::setw(12) << stepper.fast_rhs_evals()
+					<< std::fixed << std::setprecision(0) << std::setw(10) << work << std::scientific << std::setprecision(1) << std::setw(10) << error
+					<< std::setw(22) << equal << std::fixed << std::setprecision(2) << std::setw(8) << static_cast<double>(rk4.rhs_evals()) / work << "x\n";
+				out.flags(flags);
+			}
+		}
+	}
+
+	// Analytic Jacobian (RHS included) against FiniteDifferenceJacobian, which
+	// takes 13 RHS evaluations, per preset with the presets' own terms
+	void bench_jacobian(std::ostream& out)
+	{
+		constexpr std::size_t NUM_EVALS = 200000;
+		const VehiclePreset presets[] = { VehiclePreset::NASA_Atmos01_Sphere, VehiclePreset::NASA_Atmos02_Brick, VehiclePreset::NASA_Atmos03_Brick };
+
+		out << "12x12 Jacobian with the RHS, analytic against forward differences (" << NUM_EVALS << " evaluations):\n";
+		out << std::left << std::setw(22) << "preset" << std::right << std::setw(18) << "analytic [ns]"
+			<< std::setw(24) << "finite difference [ns]" << std::setw(10) << "speedup" << "\n";
+
+		std::ios_base::fmtflags flags = out.flags();
+		for (VehiclePreset preset : presets)
+		{
+			const VehicleParams vehicle = makeVehicle(preset);
+			const std::vector<std::array<double, 12>> states = sample_states(preset, 64);
+
+			std::array<double, 144> J{};
+			FlatEarthJacobian analytic{ vehicle };
+			FiniteDifferenceJacobian finite_difference(FlatEarthRhs<>{ vehicle }, 12);
+
+			auto run_analytic = [&](double t, std::span<const double> x, std::span<double, 12> dx) { analytic(t, x, dx, J); };
+			auto run_finite_difference = [&](double t, std::span<const double> x, std::span<double, 12> dx) { finite_difference(t, x, dx, J); };
+
+			double analytic_ns = ns_per_eval(run_analytic, states, NUM_EVALS);
+			double finite_difference_ns = ns_per_eval(run_finite_difference, states, NUM_EVALS);
+
+			out << std::left << std::setw(22) << preset_name(preset) << std::right << std::fixed << std::setprecision(0)
+				<< std::setw(18) << analytic_ns << std::setw(24) << finite_difference_ns
+				<< std::setprecision(1) << std::setw(9) << finite_difference_ns / analytic_ns << "x\n";
+		}
+		out.flags(flags);
+	}
+
+	// How far the float32 ensemble path drifts from double on the NASA check
+	// cases, on the simulator's 30 s, h = 0.01 s run
+	void bench_float(std::ostream& out)
+	{
+		print_float_divergence_report(out, 30.0, 0.01);
+	}
+
+	// RHS evaluations per second with libm and with fast_math.h trigonometry,
+	// both instantiated here whatever FLAT_EARTH_FAST_TRIG says
+	void bench_trig(std::ostream& out)
+	{
+		constexpr std::size_t NUM_EVALS = 2000000;
+		const VehiclePreset presets[] = { VehiclePreset::NASA_Atmos01_Sphere, VehiclePreset::NASA_Atmos02_Brick, VehiclePreset::NASA_Atmos03_Brick };
+
+		out << "Scalar RHS evaluations per second, LibmTrig against FastTrig (" << NUM_EVALS << " evaluations):\n";
+		out << std::left << std::setw(22) << "preset" << std::right << std::setw(16) << "libm [M/s]"
+			<< std::setw(16) << "fast [M/s]" << std::setw(10) << "speedup" << "\n";
+
+		std::ios_base::fmtflags flags = out.flags();
+		for (VehiclePreset preset : presets)
+		{
+			const VehicleParams vehicle = makeVehicle(preset);
+			const std::vector<std::array<double, 12>> states = sample_states(preset, 64);
+
+			FlatEarthRhs<ConstantDragForces, BrickDampingMoments, GeneralInertia, BasicEulerAttitude<LibmTrig>> libm{ vehicle };
+			FlatEarthRhs<ConstantDragForces, BrickDampingMoments, GeneralInertia, BasicEulerAttitude<FastTrig>> fast{ vehicle };
+
+			double libm_meps = 1e3 / ns_per_eval(libm, states, NUM_EVALS);
+			double fast_meps = 1e3 / ns_per_eval(fast, states, NUM_EVALS);
+
+			out << std::left << std::setw(22) << preset_name(preset) << std::right << std::fixed << std::setprecision(1)
+				<< std::setw(16) << libm_meps << std::setw(16) << fast_meps
+				<< std::setprecision(2) << std::setw(9) << fast_meps / libm_meps << "x\n";
+		}
+		out.flags(flags);
+	}
+
+	// Parareal against serial RK4 on the check cases, one slice per core: the
+	// 40 s, h = 0.001 s run of the README table
+	void bench_parareal(std::ostream& out)
+	{
+		PararealOptions options;
+		options.slices = 16;
+		options.h_coarse_s = 0.05;
+		print_parareal_report(out, 40.0, 0.001, options);
+	}
+
+	// Ratio and throughput of the .fetraj channel codecs on the check cases:
+	// the 40 s, h = 0.001 s run of the README table
+	void bench_compression(std::ostream& out)
+	{
+		print_compression_report(out, 40.0, 0.001);
+	}
+
+	struct Section
+	{
+		const char* name;
+		void (*run)(std::ostream& out);
+	};
+
+	constexpr Section SECTIONS[] = {
+		{ "dispatch", bench_dispatch },
+		{ "quaternion", bench_quaternion },
+		{ "rkmk", bench_rkmk },
+		{ "jacobian", bench_jacobian },
+		{ "float", bench_float },
+		{ "trig", bench_trig },
+		{ "parareal", bench_parareal },
+		{ "compression", bench_compression },
+		{ "gbs", bench_gbs },
+		{ "stiff", bench_stiff },
+		{ "multirate", bench_multirate }
+	};
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<const Section*> selected;
+	for (int k = 1; k < argc; ++k)
+	{
+		const Section* match = nullptr;
+		for (const Section& section : SECTIONS)
+		{
+			if (std::strcmp(argv[k], section.name) == 0)
+			{
+				match = &section;
+			}
+		}
+		if (match == nullptr)
+		{
+			std::cerr << "flat_earth_bench: unknown section '" << argv[k] << "'; sections are:";
+			for (const Section& section : SECTIONS)
+			{
+				std::cerr << " " << section.name;
+			}
+			std::cerr << "\n";
+			return 1;
+		}
+		selected.push_back(match);
+	}
+
+	if (selected.empty())
+	{
+		for (const Section& section : SECTIONS)
+		{
+			selected.push_back(&section);
+		}
+	}
+
+	for (const Section* section : selected)
+	{
+		section->run(std::cout);
+		std::cout << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,205 @@
+#pragma once
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include "scalar_traits.h"
+
+/*  Forward-mode dual number carrying N derivative directions.
+
+	Dual<double, N> holds a value v and the gradient d = dv/dp for N seeded
+	parameters p. Every operation updates all N directions with the same scalar
+	chain-rule factor, so the inner loops run over a fixed-size std::array and
+	vectorize: propagating K sensitivities costs one pass with K-wide arithmetic
+	instead of K + 1 separate simulations.
+
+	Only the operations the EoM, USSA1976 and the moment helpers use are provided.
+	Comparisons look at the value only, so branches (troposphere/stratosphere,
+	airspeed cut-offs) follow the nominal trajectory.
+*/
+
+template <class T, std::size_t N>
+struct Dual
+{
+	T v{};
+	std::array<T, N> d{};
+
+	Dual() = default;
+	Dual(T value) : v(value) {}
+	Dual(T value, const std::array<T, N>& derivatives) : v(value), d(derivatives) {}
+
+	// Dual seeded with unit derivative in direction k
+	static Dual variable(T value, std::size_t k)
+	{
+		Dual x(value);
+		x.d[k] = T(1);
+		return x;
+	}
+
+	Dual& operator+=(const Dual& b) { v += b.v; for (std::size_t k = 0; k < N; ++k) d[k] += b.d[k]; return *this; }
+	Dual& operator-=(const Dual& b) { v -= b.v; for (std::size_t k = 0; k < N; ++k) d[k] -= b.d[k]; return *this; }
+	Dual& operator*=(const Dual& b) { *this = *this * b; return *this; }
+	Dual& operator/=(const Dual& b) { *this = *this / b; return *this; }
+};
+
+template <class T, std::size_t N>
+struct scalar_traits<Dual<T, N>>
+{
+	using scalar = T;
+};
+
+// Applies the chain rule with scalar factor f'(a.v)
+template <class T, std::size_t N>
+Dual<T, N> dual_chain(const Dual<T, N>& a, T value, T derivative)
+{
+	Dual<T, N> r(value);
+	for (std::size_t k = 0; k < N; ++k)
+	{
+		r.d[k] = derivative * a.d[k];
+	}
+	return r;
+}
+
+template <class T, std::size_t N>
+Dual<T, N> operator-(const Dual<T, N>& a)
+{
+	return dual_chain(a, -a.v, T(-1));
+}
+
+template <class T, std::size_t N>
+Dual<T, N> operator+(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+	Dual<T, N> r(a.v + b.v);
+	for (std::size_t k = 0; k < N; ++k)
+	{
+		r.d[k] = a.d[k] + b.d[k];
+	}
+	return r;
+}
+
+template <class T, std::size_t N>
+Dual<T, N> operator-(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+	Dual<T, N> r(a.v - b.v);
+	for (std::size_t k = 0; k < N; ++k)
+	{
+		r.d[k] = a.d[k] - b.d[k];
+	}
+	return r;
+}
+
+template <class T, std::size_t N>
+Dual<T, N> operator*(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+	Dual<T, N> r(a.v * b.v);
+	for (std::size_t k = 0; k < N; ++k)
+	{
+		r.d[k] = a.d[k] * b.v + a.v * b.d[k];
+	}
+	return r;
+}
+
+template <class T, std::size_t N>
+Dual<T, N> operator/(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+	T inv_b = T(1) / b.v;
+	T q = a.v * inv_b;
+	Dual<T, N> r(q);
+	for (std::size_t k = 0; k < N; ++k)
+	{
+		r.d[k] = (a.d[k] - q * b.d[k]) * inv_b;
+	}
+	return r;
+}
+
+// Mixed dual/scalar arithmetic
+template <class T, std::size_t N> Dual<T, N> operator+(const Dual<T, N>& a, T b) { Dual<T, N> r = a; r.v += b; return r; }
+template <class T, std::size_t N> Dual<T, N> operator+(T a, const Dual<T, N>& b) { return b + a; }
+template <class T, std::size_t N> Dual<T, N> operator-(const Dual<T, N>& a, T b) { Dual<T, N> r = a; r.v -= b; return r; }
+template <class T, std::size_t N> Dual<T, N> operator-(T a, const Dual<T, N>& b) { return -b + a; }
+template <class T, std::size_t N> Dual<T, N> operator*(const Dual<T, N>& a, T b) { return dual_chain(a, a.v * b, b); }
+template <class T, std::size_t N> Dual<T, N> operator*(T a, const Dual<T, N>& b) { return b * a; }
+template <class T, std::size_t N> Dual<T, N> operator/(const Dual<T, N>& a, T b) { return a * (T(1) / b); }
+template <class T, std::size_t N> Dual<T, N> operator/(T a, const Dual<T, N>& b) { return Dual<T, N>(a) / b; }
+
+// Comparisons act on the value
+template <class T, std::size_t N> bool operator<(const Dual<T, N>& a, const Dual<T, N>& b) { return a.v < b.v; }
+template <class T, std::size_t N> bool operator>(const Dual<T, N>& a, const Dual<T, N>& b) { return a.v > b.v; }
+template <class T, std::size_t N> bool operator<=(const Dual<T, N>& a, const Dual<T, N>& b) { return a.v <= b.v; }
+template <class T, std::size_t N> bool operator>=(const Dual<T, N>& a, const Dual<T, N>& b) { return a.v >= b.v; }
+template <class T, std::size_t N> bool operator==(const Dual<T, N>& a, const Dual<T, N>& b) { return a.v == b.v; }
+template <class T, std::size_t N> bool operator<(const Dual<T, N>& a, T b) { return a.v < b; }
+template <class T, std::size_t N> bool operator>(const Dual<T, N>& a, T b) { return a.v > b; }
+template <class T, std::size_t N> bool operator<=(const Dual<T, N>& a, T b) { return a.v <= b; }
+template <class T, std::size_t N> bool operator>=(const Dual<T, N>& a, T b) { return a.v >= b; }
+template <class T, std::size_t N> bool operator==(const Dual<T, N>& a, T b) { return a.v == b; }
+
+// Elementary functions, found by argument-dependent lookup from generic code
+template <class T, std::size_t N>
+Dual<T, N> sin(const Dual<T, N>& a) { return dual_chain(a, std::sin(a.v), std::cos(a.v)); }
+
+template <class T, std::size_t N>
+Dual<T, N> cos(const Dual<T, N>& a) { return dual_chain(a, std::cos(a.v), -std::sin(a.v)); }
+
+template <class T, std::size_t N>
+Dual<T, N> tan(const Dual<T, N>& a)
+{
+	T t = std::tan(a.v);
+	return dual_chain(a, t, T(1) + t * t);
+}
+
+template <class T, std::size_t N>
+Dual<T, N> sqrt(const Dual<T, N>& a)
+{
+	T s = std::sqrt(a.v);
+	// d(sqrt)/da is unbounded at 0; report zero there so V = 0 stays finite
+	return dual_chain(a, s, s > T(0) ? T(0.5) / s : T(0));
+}
+
+template <class T, std::size_t N>
+Dual<T, N> exp(const Dual<T, N>& a)
+{
+	T e = std::exp(a.v);
+	return dual_chain(a, e, e);
+}
+
+template <class T, std::size_t N>
+Dual<T, N> pow(const Dual<T, N>& a, T b)
+{
+	T p = std::pow(a.v, b);
+	return dual_chain(a, p, b * std::pow(a.v, b - T(1)));
+}
+
+template <class T, std::size_t N>
+Dual<T, N> asin(const Dual<T, N>& a)
+{
+	return dual_chain(a, std::asin(a.v), T(1) / std::sqrt(T(1) - a.v * a.v));
+}
+
+template <class T, std::size_t N>
+Dual<T, N> atan2(const Dual<T, N>& y, const Dual<T, N>& x)
+{
+	T r2 = x.v * x.v + y.v * y.v;
+	Dual<T, N> r(std::atan2(y.v, x.v));
+	if (r2 > T(0))
+	{
+		for (std::size_t k = 0; k < N; ++k)
+		{
+			r.d[k] = (x.v * y.d[k] - y.v * x.d[k]) / r2;
+		}
+	}
+	return r;
+}
+
+template <class T, std::size_t N>
+Dual<T, N> abs(const Dual<T, N>& a) { return a.v < T(0) ? -a : a; }
+
+// Value part of a scalar or dual, for output and logging
+inline double dual_value(double a) { return a; }
+
+template <class T, std::size_t N>
+T dual_value(const Dual<T, N>& a) { return a.v; }
+
+#endif // DUAL_H
@@ -0,0 +1,216 @@
+#pragma once
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+/*  Branch-free trigonometry for the EoM hot path.
+
+	fast_sincos, fast_atan2 and fast_asin are written with selects instead of
+	branches and without table lookups, so loops over lanes (the batched EoM
+	pre-pass, ensemble members) auto-vectorize and the scalar kernel avoids the
+	libm call overhead. Coefficients are the fdlibm / Cephes minimax sets.
+
+	Maximum error against a long double libm reference, the largest over 4 x
+	1e7 random points per range rounded up (atan2 over magnitudes 1e-4 to 1e4;
+	tests/test_fast_math.cpp checks these bounds):
+
+		function                      double      float
+		fast_sincos  |x| <= 4         1.5 ulp     1.6 ulp
+		fast_sincos  |x| <= 1e5       2.5 ulp     -
+		fast_sincos  |x| <= 1e3       -           1.6 ulp
+		fast_atan2                    1.8 ulp     3.2 ulp
+		fast_asin                     2.6 ulp     3.8 ulp
+
+	The quadrant reduction is exact while |x| * 2 / pi < 2^20, well past any
+	Euler angle the integrators produce.
+
+	LibmTrig and FastTrig bundle the functions as a policy for the EoM kernel's
+	attitude frame. DefaultTrig is FastTrig when FLAT_EARTH_FAST_TRIG is defined
+	(CMake option of the same name) and LibmTrig otherwise. Types other than
+	float and double (Dual numbers) always go through the std functions.
+*/
+
+namespace fast_math_detail
+{
+	// Round to nearest integer without a libm call: adding and subtracting
+	// 1.5 * 2^52 (2^23 for float) drops the fraction bits
+	inline double round_nearest(double x) { return (x + 0x1.8p52) - 0x1.8p52; }
+	inline float round_nearest(float x) { return (x + 0x1.8p23f) - 0x1.8p23f; }
+
+	inline std::int64_t quadrant(double n) { return static_cast<std::int64_t>(n); }
+	inline std::int32_t quadrant(float n) { return static_cast<std::int32_t>(n); }
+}
+
+// Sine and cosine of x together, sharing one range reduction
+template <class T>
+inline void fast_sincos(T x, T& s, T& c)
+{
+	static_assert(std::is_floating_point_v<T>, "fast_sincos needs float or double");
+
+	T n = fast_math_detail::round_nearest(x * T(0.636619772367581343076));  // 2 / pi
+	auto q = fast_math_detail::quadrant(n);
+
+	T r;
+	T z;
+	T sin_r;
+	T cos_r;
+
+	if constexpr (std::is_same_v<T, float>)
+	{
+		// Reduce in double: a float split of pi/2 loses the low bits of r next to
+		// the zeros of sin and cos
+		double n_d = static_cast<double>(n);
+		r = static_cast<float>((static_cast<double>(x) - n_d * 1.57079632673412561417e+00) - n_d * 6.07710050650619224932e-11);
+		z = r * r;
+		sin_r = r + r * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+		cos_r = 1.0f - 0.5f * z + z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f));
+	}
+	else
+	{
+		// Three-term Cody-Waite split: the first two products are exact for |n| < 2^20
+		r = ((x - n * 1.57079632673412561417e+00) - n * 6.07710050630396597660e-11) - n * 2.02226624879595063154e-21;
+		z = r * r;
+		sin_r = r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04 +
+			z * (2.75573137070700676789e-06 + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+
+		// fdlibm's split of 1 - z / 2 keeps the cosine within 1 ulp near pi / 4
+		T hz = 0.5 * z;
+		T w = 1.0 - hz;
+		T tail = z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * (2.48015872894767294178e-05 +
+			z * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+		cos_r = w + (((1.0 - w) - hz) + tail);
+	}
+
+	// Quadrant q: odd quadrants swap sin and cos, quadrants 2 and 3 negate sin,
+	// quadrants 1 and 2 negate cos
+	bool swap = (q & 1) != 0;
+	T s_abs = swap ? cos_r : sin_r;
+	T c_abs = swap ? sin_r : cos_r;
+	s = (q & 2) != 0 ? -s_abs : s_abs;
+	c = ((q + 1) & 2) != 0 ? -c_abs : c_abs;
+}
+
+// atan(t) for t in [0, 1]
+template <class T>
+inline T fast_atan_unit(T t)
+{
+	if constexpr (std::is_same_v<T, float>)
+	{
+		// Reduce t > tan(pi / 8) with atan(t) = pi / 4 + atan((t - 1) / (t + 1))
+		bool reduce = t > 0.4142135623730950f;
+		T x = reduce ? (t - 1.0f) / (t + 1.0f) : t;
+		T z = x * x;
+		T y = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f) * z * x + x;
+		return reduce ? y + 0.7853981633974483f : y;
+	}
+	else
+	{
+		// Reduce t > 0.66 with atan(t) = pi / 4 + atan((t - 1) / (t + 1)); pi / 4 is
+		// split in two so the sum stays correctly rounded
+		bool reduce = t > 0.66;
+		T x = reduce ? (t - 1.0) / (t + 1.0) : t;
+		T z = x * x;
+		T p = (((-8.750608600031904122785e-1 * z - 1.615753718733365076637e1) * z - 7.500855792314704667340e1) * z -
+			1.228866684490136173410e2) * z - 6.485021904942025371773e1;
+		T q = ((((z + 2.485846490142306297962e1) * z + 1.650270098316988542046e2) * z + 4.328810604912902668951e2) * z +
+			4.853903996359136964868e2) * z + 1.945506571482613964425e2;
+		T y = x * (z * p / q) + x;
+		return reduce ? 7.85398163397448309616e-1 + (y + 3.061616997868382943065e-17) : y;
+	}
+}
+
+// Four-quadrant arctangent of y / x; returns 0 for (0, 0) like std::atan2
+template <class T>
+inline T fast_atan2(T y, T x)
+{
+	static_assert(std::is_floating_point_v<T>, "fast_atan2 needs float or double");
+
+	const T pi = T(3.14159265358979323846);
+	const T half_pi = T(1.57079632679489661923);
+
+	T ax = std::abs(x);
+	T ay = std::abs(y);
+	T hi = ax > ay ? ax : ay;
+	T lo = ax > ay ? ay : ax;
+
+	// Ratio in [0, 1]; 0 / 0 at the origin is replaced by 0
+	T t = hi > T(0) ? lo / hi : T(0);
+	T a = fast_atan_unit(t);
+
+	a = ay > ax ? half_pi - a : a;
+	a = x < T(0) ? pi - a : a;
+	return std::signbit(y) ? -a : a;
+}
+
+// Arcsine through asin(x) = atan2(x, sqrt((1 - x)(1 + x))); the factored form
+// keeps full precision near |x| = 1
+template <class T>
+inline T fast_asin(T x)
+{
+	static_assert(std::is_floating_point_v<T>, "fast_asin needs float or double");
+
+	return fast_atan2(x, std::sqrt((T(1) - x) * (T(1) + x)));
+}
+
+
+// Trigonometry policies for the EoM kernel
+
+struct LibmTrig
+{
+	template <class T>
+	static void sincos(T x, T& s, T& c)
+	{
+		using std::sin;
+		using std::cos;
+		s = sin(x);
+		c = cos(x);
+	}
+
+	template <class T>
+	static T tan(T x, T, T)
+	{
+		using std::tan;
+		return tan(x);
+	}
+};
+
+struct FastTrig
+{
+	template <class T>
+	static void sincos(T x, T& s, T& c)
+	{
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			fast_sincos(x, s, c);
+		}
+		else
+		{
+			LibmTrig::sincos(x, s, c);
+		}
+	}
+
+	// tan from the sine and cosine already computed, instead of a third evaluation
+	template <class T>
+	static T tan(T x, T s, T c)
+	{
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			return s / c;
+		}
+		else
+		{
+			return LibmTrig::tan(x, s, c);
+		}
+	}
+};
+
+#ifdef FLAT_EARTH_FAST_TRIG
+using DefaultTrig = FastTrig;
+#else
+using DefaultTrig = LibmTrig;
+#endif
+
+#endif // FAST_MATH_H
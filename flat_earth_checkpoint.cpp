@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "flat_earth_checkpoint.h"
+#include "flat_earth_eom_kernel.h"
+#include "integrator_checkpoint.h"
+
+namespace
+{
+	void add_sorted(ParameterHash& hash, const std::unordered_map<std::string, double>& map)
+	{
+		std::vector<std::pair<std::string, double>> entries(map.begin(), map.end());
+		std::sort(entries.begin(), entries.end());
+
+		hash.add(static_cast<double>(entries.size()));
+		for (const auto& [key, value] : entries)
+		{
+			hash.add(key).add(value);
+		}
+	}
+}
+
+std::uint64_t flat_earth_parameter_hash(const VehicleParams& vehicle)
+{
+	ParameterHash hash;
+	hash.add("flat_earth_eom_kernel");
+	hash.add("USSA1976").add("ConstantGravity").add(ConstantGravity::gz_n_mps2);
+
+	hash.add(vehicle.m_kg).add(vehicle.Jxx_b_kgm2).add(vehicle.Jyy_b_kgm2).add(vehicle.Jzz_b_kgm2).add(vehicle.Jxz_b_kgm2);
+	hash.add(vehicle.Aref_m2).add(vehicle.b_m).add(vehicle.c_m);
+	hash.add(vehicle.CD_approx).add(vehicle.Clp).add(vehicle.Clr).add(vehicle.Cmq).add(vehicle.Cnp).add(vehicle.Cnr);
+	return hash.value();
+}
+
+std::uint64_t flat_earth_parameter_hash(const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double>& airmod)
+{
+	ParameterHash hash;
+	hash.add("flat_earth_eom");
+	add_sorted(hash, amod);
+	add_sorted(hash, airmod);
+	return hash.value();
+}
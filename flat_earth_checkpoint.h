@@ -0,0 +1,20 @@
+#pragma once
+#ifndef FLAT_EARTH_CHECKPOINT_H
+#define FLAT_EARTH_CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "spheres.h"
+
+// Hash of what a flat-earth run depends on besides its state, for
+// CheckpointOptions::parameter_hash: the raw vehicle fields (the derived ones
+// follow from them) and the environment of FlatEarthRhs (USSA1976, constant
+// gravity). Bit patterns are hashed, so any change to a parameter changes it.
+std::uint64_t flat_earth_parameter_hash(const VehicleParams& vehicle);
+
+// The same for the map-based flat_earth_eom: every amod and airmod entry, in
+// key order
+std::uint64_t flat_earth_parameter_hash(const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double>& airmod);
+
+#endif // FLAT_EARTH_CHECKPOINT_H
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include "flat_earth_compression.h"
+#include "flat_earth_ensemble.h"
+#include "flat_earth_eom_kernel.h"
+#include "numerical_integration_methods.h"
+
+namespace
+{
+	constexpr int REPEATS = 3;
+
+	double elapsed_s(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	const char* codec_name(ColumnCodec codec)
+	{
+		switch (codec)
+		{
+		case ColumnCodec::None:
+			return "raw";
+		case ColumnCodec::Gorilla:
+			return "Gorilla";
+		case ColumnCodec::QuantizedDelta:
+			return "QuantizedDelta";
+		}
+		return "?";
+	}
+
+	// Codes every channel of a ChannelMajor trajectory block by block
+	CompressionResult measure(VehiclePreset preset, const Trajectory& trajectory, ColumnCodec codec, double max_error, std::size_t block_samples)
+	{
+		std::size_t nt = trajectory.num_times();
+		std::vector<std::vector<std::byte>> blocks;
+		std::vector<double> decoded(nt);
+
+		double encode_s = std::numeric_limits<double>::infinity();
+		double decode_s = std::numeric_limits<double>::infinity();
+		std::size_t encoded_bytes = 0;
+
+		for (int repeat = 0; repeat < REPEATS; ++repeat)
+		{
+			blocks.clear();
+			auto start = std::chrono::steady_clock::now();
+			for (std::size_t j = 0; j < trajectory.num_states(); ++j)
+			{
+				std::span<const double> channel = trajectory.channel(j).span();
+				for (std::size_t first = 0; first < nt; first += block_samples)
+				{
+					blocks.emplace_back();
+					encode_block(codec, channel.subspan(first, std::min(block_samples, nt - first)), max_error, blocks.back());
+				}
+			}
+			encode_s = std::min(encode_s, elapsed_s(start));
+
+			start = std::chrono::steady_clock::now();
+			std::size_t b = 0;
+			for (std::size_t j = 0; j < trajectory.num_states(); ++j)
+			{
+				for (std::size_t first = 0; first < nt; first += block_samples)
+				{
+					std::size_t count = std::min(block_samples, nt - first);
+					decode_block(codec, blocks[b++], max_error, std::span<double>(decoded).subspan(first, count));
+				}
+			}
+			decode_s = std::min(decode_s, elapsed_s(start));
+		}
+
+		CompressionResult result{};
+		result.preset = preset;
+		result.codec = codec;
+		result.max_error_bound = codec == ColumnCodec::QuantizedDelta ? max_error : 0.0;
+
+		// Error check, outside the timed loops
+		std::size_t b = 0;
+		for (std::size_t j = 0; j < trajectory.num_states(); ++j)
+		{
+			StridedView<const double> channel = trajectory.channel(j);
+			for (std::size_t first = 0; first < nt; first += block_samples)
+			{
+				std::size_t count = std::min(block_samples, nt - first);
+				encoded_bytes += blocks[b].size();
+				decode_block(codec, blocks[b++], max_error, std::span<double>(decoded).subspan(first, count));
+			}
+			for (std::size_t k = 0; k < nt; ++k)
+			{
+				result.max_error = std::max(result.max_error, std::abs(decoded[k] - channel[k]));
+			}
+		}
+
+		double raw_bytes = static_cast<double>(nt * trajectory.num_states() * sizeof(double));
+		result.ratio = raw_bytes / static_cast<double>(encoded_bytes);
+		result.encode_gbps = raw_bytes / encode_s * 1e-9;
+		result.decode_gbps = raw_bytes / decode_s * 1e-9;
+		return result;
+	}
+}
+
+std::vector<CompressionResult> compression_report(double tf_s, double h_s, const std::vector<double>& max_errors, std::size_t block_samples)
+{
+	/*  Arguments:
+
+		tf_s - final time [s]
+
+		h_s - RK4 step and output spacing [s]
+
+		max_errors - QuantizedDelta bounds to try, in each channel's units
+
+		block_samples - samples per coded block
+	*/
+
+	std::size_t nt = static_cast<std::size_t>(std::floor(tf_s / h_s + 0.5)) + 1;
+	std::vector<double> t_s(nt);
+	for (std::size_t i = 0; i < nt; ++i)
+	{
+		t_s[i] = static_cast<double>(i) * h_s;
+	}
+
+	std::vector<CompressionResult> report;
+
+	for (VehiclePreset preset : { VehiclePreset::NASA_Atmos01_Sphere, VehiclePreset::NASA_Atmos02_Brick, VehiclePreset::NASA_Atmos03_Brick })
+	{
+		VehicleParams vehicle = makeVehicle(preset);
+		FlatEarthRhs<> f{ vehicle };
+		std::array<double, 12> x0_array = check_case_initial_state(preset);
+		std::vector<double> x0(x0_array.begin(), x0_array.end());
+
+		Trajectory trajectory(x0.size(), t_s);
+		trajectory.set_row(0, x0);
+		RK4Stepper stepper(f, x0.size());
+		integrate(stepper, trajectory, h_s);
+
+		// The codecs run per channel, as in a version 2 .fetraj file
+		const Trajectory channels = trajectory.with_layout(TrajectoryLayout::ChannelMajor);
+
+		report.push_back(measure(preset, channels, ColumnCodec::Gorilla, 0.0, block_samples));
+		for (double max_error : max_errors)
+		{
+			report.push_back(measure(preset, channels, ColumnCodec::QuantizedDelta, max_error, block_samples));
+		}
+	}
+
+	return report;
+}
+
+void print_compression_report(std::ostream& out, double tf_s, double h_s, const std::vector<double>& max_errors)
+{
+	std::vector<CompressionResult> report = compression_report(tf_s, h_s, max_errors);
+
+	out << "Trajectory compression, RK4 h = " << h_s << " s, " << tf_s << " s, 12 channels:\n";
+	out << std::left << std::setw(22) << "preset" << std::setw(16) << "codec" << std::right
+		<< std::setw(10) << "bound" << std::setw(8) << "ratio" << std::setw(14) << "encode [GB/s]"
+		<< std::setw(14) << "decode [GB/s]" << std::setw(12) << "max error" << "\n";
+
+	std::ios_base::fmtflags flags = out.flags();
+	for (const CompressionResult& result : report)
+	{
+		out << std::left << std::setw(22) << preset_name(result.preset) << std::setw(16) << codec_name(result.codec) << std::right
+			<< std::scientific << std::setprecision(0) << std::setw(10);
+		if (result.max_error_bound > 0.0)
+		{
+			out << result.max_error_bound;
+		}
+		else
+		{
+			out << "lossless";
+		}
+		out << std::fixed << std::setprecision(1) << std::setw(8) << result.ratio
+			<< std::setprecision(2) << std::setw(14) << result.encode_gbps << std::setw(14) << result.decode_gbps
+			<< std::scientific << std::setprecision(2) << std::setw(12) << result.max_error << "\n";
+	}
+	out.flags(flags);
+}
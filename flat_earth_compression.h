@@ -0,0 +1,32 @@
+#pragma once
+#ifndef FLAT_EARTH_COMPRESSION_H
+#define FLAT_EARTH_COMPRESSION_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+#include "spheres.h"
+#include "trajectory_codec.h"
+
+// One codec on the 12 state channels of one check case
+struct CompressionResult
+{
+	VehiclePreset preset;
+	ColumnCodec codec;
+	double max_error_bound;       // QuantizedDelta bound; 0 for lossless
+	double ratio;                 // raw bytes / encoded bytes
+	double encode_gbps;           // raw GB encoded per second
+	double decode_gbps;           // raw GB decoded per second
+	double max_error;             // largest |decoded - x| over all channels
+};
+
+// Runs the NASA Atmos 01/02/03 check cases to tf_s with RK4 at h_s and codes
+// every state channel in blocks of block_samples (the TrajectoryFileWriter
+// chunk), with Gorilla and with QuantizedDelta at each of max_errors.
+// Throughput is single-threaded, from the best of a few repeats.
+std::vector<CompressionResult> compression_report(double tf_s, double h_s, const std::vector<double>& max_errors, std::size_t block_samples = 65536);
+
+// Prints compression_report as a table
+void print_compression_report(std::ostream& out, double tf_s, double h_s, const std::vector<double>& max_errors = { 1e-6, 1e-3 });
+
+#endif // FLAT_EARTH_COMPRESSION_H
@@ -0,0 +1,284 @@
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <vector>
+#include "flat_earth_ensemble.h"
+#include "flat_earth_eom.h"
+
+MixedPrecisionEnsemble::MixedPrecisionEnsemble(std::span<const VehicleParams> vehicles, std::span<const std::array<double, 12>> x0, double t0_s)
+	: n(vehicles.size()), t_s(t0_s), vehicles(vehicles)
+{
+	/*  Arguments:
+
+		vehicles - compiled vehicle of each member
+
+		x0 - initial 12-state vector of each member, same layout as flat_earth_eom_inplace;
+		must have as many entries as vehicles
+
+		t0_s - initial time [s]
+	*/
+
+	for (auto& channel : x)
+	{
+		channel.resize(n);
+	}
+	for (auto& channel : position_n_m)
+	{
+		channel.resize(n);
+	}
+	for (auto* buffer : { &x_stage, &k1, &k2, &k3, &k4 })
+	{
+		for (auto& channel : *buffer)
+		{
+			channel.resize(n);
+		}
+	}
+
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		for (std::size_t j = 0; j < 9; ++j)
+		{
+			x[j][i] = static_cast<float>(x0[i][j]);
+		}
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			position_n_m[j][i] = x0[i][9 + j];
+		}
+	}
+}
+
+void MixedPrecisionEnsemble::load_state()
+{
+	for (std::size_t j = 0; j < 9; ++j)
+	{
+		std::copy(x[j].begin(), x[j].end(), x_stage[j].begin());
+	}
+	for (std::size_t j = 0; j < 3; ++j)
+	{
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			x_stage[9 + j][i] = static_cast<float>(position_n_m[j][i]);
+		}
+	}
+}
+
+void MixedPrecisionEnsemble::stage_state(float a, const std::array<std::vector<float>, 12>& k)
+{
+	for (std::size_t j = 0; j < 9; ++j)
+	{
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			x_stage[j][i] = x[j][i] + a * k[j][i];
+		}
+	}
+
+	// The stage position only feeds the density, so rounding it to float is harmless
+	for (std::size_t j = 0; j < 3; ++j)
+	{
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			x_stage[9 + j][i] = static_cast<float>(position_n_m[j][i] + static_cast<double>(a) * k[9 + j][i]);
+		}
+	}
+}
+
+void MixedPrecisionEnsemble::evaluate(std::array<std::vector<float>, 12>& k)
+{
+	std::array<const float*, 12> x_ptr;
+	std::array<float*, 12> k_ptr;
+	for (std::size_t j = 0; j < 12; ++j)
+	{
+		x_ptr[j] = x_stage[j].data();
+		k_ptr[j] = k[j].data();
+	}
+
+	flat_earth_eom_batch(t_s, n, x_ptr, vehicles, k_ptr);
+}
+
+void MixedPrecisionEnsemble::rk4_step(double h_s)
+{
+	float h = static_cast<float>(h_s);
+
+	load_state();
+	evaluate(k1);
+	stage_state(0.5f * h, k1);
+	evaluate(k2);
+	stage_state(0.5f * h, k2);
+	evaluate(k3);
+	stage_state(h, k3);
+	evaluate(k4);
+
+	float h_6 = h / 6.0f;
+	for (std::size_t j = 0; j < 9; ++j)
+	{
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			x[j][i] += h_6 * (k1[j][i] + 2.0f * k2[j][i] + 2.0f * k3[j][i] + k4[j][i]);
+		}
+	}
+
+	// Position increments are summed and accumulated in double
+	for (std::size_t j = 0; j < 3; ++j)
+	{
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			double k_sum = static_cast<double>(k1[9 + j][i]) + 2.0 * k2[9 + j][i] + 2.0 * k3[9 + j][i] + k4[9 + j][i];
+			position_n_m[j][i] += (1.0 / 6.0) * h_s * k_sum;
+		}
+	}
+
+	t_s += h_s;
+}
+
+std::array<double, 12> MixedPrecisionEnsemble::state(std::size_t i) const
+{
+	std::array<double, 12> xi;
+	for (std::size_t j = 0; j < 9; ++j)
+	{
+		xi[j] = x[j][i];
+	}
+	for (std::size_t j = 0; j < 3; ++j)
+	{
+		xi[9 + j] = position_n_m[j][i];
+	}
+	return xi;
+}
+
+namespace
+{
+	// Double-precision reference: the same RK4 step on flat_earth_eom_inplace
+	void rk4_step_reference(double t_s, std::array<double, 12>& x, const VehicleParams& vehicle, double h_s)
+	{
+		std::array<double, 12> k1, k2, k3, k4, x_stage;
+
+		flat_earth_eom_inplace(t_s, x, vehicle, k1);
+		for (std::size_t j = 0; j < 12; ++j)
+		{
+			x_stage[j] = x[j] + 0.5 * h_s * k1[j];
+		}
+		flat_earth_eom_inplace(t_s + 0.5 * h_s, x_stage, vehicle, k2);
+		for (std::size_t j = 0; j < 12; ++j)
+		{
+			x_stage[j] = x[j] + 0.5 * h_s * k2[j];
+		}
+		flat_earth_eom_inplace(t_s + 0.5 * h_s, x_stage, vehicle, k3);
+		for (std::size_t j = 0; j < 12; ++j)
+		{
+			x_stage[j] = x[j] + h_s * k3[j];
+		}
+		flat_earth_eom_inplace(t_s + h_s, x_stage, vehicle, k4);
+
+		for (std::size_t j = 0; j < 12; ++j)
+		{
+			x[j] = x[j] + (1.0 / 6.0) * h_s * (k1[j] + 2.0 * k2[j] + 2.0 * k3[j] + k4[j]);
+		}
+	}
+
+	double max_of(const std::array<double, 12>& e, std::size_t first)
+	{
+		return std::max({ e[first], e[first + 1], e[first + 2] });
+	}
+}
+
+std::array<double, 12> check_case_initial_state(VehiclePreset preset)
+{
+	const double d2r = std::numbers::pi / 180.0;
+
+	// At 30000 ft: the sphere (Atmos 01) is dropped without rotation, the bricks
+	// (Atmos 02/03) start tumbling at 10/20/30 deg/s
+	if (preset == VehiclePreset::NASA_Atmos01_Sphere)
+	{
+		return { 0.001, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, -30000.0 / 3.28 };
+	}
+	return { 0.001, 0.0, 0.0, 10.0 * d2r, 20.0 * d2r, 30.0 * d2r, 0.0, 0.0, 0.0, 0.0, 0.0, -30000.0 / 3.28 };
+}
+
+const char* preset_name(VehiclePreset preset)
+{
+	switch (preset)
+	{
+	case VehiclePreset::NASA_Atmos01_Sphere: return "NASA_Atmos01_Sphere";
+	case VehiclePreset::NASA_Atmos02_Brick: return "NASA_Atmos02_Brick";
+	case VehiclePreset::NASA_Atmos03_Brick: return "NASA_Atmos03_Brick";
+	default: return "other";
+	}
+}
+
+std::vector<FloatDivergence> float_divergence_report(double tf_s, double h_s)
+{
+	/*  Arguments:
+
+		tf_s - final time [s]
+
+		h_s - RK4 step [s], shared by both runs
+	*/
+
+	std::vector<FloatDivergence> report;
+
+	for (VehiclePreset preset : { VehiclePreset::NASA_Atmos01_Sphere, VehiclePreset::NASA_Atmos02_Brick, VehiclePreset::NASA_Atmos03_Brick })
+	{
+		VehicleParams vehicle = makeVehicle(preset);
+		const std::array<double, 12> x0 = check_case_initial_state(preset);
+
+		MixedPrecisionEnsemble ensemble(std::span<const VehicleParams>(&vehicle, 1), std::span<const std::array<double, 12>>(&x0, 1), 0.0);
+		std::array<double, 12> x_reference = x0;
+
+		FloatDivergence divergence{};
+		divergence.preset = preset;
+
+		std::size_t nt_s = static_cast<std::size_t>(std::floor(tf_s / h_s + 0.5));
+		for (std::size_t step = 0; step < nt_s; ++step)
+		{
+			rk4_step_reference(step * h_s, x_reference, vehicle, h_s);
+			ensemble.rk4_step(h_s);
+
+			// Stop comparing once the reference itself leaves the finite range
+			if (!std::all_of(x_reference.begin(), x_reference.end(), [](double v) { return std::isfinite(v); }))
+			{
+				break;
+			}
+
+			std::array<double, 12> x_float = ensemble.state(0);
+			for (std::size_t j = 0; j < 12; ++j)
+			{
+				double error = std::abs(x_float[j] - x_reference[j]);
+				divergence.max_abs_error[j] = std::isfinite(error) ? std::max(divergence.max_abs_error[j], error) : std::numeric_limits<double>::infinity();
+			}
+			divergence.compared_until_s = (step + 1) * h_s;
+		}
+
+		divergence.max_velocity_error_mps = max_of(divergence.max_abs_error, 0);
+		divergence.max_rate_error_rps = max_of(divergence.max_abs_error, 3);
+		divergence.max_angle_error_rad = max_of(divergence.max_abs_error, 6);
+		divergence.max_position_error_m = max_of(divergence.max_abs_error, 9);
+
+		report.push_back(divergence);
+	}
+
+	return report;
+}
+
+void print_float_divergence_report(std::ostream& out, double tf_s, double h_s)
+{
+	out << "Float32 ensemble vs double reference, RK4, h = " << h_s << " s, " << tf_s << " s:\n";
+	out << std::left << std::setw(22) << "preset" << std::right
+		<< std::setw(14) << "uvw [m/s]" << std::setw(14) << "pqr [rad/s]"
+		<< std::setw(14) << "angles [rad]" << std::setw(14) << "pos [m]" << std::setw(10) << "to [s]" << "\n";
+
+	std::ios_base::fmtflags flags = out.flags();
+	out << std::scientific << std::setprecision(3);
+	for (const FloatDivergence& divergence : float_divergence_report(tf_s, h_s))
+	{
+		out << std::left << std::setw(22) << preset_name(divergence.preset) << std::right
+			<< std::setw(14) << divergence.max_velocity_error_mps
+			<< std::setw(14) << divergence.max_rate_error_rps
+			<< std::setw(14) << divergence.max_angle_error_rad
+			<< std::setw(14) << divergence.max_position_error_m
+			<< std::defaultfloat << std::setw(10) << divergence.compared_until_s << std::scientific << "\n";
+	}
+	out.flags(flags);
+}
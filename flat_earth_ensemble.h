@@ -0,0 +1,78 @@
+#pragma once
+#ifndef FLAT_EARTH_ENSEMBLE_H
+#define FLAT_EARTH_ENSEMBLE_H
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <vector>
+#include "flat_earth_eom_batch.h"
+#include "spheres.h"
+
+// Mixed-precision Monte Carlo ensemble. Velocities, rates and Euler angles are
+// stored and integrated in float through the float batch EoM (twice the SIMD
+// lanes of double). Position and time stay in double: a float p1/p2/p3 would
+// lose the per-step increment to rounding once the range reaches a few km.
+class MixedPrecisionEnsemble
+{
+public:
+	// One member per vehicle; x0[i] is the 12-state initial condition of member i
+	MixedPrecisionEnsemble(std::span<const VehicleParams> vehicles, std::span<const std::array<double, 12>> x0, double t0_s);
+
+	// Advance every member by one classic RK4 step
+	void rk4_step(double h_s);
+
+	std::size_t size() const { return n; }
+	double time() const { return t_s; }
+
+	// Full 12-state vector of member i, widened to double
+	std::array<double, 12> state(std::size_t i) const;
+
+private:
+	// Writes x_stage = x, or x_stage = x + a * k, for the float states and the stage position
+	void load_state();
+	void stage_state(float a, const std::array<std::vector<float>, 12>& k);
+	void evaluate(std::array<std::vector<float>, 12>& k);
+
+	std::size_t n;
+	double t_s;
+	VehicleBatchFloat vehicles;
+
+	std::array<std::vector<float>, 9> x;             // u v w p q r phi theta psi
+	std::array<std::vector<double>, 3> position_n_m; // p1 p2 p3
+
+	std::array<std::vector<float>, 12> x_stage;
+	std::array<std::vector<float>, 12> k1, k2, k3, k4;
+};
+
+// Initial 12-state vector of the NASA check case for a preset (Atmos 01/02/03)
+std::array<double, 12> check_case_initial_state(VehiclePreset preset);
+
+// Preset name for report tables
+const char* preset_name(VehiclePreset preset);
+
+// Largest difference between the float ensemble and the double-precision
+// reference over a run, per state
+struct FloatDivergence
+{
+	VehiclePreset preset;
+	std::array<double, 12> max_abs_error;
+	double max_velocity_error_mps;  // over u, v, w
+	double max_rate_error_rps;      // over p, q, r
+	double max_angle_error_rad;     // over phi, theta, psi
+	double max_position_error_m;    // over p1, p2, p3
+	double compared_until_s;        // end of the comparison, earlier than tf_s if the reference diverged
+};
+
+// Runs the NASA Atmos 01/02/03 check-case presets from 30000 ft (sphere dropped,
+// bricks tumbling at 10/20/30 deg/s) with the double-precision in-place EoM and
+// with MixedPrecisionEnsemble, both under RK4 with step h_s, and reports the
+// largest divergence of each state up to tf_s. A float state that blows up
+// while the reference does not is reported as infinite.
+std::vector<FloatDivergence> float_divergence_report(double tf_s, double h_s);
+
+// Prints float_divergence_report as a table
+void print_float_divergence_report(std::ostream& out, double tf_s, double h_s);
+
+#endif // FLAT_EARTH_ENSEMBLE_H
@@ -5,12 +5,59 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <span>
+#include "spheres.h"
 
 
 std::vector<double> flat_earth_eom(
     double t,
     const std::vector<double> x,
-    const std::unordered_map<std::string, double>& amod, std::unordered_map<std::string, double> airmod
+    const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double>& airmod
 );
 
+// Allocation-free form: reads the state through a span and writes the 12
+// derivatives into a caller-provided buffer
+void flat_earth_eom_inplace(
+    double t,
+    std::span<const double> x,
+    const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double>& airmod,
+    std::span<double, 12> dx
+);
+
+// Typed form: no string lookups, uses the constants precomputed by compileVehicle
+void flat_earth_eom_inplace(
+    double t,
+    std::span<const double> x,
+    const VehicleParams& vehicle,
+    std::span<double, 12> dx
+);
+
+// 13-state quaternion layout [u v w p q r q0 q1 q2 q3 p1 p2 p3]: trig-free attitude
+// kinematics with no theta = +-90 deg singularity. Convert initial conditions and
+// output with the helpers in attitude.h.
+void flat_earth_eom_quat_inplace(
+    double t,
+    std::span<const double> x,
+    const VehicleParams& vehicle,
+    std::span<double, 13> dx
+);
+
+// Quaternion layout with the flat_earth_eom signature, for the std::function integrators
+std::vector<double> flat_earth_eom_quat(
+    double t,
+    const std::vector<double> x,
+    const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double>& airmod
+);
+
+// Signature shared by all specialized EoM kernels
+using FlatEarthEomFn = void (*)(double t, std::span<const double> x, const VehicleParams& vehicle, std::span<double, 12> dx);
+
+// Returns the kernel specialized for this vehicle: drag, damping moments and Jxz
+// coupling are compiled out when the vehicle has none. Select once, call per stage.
+FlatEarthEomFn selectFlatEarthEom(const VehicleParams& vehicle);
+
+using FlatEarthEomQuatFn = void (*)(double t, std::span<const double> x, const VehicleParams& vehicle, std::span<double, 13> dx);
+
+FlatEarthEomQuatFn selectFlatEarthEomQuat(const VehicleParams& vehicle);
+
 #endif // FLAT_EARTH_EOM_H
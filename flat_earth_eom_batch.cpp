@@ -0,0 +1,340 @@
+#include <cmath>
+#include <array>
+#include <span>
+#include <vector>
+#include "flat_earth_eom_batch.h"
+#include "ussa1976.h"
+#include "fast_math.h"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/*  Batched structure-of-arrays version of flat_earth_eom.
+
+	The kernel is written once against a small "pack" type holding one double per
+	lane and instantiated for AVX-512 (8 lanes), AVX2 (4 lanes) and plain doubles.
+	The float packs double the lane count for the single-precision ensemble path.
+	Which wide pack is used is decided at compile time from the target ISA, so build
+	with -mavx2 / -mavx512f (or FLAT_EARTH_NATIVE_ARCH in CMake) to get the vector
+	paths. Lanes left over at the end of a block go through the scalar pack.
+
+	Transcendentals (Euler angle sin/cos, USSA1976 density) are evaluated lane by
+	lane in a short pre-pass, through libm or, with FLAT_EARTH_FAST_TRIG, the
+	fast_math.h approximations. Everything after that is lane-parallel
+	arithmetic. The wind-axes rotation is done algebraically rather than through
+	atan2/asin: with no side force or lift the drag acts along -(u, v, w) / V, so
+
+		F_b = -CD * qbar * Aref * (u, v, w) / V = -0.5 * CD * Aref * rho * V * (u, v, w)
+
+	and the brick damping moments reduce the same way to rho * V * (Cl_p * p + ...).
+*/
+
+template <class T>
+BasicVehicleBatch<T>::BasicVehicleBatch(std::span<const VehicleParams> vehicles)
+{
+	std::size_t n = vehicles.size();
+	for (std::vector<T>* field : { &inv_m_kg, &drag_m2, &l_p, &l_r, &m_q, &n_p, &n_r,
+		&roll_pq, &roll_qr, &roll_l, &roll_n, &pitch_pr, &pitch_pp_rr, &inv_Jyy,
+		&yaw_pq, &yaw_qr, &yaw_l, &yaw_n })
+	{
+		field->resize(n);
+	}
+
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		const VehicleParams& vehicle = vehicles[i];
+		double Ab2 = 0.25 * vehicle.Aref_m2 * vehicle.b_m * vehicle.b_m;
+		double Ac2 = 0.25 * vehicle.Aref_m2 * vehicle.c_m * vehicle.c_m;
+
+		inv_m_kg[i] = T(vehicle.inv_m_kg);
+		drag_m2[i] = T(0.5 * vehicle.CD_approx * vehicle.Aref_m2);
+		l_p[i] = T(Ab2 * vehicle.Clp);
+		l_r[i] = T(Ab2 * vehicle.Clr);
+		m_q[i] = T(Ac2 * vehicle.Cmq);
+		n_p[i] = T(Ab2 * vehicle.Cnp);
+		n_r[i] = T(Ab2 * vehicle.Cnr);
+		roll_pq[i] = T(vehicle.roll_pq);
+		roll_qr[i] = T(vehicle.roll_qr);
+		roll_l[i] = T(vehicle.roll_l);
+		roll_n[i] = T(vehicle.roll_n);
+		pitch_pr[i] = T(vehicle.pitch_pr);
+		pitch_pp_rr[i] = T(vehicle.pitch_pp_rr);
+		inv_Jyy[i] = T(vehicle.inv_Jyy);
+		yaw_pq[i] = T(vehicle.yaw_pq);
+		yaw_qr[i] = T(vehicle.yaw_qr);
+		yaw_l[i] = T(vehicle.yaw_l);
+		yaw_n[i] = T(vehicle.yaw_n);
+	}
+}
+
+template class BasicVehicleBatch<double>;
+template class BasicVehicleBatch<float>;
+
+namespace
+{
+	template <class T>
+	struct ScalarPack
+	{
+		using scalar = T;
+		static constexpr std::size_t width = 1;
+		T v;
+
+		static ScalarPack load(const T* p) { return { *p }; }
+		static ScalarPack broadcast(T a) { return { a }; }
+		void store(T* p) const { *p = v; }
+
+		friend ScalarPack operator+(ScalarPack a, ScalarPack b) { return { a.v + b.v }; }
+		friend ScalarPack operator-(ScalarPack a, ScalarPack b) { return { a.v - b.v }; }
+		friend ScalarPack operator*(ScalarPack a, ScalarPack b) { return { a.v * b.v }; }
+		friend ScalarPack operator/(ScalarPack a, ScalarPack b) { return { a.v / b.v }; }
+		friend ScalarPack sqrt(ScalarPack a) { return { std::sqrt(a.v) }; }
+
+		// x where a >= threshold, 0 elsewhere
+		friend ScalarPack zero_below(ScalarPack a, T threshold, ScalarPack x) { return { a.v >= threshold ? x.v : T(0) }; }
+	};
+
+#if defined(__AVX2__)
+	struct Avx2Pack
+	{
+		using scalar = double;
+		static constexpr std::size_t width = 4;
+		__m256d v;
+
+		static Avx2Pack load(const double* p) { return { _mm256_loadu_pd(p) }; }
+		static Avx2Pack broadcast(double a) { return { _mm256_set1_pd(a) }; }
+		void store(double* p) const { _mm256_storeu_pd(p, v); }
+
+		friend Avx2Pack operator+(Avx2Pack a, Avx2Pack b) { return { _mm256_add_pd(a.v, b.v) }; }
+		friend Avx2Pack operator-(Avx2Pack a, Avx2Pack b) { return { _mm256_sub_pd(a.v, b.v) }; }
+		friend Avx2Pack operator*(Avx2Pack a, Avx2Pack b) { return { _mm256_mul_pd(a.v, b.v) }; }
+		friend Avx2Pack operator/(Avx2Pack a, Avx2Pack b) { return { _mm256_div_pd(a.v, b.v) }; }
+		friend Avx2Pack sqrt(Avx2Pack a) { return { _mm256_sqrt_pd(a.v) }; }
+
+		friend Avx2Pack zero_below(Avx2Pack a, double threshold, Avx2Pack x)
+		{
+			__m256d keep = _mm256_cmp_pd(a.v, _mm256_set1_pd(threshold), _CMP_GE_OQ);
+			return { _mm256_and_pd(keep, x.v) };
+		}
+	};
+
+	struct Avx2PackFloat
+	{
+		using scalar = float;
+		static constexpr std::size_t width = 8;
+		__m256 v;
+
+		static Avx2PackFloat load(const float* p) { return { _mm256_loadu_ps(p) }; }
+		static Avx2PackFloat broadcast(float a) { return { _mm256_set1_ps(a) }; }
+		void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+		friend Avx2PackFloat operator+(Avx2PackFloat a, Avx2PackFloat b) { return { _mm256_add_ps(a.v, b.v) }; }
+		friend Avx2PackFloat operator-(Avx2PackFloat a, Avx2PackFloat b) { return { _mm256_sub_ps(a.v, b.v) }; }
+		friend Avx2PackFloat operator*(Avx2PackFloat a, Avx2PackFloat b) { return { _mm256_mul_ps(a.v, b.v) }; }
+		friend Avx2PackFloat operator/(Avx2PackFloat a, Avx2PackFloat b) { return { _mm256_div_ps(a.v, b.v) }; }
+		friend Avx2PackFloat sqrt(Avx2PackFloat a) { return { _mm256_sqrt_ps(a.v) }; }
+
+		friend Avx2PackFloat zero_below(Avx2PackFloat a, float threshold, Avx2PackFloat x)
+		{
+			__m256 keep = _mm256_cmp_ps(a.v, _mm256_set1_ps(threshold), _CMP_GE_OQ);
+			return { _mm256_and_ps(keep, x.v) };
+		}
+	};
+#endif
+
+#if defined(__AVX512F__)
+	struct Avx512Pack
+	{
+		using scalar = double;
+		static constexpr std::size_t width = 8;
+		__m512d v;
+
+		static Avx512Pack load(const double* p) { return { _mm512_loadu_pd(p) }; }
+		static Avx512Pack broadcast(double a) { return { _mm512_set1_pd(a) }; }
+		void store(double* p) const { _mm512_storeu_pd(p, v); }
+
+		friend Avx512Pack operator+(Avx512Pack a, Avx512Pack b) { return { _mm512_add_pd(a.v, b.v) }; }
+		friend Avx512Pack operator-(Avx512Pack a, Avx512Pack b) { return { _mm512_sub_pd(a.v, b.v) }; }
+		friend Avx512Pack operator*(Avx512Pack a, Avx512Pack b) { return { _mm512_mul_pd(a.v, b.v) }; }
+		friend Avx512Pack operator/(Avx512Pack a, Avx512Pack b) { return { _mm512_div_pd(a.v, b.v) }; }
+		friend Avx512Pack sqrt(Avx512Pack a) { return { _mm512_sqrt_pd(a.v) }; }
+
+		friend Avx512Pack zero_below(Avx512Pack a, double threshold, Avx512Pack x)
+		{
+			__mmask8 keep = _mm512_cmp_pd_mask(a.v, _mm512_set1_pd(threshold), _CMP_GE_OQ);
+			return { _mm512_maskz_mov_pd(keep, x.v) };
+		}
+	};
+
+	struct Avx512PackFloat
+	{
+		using scalar = float;
+		static constexpr std::size_t width = 16;
+		__m512 v;
+
+		static Avx512PackFloat load(const float* p) { return { _mm512_loadu_ps(p) }; }
+		static Avx512PackFloat broadcast(float a) { return { _mm512_set1_ps(a) }; }
+		void store(float* p) const { _mm512_storeu_ps(p, v); }
+
+		friend Avx512PackFloat operator+(Avx512PackFloat a, Avx512PackFloat b) { return { _mm512_add_ps(a.v, b.v) }; }
+		friend Avx512PackFloat operator-(Avx512PackFloat a, Avx512PackFloat b) { return { _mm512_sub_ps(a.v, b.v) }; }
+		friend Avx512PackFloat operator*(Avx512PackFloat a, Avx512PackFloat b) { return { _mm512_mul_ps(a.v, b.v) }; }
+		friend Avx512PackFloat operator/(Avx512PackFloat a, Avx512PackFloat b) { return { _mm512_div_ps(a.v, b.v) }; }
+		friend Avx512PackFloat sqrt(Avx512PackFloat a) { return { _mm512_sqrt_ps(a.v) }; }
+
+		friend Avx512PackFloat zero_below(Avx512PackFloat a, float threshold, Avx512PackFloat x)
+		{
+			__mmask16 keep = _mm512_cmp_ps_mask(a.v, _mm512_set1_ps(threshold), _CMP_GE_OQ);
+			return { _mm512_maskz_mov_ps(keep, x.v) };
+		}
+	};
+
+	using WidePack = Avx512Pack;
+	using WidePackFloat = Avx512PackFloat;
+#elif defined(__AVX2__)
+	using WidePack = Avx2Pack;
+	using WidePackFloat = Avx2PackFloat;
+#else
+	using WidePack = ScalarPack<double>;
+	using WidePackFloat = ScalarPack<float>;
+#endif
+
+	// Evaluates lanes [i0, i0 + Pack::width)
+	template <class Pack, class T = typename Pack::scalar>
+	void eom_lanes(std::size_t i0, const std::array<const T*, 12>& x, const BasicVehicleBatch<T>& vb, const std::array<T*, 12>& dx)
+	{
+		constexpr std::size_t W = Pack::width;
+
+		// Transcendental pre-pass. The trig loop is kept apart from the density so
+		// that, with FLAT_EARTH_FAST_TRIG, it is branch-free and vectorizes.
+		alignas(64) T s_phi_l[W], c_phi_l[W], s_theta_l[W], c_theta_l[W], s_psi_l[W], c_psi_l[W], rho_l[W];
+		for (std::size_t k = 0; k < W; ++k)
+		{
+			std::size_t i = i0 + k;
+			DefaultTrig::sincos(x[6][i], s_phi_l[k], c_phi_l[k]);
+			DefaultTrig::sincos(x[7][i], s_theta_l[k], c_theta_l[k]);
+			DefaultTrig::sincos(x[8][i], s_psi_l[k], c_psi_l[k]);
+		}
+		for (std::size_t k = 0; k < W; ++k)
+		{
+			rho_l[k] = computeAtmosphere(-x[11][i0 + k]).air_density;
+		}
+
+		Pack u_b_mps = Pack::load(x[0] + i0);
+		Pack v_b_mps = Pack::load(x[1] + i0);
+		Pack w_b_mps = Pack::load(x[2] + i0);
+		Pack p_b_rps = Pack::load(x[3] + i0);
+		Pack q_b_rps = Pack::load(x[4] + i0);
+		Pack r_b_rps = Pack::load(x[5] + i0);
+
+		Pack s_phi = Pack::load(s_phi_l);
+		Pack c_phi = Pack::load(c_phi_l);
+		Pack s_theta = Pack::load(s_theta_l);
+		Pack c_theta = Pack::load(c_theta_l);
+		Pack s_psi = Pack::load(s_psi_l);
+		Pack c_psi = Pack::load(c_psi_l);
+		Pack rho_kgpm3 = Pack::load(rho_l);
+
+		// Air data
+		Pack true_airspeed_mps = sqrt(u_b_mps * u_b_mps + v_b_mps * v_b_mps + w_b_mps * w_b_mps);
+		Pack rho_V = rho_kgpm3 * true_airspeed_mps;
+
+		// Gravity resolved in body axes
+		Pack gz_n_mps2 = Pack::broadcast(T(9.81));
+		Pack gx_b_mps2 = Pack::broadcast(T(0)) - s_theta * gz_n_mps2;
+		Pack gy_b_mps2 = s_phi * c_theta * gz_n_mps2;
+		Pack gz_b_mps2 = c_phi * c_theta * gz_n_mps2;
+
+		// Drag along the relative wind, divided by mass
+		Pack drag_over_m = Pack::load(vb.drag_m2.data() + i0) * rho_V * Pack::load(vb.inv_m_kg.data() + i0);
+
+		// Damping moments, zero below the same airspeed threshold as Cl_brick etc.
+		Pack rho_V_damped = zero_below(true_airspeed_mps, T(1e-6), rho_V);
+		Pack l_b_kgm2ps2 = rho_V_damped * (Pack::load(vb.l_p.data() + i0) * p_b_rps + Pack::load(vb.l_r.data() + i0) * r_b_rps);
+		Pack m_b_kgm2ps2 = rho_V_damped * Pack::load(vb.m_q.data() + i0) * q_b_rps;
+		Pack n_b_kgm2ps2 = rho_V_damped * (Pack::load(vb.n_p.data() + i0) * p_b_rps + Pack::load(vb.n_r.data() + i0) * r_b_rps);
+
+		// Translational dynamics
+		(gx_b_mps2 - drag_over_m * u_b_mps - w_b_mps * q_b_rps + v_b_mps * r_b_rps).store(dx[0] + i0);
+		(gy_b_mps2 - drag_over_m * v_b_mps - u_b_mps * r_b_rps + w_b_mps * p_b_rps).store(dx[1] + i0);
+		(gz_b_mps2 - drag_over_m * w_b_mps - v_b_mps * p_b_rps + u_b_mps * q_b_rps).store(dx[2] + i0);
+
+		// Rotational dynamics
+		Pack pq = p_b_rps * q_b_rps;
+		Pack qr = q_b_rps * r_b_rps;
+		(Pack::load(vb.roll_pq.data() + i0) * pq - Pack::load(vb.roll_qr.data() + i0) * qr +
+			Pack::load(vb.roll_l.data() + i0) * l_b_kgm2ps2 + Pack::load(vb.roll_n.data() + i0) * n_b_kgm2ps2).store(dx[3] + i0);
+		(Pack::load(vb.pitch_pr.data() + i0) * p_b_rps * r_b_rps -
+			Pack::load(vb.pitch_pp_rr.data() + i0) * (p_b_rps * p_b_rps - r_b_rps * r_b_rps) +
+			Pack::load(vb.inv_Jyy.data() + i0) * m_b_kgm2ps2).store(dx[4] + i0);
+		(Pack::load(vb.yaw_pq.data() + i0) * pq + Pack::load(vb.yaw_qr.data() + i0) * qr +
+			Pack::load(vb.yaw_l.data() + i0) * l_b_kgm2ps2 + Pack::load(vb.yaw_n.data() + i0) * n_b_kgm2ps2).store(dx[5] + i0);
+
+		// Kinematic equations
+		Pack q_s_r_c = s_phi * q_b_rps + c_phi * r_b_rps;
+		(p_b_rps + s_theta / c_theta * q_s_r_c).store(dx[6] + i0);
+		(c_phi * q_b_rps - s_phi * r_b_rps).store(dx[7] + i0);
+		(q_s_r_c / c_theta).store(dx[8] + i0);
+
+		// Position (navigation) equations
+		Pack s_theta_c_psi = s_theta * c_psi;
+		Pack s_theta_s_psi = s_theta * s_psi;
+		(c_theta * c_psi * u_b_mps + (s_phi * s_theta_c_psi - c_phi * s_psi) * v_b_mps +
+			(s_phi * s_psi + c_phi * s_theta_c_psi) * w_b_mps).store(dx[9] + i0);
+		(c_theta * s_psi * u_b_mps + (c_phi * c_psi + s_phi * s_theta_s_psi) * v_b_mps +
+			(c_phi * s_theta_s_psi - s_phi * c_psi) * w_b_mps).store(dx[10] + i0);
+		(s_phi * c_theta * v_b_mps + c_phi * c_theta * w_b_mps - s_theta * u_b_mps).store(dx[11] + i0);
+	}
+
+	// Wide blocks, then the remainder lane by lane
+	template <class Pack, class T = typename Pack::scalar>
+	void eom_batch(std::size_t n, const std::array<const T*, 12>& x, const BasicVehicleBatch<T>& vehicles, const std::array<T*, 12>& dx)
+	{
+		std::size_t i = 0;
+
+		for (; i + Pack::width <= n; i += Pack::width)
+		{
+			eom_lanes<Pack>(i, x, vehicles, dx);
+		}
+
+		for (; i < n; ++i)
+		{
+			eom_lanes<ScalarPack<T>>(i, x, vehicles, dx);
+		}
+	}
+}
+
+std::size_t flat_earth_eom_batch_width()
+{
+	return WidePack::width;
+}
+
+std::size_t flat_earth_eom_batch_width_float()
+{
+	return WidePackFloat::width;
+}
+
+void flat_earth_eom_batch(double t, std::size_t n, const std::array<const double*, 12>& x, const VehicleBatch& vehicles, const std::array<double*, 12>& dx)
+{
+	/*  Arguments:
+
+		t - time [s], unused by the flat-earth model but kept for parity with flat_earth_eom
+
+		n - number of lanes (vehicles) to evaluate
+
+		x - x[j] points at the n values of state j, same ordering as flat_earth_eom
+
+		vehicles - per-lane vehicle data, at least n lanes
+
+		dx - dx[j] receives the n time derivatives of state j
+	*/
+
+	eom_batch<WidePack>(n, x, vehicles, dx);
+}
+
+void flat_earth_eom_batch(double t, std::size_t n, const std::array<const float*, 12>& x, const VehicleBatchFloat& vehicles, const std::array<float*, 12>& dx)
+{
+	// Same as the double version, in float: 16 lanes with AVX-512, 8 with AVX2
+
+	eom_batch<WidePackFloat>(n, x, vehicles, dx);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef FLAT_EARTH_EOM_BATCH_H
+#define FLAT_EARTH_EOM_BATCH_H
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "spheres.h"
+
+// Per-lane vehicle parameters in structure-of-arrays form. Only the combinations
+// the batched kernel actually multiplies by are stored, so every lane needs one
+// load per term. T is double, or float for the single-precision ensemble path
+// (the combinations are formed in double and rounded once).
+template <class T>
+class BasicVehicleBatch
+{
+public:
+	explicit BasicVehicleBatch(std::span<const VehicleParams> vehicles);
+
+	std::size_t size() const { return inv_m_kg.size(); }
+
+	std::vector<T> inv_m_kg;     // 1 / m
+	std::vector<T> drag_m2;      // 0.5 * CD * Aref, so drag force = drag_m2 * rho * V * (u, v, w)
+	std::vector<T> l_p, l_r;     // 0.25 * Aref * b^2 * (Clp, Clr), so l = rho * V * (l_p * p + l_r * r)
+	std::vector<T> m_q;          // 0.25 * Aref * c^2 * Cmq
+	std::vector<T> n_p, n_r;     // 0.25 * Aref * b^2 * (Cnp, Cnr)
+	std::vector<T> roll_pq, roll_qr, roll_l, roll_n;
+	std::vector<T> pitch_pr, pitch_pp_rr, inv_Jyy;
+	std::vector<T> yaw_pq, yaw_qr, yaw_l, yaw_n;
+};
+
+using VehicleBatch = BasicVehicleBatch<double>;
+using VehicleBatchFloat = BasicVehicleBatch<float>;
+
+// Number of lanes evaluated per SIMD instruction in this build (8 with AVX-512,
+// 4 with AVX2, 1 for the scalar fallback)
+std::size_t flat_earth_eom_batch_width();
+
+// Same for the float kernel (16, 8 or 1)
+std::size_t flat_earth_eom_batch_width_float();
+
+// Evaluates the flat-earth EoM for n independent vehicles at once. x[j] and dx[j]
+// point to n contiguous values of state j (u[n], v[n], ... p3[n]). Vehicle i is
+// described by lane i of vehicles. Matches flat_earth_eom_inplace to rounding.
+void flat_earth_eom_batch(
+	double t,
+	std::size_t n,
+	const std::array<const double*, 12>& x,
+	const VehicleBatch& vehicles,
+	const std::array<double*, 12>& dx
+);
+
+// Single-precision version with twice the lanes per instruction. Altitude only
+// feeds the density, so a float p3 (about 1 mm resolution at 10 km) is fine
+// here; it is accumulating position over many steps that needs double (see
+// MixedPrecisionEnsemble).
+void flat_earth_eom_batch(
+	double t,
+	std::size_t n,
+	const std::array<const float*, 12>& x,
+	const VehicleBatchFloat& vehicles,
+	const std::array<float*, 12>& dx
+);
+
+#endif // FLAT_EARTH_EOM_BATCH_H
@@ -0,0 +1,395 @@
+#pragma once
+#ifndef FLAT_EARTH_EOM_KERNEL_H
+#define FLAT_EARTH_EOM_KERNEL_H
+
+#include <array>
+#include <cmath>
+#include <span>
+#include <type_traits>
+#include "fast_math.h"
+#include "spheres.h"
+#include "ussa1976.h"
+
+/*  Policy-based flat-earth equations of motion.
+
+	flat_earth_eom_kernel is parameterized on the atmosphere, gravity, aerodynamic
+	force, aerodynamic moment and inertia models. Each vehicle configuration then
+	compiles to its own kernel with the terms it does not need removed: the spheres
+	have Jxz = 0 and no damping derivatives, the Atmos02/03 bricks have CD = 0, and
+	with neither forces nor moments the atmosphere is never evaluated at all.
+
+	flat_earth_eom_inplace is the instantiation with every term enabled, and
+	selectFlatEarthEom (flat_earth_eom.h) picks the specialized one for a vehicle.
+
+	The Attitude policy selects the state layout: 12 states with Euler angles, or
+	13 states with a quaternion (flat_earth_eom_quat_inplace).
+*/
+
+
+// Atmosphere policies
+
+struct Ussa1976Atmosphere
+{
+	template <class T>
+	static T air_density(T altitude_m) { return computeAtmosphere(altitude_m).air_density; }
+};
+
+
+// Gravity policies
+
+struct ConstantGravity
+{
+	// Gravity acts normal to earth tangent CS
+	static constexpr double gz_n_mps2 = 9.81;
+};
+
+
+// Aerodynamic force policies. body_forces returns the force resolved in body axes.
+
+struct NoAeroForces
+{
+	static constexpr bool uses_air = false;
+
+	template <class T>
+	static std::array<T, 3> body_forces(const BasicVehicleParams<T>&, T, T, T, T, T)
+	{
+		return { T(0), T(0), T(0) };
+	}
+};
+
+struct ConstantDragForces
+{
+	static constexpr bool uses_air = true;
+
+	template <class T>
+	static std::array<T, 3> body_forces(const BasicVehicleParams<T>& vehicle, T rho_kgpm3, T true_airspeed_mps,
+		T u_b_mps, T v_b_mps, T w_b_mps)
+	{
+		// With no side force or lift, the wind-axes rotation only needs its first
+		// column, (cos(alpha)cos(beta), sin(beta), sin(alpha)cos(beta)) = (u, v, w) / V,
+		// so drag acts along -(u, v, w) / V and the 1/V cancels against qbar.
+		T drag_over_V = scalar_t<T>(0.5) * rho_kgpm3 * true_airspeed_mps * vehicle.CD_approx * vehicle.Aref_m2;
+
+		return { -drag_over_V * u_b_mps, -drag_over_V * v_b_mps, -drag_over_V * w_b_mps };
+	}
+};
+
+
+// Aerodynamic moment policies. body_moments returns l, m, n in body axes.
+
+struct NoAeroMoments
+{
+	static constexpr bool uses_air = false;
+
+	template <class T>
+	static std::array<T, 3> body_moments(const BasicVehicleParams<T>&, T, T, T, T, T)
+	{
+		return { T(0), T(0), T(0) };
+	}
+};
+
+struct BrickDampingMoments
+{
+	static constexpr bool uses_air = true;
+
+	template <class T>
+	static std::array<T, 3> body_moments(const BasicVehicleParams<T>& vehicle, T rho_kgpm3, T true_airspeed_mps,
+		T p_b_rps, T q_b_rps, T r_b_rps)
+	{
+		T qbar_kgpms2 = scalar_t<T>(0.5) * rho_kgpm3 * true_airspeed_mps * true_airspeed_mps;
+		T qbar_S = qbar_kgpms2 * vehicle.Aref_m2;
+
+		return {
+			Cl_brick(vehicle.Clp, vehicle.Clr, p_b_rps, r_b_rps, vehicle.b_m, true_airspeed_mps) * qbar_S * vehicle.b_m,
+			Cm_brick(vehicle.Cmq, q_b_rps, vehicle.c_m, true_airspeed_mps) * qbar_S * vehicle.c_m,
+			Cn_brick(vehicle.Cnp, vehicle.Cnr, p_b_rps, r_b_rps, vehicle.b_m, true_airspeed_mps) * qbar_S * vehicle.b_m };
+	}
+};
+
+
+// Inertia policies. rate_derivatives returns (p_dot, q_dot, r_dot) from the
+// coefficients precomputed by compileVehicle.
+
+struct GeneralInertia
+{
+	template <class T>
+	static std::array<T, 3> rate_derivatives(const BasicVehicleParams<T>& vehicle, T p_b_rps, T q_b_rps, T r_b_rps,
+		T l_b_kgm2ps2, T m_b_kgm2ps2, T n_b_kgm2ps2)
+	{
+		return {
+			vehicle.roll_pq * p_b_rps * q_b_rps - vehicle.roll_qr * q_b_rps * r_b_rps +
+				vehicle.roll_l * l_b_kgm2ps2 + vehicle.roll_n * n_b_kgm2ps2,
+			vehicle.pitch_pr * p_b_rps * r_b_rps - vehicle.pitch_pp_rr *
+				(p_b_rps * p_b_rps - r_b_rps * r_b_rps) + vehicle.inv_Jyy * m_b_kgm2ps2,
+			vehicle.yaw_pq * p_b_rps * q_b_rps + vehicle.yaw_qr * q_b_rps * r_b_rps +
+				vehicle.yaw_l * l_b_kgm2ps2 + vehicle.yaw_n * n_b_kgm2ps2 };
+	}
+};
+
+// Jxz = 0: roll_n, pitch_pp_rr, yaw_qr, yaw_l and yaw_n all vanish
+struct PrincipalAxesInertia
+{
+	template <class T>
+	static std::array<T, 3> rate_derivatives(const BasicVehicleParams<T>& vehicle, T p_b_rps, T q_b_rps, T r_b_rps,
+		T l_b_kgm2ps2, T m_b_kgm2ps2, T)
+	{
+		return {
+			vehicle.roll_pq * p_b_rps * q_b_rps - vehicle.roll_qr * q_b_rps * r_b_rps + vehicle.roll_l * l_b_kgm2ps2,
+			vehicle.pitch_pr * p_b_rps * r_b_rps + vehicle.inv_Jyy * m_b_kgm2ps2,
+			vehicle.yaw_pq * p_b_rps * q_b_rps };
+	}
+};
+
+
+// Attitude policies. They fix the state layout (where the attitude and position
+// states sit), build the body to NED direction cosine matrix from the attitude
+// states and write the attitude kinematics.
+
+// x = [u v w p q r phi theta psi p1 p2 p3]. Trig selects libm or the fast_math.h
+// approximations for the angle functions (DefaultTrig follows FLAT_EARTH_FAST_TRIG).
+template <class Trig = DefaultTrig>
+struct BasicEulerAttitude
+{
+	static constexpr std::size_t num_states = 12;
+	static constexpr std::size_t position_index = 9;
+
+	template <class T>
+	struct Frame
+	{
+		T C_b2n[3][3];
+		T s_phi, c_phi, s_theta, c_theta, t_theta, s_psi, c_psi;
+	};
+
+	template <class T>
+	static Frame<T> frame(std::span<const T> x)
+	{
+		T phi_rad = x[6];
+		T theta_rad = x[7];
+		T psi_rad = x[8];
+
+		// Compute trigonometric operations on Euler angles
+		T s_phi, c_phi, s_theta, c_theta, s_psi, c_psi;
+		Trig::sincos(phi_rad, s_phi, c_phi);
+		Trig::sincos(theta_rad, s_theta, c_theta);
+		Trig::sincos(psi_rad, s_psi, c_psi);
+		T t_theta = Trig::tan(theta_rad, s_theta, c_theta);
+
+		// Compute Direction Cosine Matrix
+		return { {
+			{ c_theta * c_psi, -c_phi * s_psi + s_phi * s_theta * c_psi, s_phi * s_psi + c_phi * s_theta * c_psi },
+			{ c_theta * s_psi, c_phi * c_psi + s_phi * s_theta * s_psi, -s_phi * c_psi + c_phi * s_theta * s_psi },
+			{ -s_theta, s_phi * c_theta, c_phi * c_theta } },
+			s_phi, c_phi, s_theta, c_theta, t_theta, s_psi, c_psi };
+	}
+
+	// The part of frame() the kinematics use: phi and theta trig, no DCM
+	template <class T>
+	static Frame<T> kinematic_frame(std::span<const T> x)
+	{
+		Frame<T> f{};
+		Trig::sincos(x[6], f.s_phi, f.c_phi);
+		Trig::sincos(x[7], f.s_theta, f.c_theta);
+		f.t_theta = Trig::tan(x[7], f.s_theta, f.c_theta);
+		return f;
+	}
+
+	// Euler angle rates, reusing the trig from frame(); singular at theta = +-90 deg
+	template <class T>
+	static void kinematics(const Frame<T>& f, std::span<const T>, T p_b_rps, T q_b_rps, T r_b_rps, std::span<T> dx)
+	{
+		T q_s_phi_r_c_phi = f.s_phi * q_b_rps + f.c_phi * r_b_rps;
+		dx[6] = p_b_rps + f.t_theta * q_s_phi_r_c_phi;
+		dx[7] = f.c_phi * q_b_rps - f.s_phi * r_b_rps;
+		dx[8] = q_s_phi_r_c_phi / f.c_theta;
+	}
+};
+
+using EulerAttitude = BasicEulerAttitude<>;
+
+// x = [u v w p q r q0 q1 q2 q3 p1 p2 p3], q0 the scalar part of the body to NED
+// rotation. Trig-free and free of the theta = +-90 deg singularity; the
+// integrators renormalize the quaternion after every step.
+struct QuaternionAttitude
+{
+	static constexpr std::size_t num_states = 13;
+	static constexpr std::size_t position_index = 10;
+
+	template <class T>
+	struct Frame
+	{
+		T C_b2n[3][3];
+	};
+
+	template <class T>
+	static Frame<T> frame(std::span<const T> x)
+	{
+		using S = scalar_t<T>;
+
+		T q0 = x[6];
+		T q1 = x[7];
+		T q2 = x[8];
+		T q3 = x[9];
+
+		return { {
+			{ q0 * q0 + q1 * q1 - q2 * q2 - q3 * q3, S(2) * (q1 * q2 - q0 * q3), S(2) * (q1 * q3 + q0 * q2) },
+			{ S(2) * (q1 * q2 + q0 * q3), q0 * q0 - q1 * q1 + q2 * q2 - q3 * q3, S(2) * (q2 * q3 - q0 * q1) },
+			{ S(2) * (q1 * q3 - q0 * q2), S(2) * (q2 * q3 + q0 * q1), q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3 } } };
+	}
+
+	// The quaternion kinematics need no frame
+	template <class T>
+	static Frame<T> kinematic_frame(std::span<const T>)
+	{
+		return {};
+	}
+
+	// q_dot = 0.5 * q (x) [0, p, q, r]
+	template <class T>
+	static void kinematics(const Frame<T>&, std::span<const T> x, T p_b_rps, T q_b_rps, T r_b_rps, std::span<T> dx)
+	{
+		using S = scalar_t<T>;
+
+		T q0 = x[6];
+		T q1 = x[7];
+		T q2 = x[8];
+		T q3 = x[9];
+
+		dx[6] = S(0.5) * (-q1 * p_b_rps - q2 * q_b_rps - q3 * r_b_rps);
+		dx[7] = S(0.5) * (q0 * p_b_rps + q2 * r_b_rps - q3 * q_b_rps);
+		dx[8] = S(0.5) * (q0 * q_b_rps - q1 * r_b_rps + q3 * p_b_rps);
+		dx[9] = S(0.5) * (q0 * r_b_rps + q1 * q_b_rps - q2 * p_b_rps);
+	}
+};
+
+
+// T is the scalar type: double for the simulation, Dual for sensitivities
+// (sensitivity.h). It is deduced from the vehicle; x and dx convert to spans of T.
+template <class Atmosphere, class Gravity, class Forces, class Moments, class Inertia, class Attitude = EulerAttitude, class T = double>
+void flat_earth_eom_kernel(double t, std::type_identity_t<std::span<const T>> x, const BasicVehicleParams<T>& vehicle,
+	std::type_identity_t<std::span<T, Attitude::num_states>> dx)
+{
+	// State layout and naming follow flat_earth_eom_inplace (flat_earth_eom.cpp);
+	// the attitude block and the position index come from the Attitude policy
+	using S = scalar_t<T>;
+	using std::sqrt;
+
+	// Assign current state values to variable names
+	T u_b_mps = x[0];
+	T v_b_mps = x[1];
+	T w_b_mps = x[2];
+	T p_b_rps = x[3];
+	T q_b_rps = x[4];
+	T r_b_rps = x[5];
+	T p3_n_m = x[Attitude::position_index + 2];
+
+	// Body to NED direction cosine matrix
+	typename Attitude::template Frame<T> frame = Attitude::template frame<T>(x);
+	const auto& C_b2n = frame.C_b2n;
+
+	// Aerodynamic forces and moments; the atmosphere and air data are only
+	// evaluated when one of the two models needs them
+	std::array<T, 3> F_b_kgmps2{ T(0), T(0), T(0) };
+	std::array<T, 3> M_b_kgm2ps2{ T(0), T(0), T(0) };
+
+	if constexpr (Forces::uses_air || Moments::uses_air)
+	{
+		T rho_kgpm3 = Atmosphere::air_density(-p3_n_m);
+		T true_airspeed_mps = sqrt(u_b_mps * u_b_mps + v_b_mps * v_b_mps + w_b_mps * w_b_mps);
+
+		F_b_kgmps2 = Forces::body_forces(vehicle, rho_kgpm3, true_airspeed_mps, u_b_mps, v_b_mps, w_b_mps);
+		M_b_kgm2ps2 = Moments::body_moments(vehicle, rho_kgpm3, true_airspeed_mps, p_b_rps, q_b_rps, r_b_rps);
+	}
+
+	// Resolve gravity in body coordinate system (third column of C_n2b)
+	T gx_b_mps2 = C_b2n[2][0] * S(Gravity::gz_n_mps2);
+	T gy_b_mps2 = C_b2n[2][1] * S(Gravity::gz_n_mps2);
+	T gz_b_mps2 = C_b2n[2][2] * S(Gravity::gz_n_mps2);
+
+	// Translational dynamics
+	dx[0] = vehicle.inv_m_kg * F_b_kgmps2[0] + gx_b_mps2 - w_b_mps * q_b_rps + v_b_mps * r_b_rps;
+	dx[1] = vehicle.inv_m_kg * F_b_kgmps2[1] + gy_b_mps2 - u_b_mps * r_b_rps + w_b_mps * p_b_rps;
+	dx[2] = vehicle.inv_m_kg * F_b_kgmps2[2] + gz_b_mps2 - v_b_mps * p_b_rps + u_b_mps * q_b_rps;
+
+	// Rotational dynamics
+	std::array<T, 3> rates_dot = Inertia::rate_derivatives(vehicle, p_b_rps, q_b_rps, r_b_rps,
+		M_b_kgm2ps2[0], M_b_kgm2ps2[1], M_b_kgm2ps2[2]);
+	dx[3] = rates_dot[0];
+	dx[4] = rates_dot[1];
+	dx[5] = rates_dot[2];
+
+	// Kinematic equations
+	Attitude::kinematics(frame, x, p_b_rps, q_b_rps, r_b_rps, std::span<T>(dx));
+
+	// Position (navigation) equations
+	for (std::size_t i = 0; i < 3; ++i)
+	{
+		dx[Attitude::position_index + i] = C_b2n[i][0] * u_b_mps + C_b2n[i][1] * v_b_mps + C_b2n[i][2] * w_b_mps;
+	}
+}
+
+// Rotational block only: writes the rate derivatives dx[3..5] and the attitude
+// kinematics, and leaves the translational and position entries of dx alone.
+// Skips the gravity, drag force and navigation terms and the heading trig, so
+// it is the cheap fast-block right-hand side of the multirate stepper
+// (multirate_integrators.h). x still carries u, v, w and the altitude, which
+// the moments need through the air density and airspeed.
+template <class Atmosphere, class Moments, class Inertia, class Attitude = EulerAttitude, class T = double>
+void flat_earth_rotational_kernel(double, std::type_identity_t<std::span<const T>> x, const BasicVehicleParams<T>& vehicle,
+	std::type_identity_t<std::span<T, Attitude::num_states>> dx)
+{
+	using std::sqrt;
+
+	T p_b_rps = x[3];
+	T q_b_rps = x[4];
+	T r_b_rps = x[5];
+
+	std::array<T, 3> M_b_kgm2ps2{ T(0), T(0), T(0) };
+	if constexpr (Moments::uses_air)
+	{
+		T u_b_mps = x[0];
+		T v_b_mps = x[1];
+		T w_b_mps = x[2];
+		T rho_kgpm3 = Atmosphere::air_density(-x[Attitude::position_index + 2]);
+		T true_airspeed_mps = sqrt(u_b_mps * u_b_mps + v_b_mps * v_b_mps + w_b_mps * w_b_mps);
+
+		M_b_kgm2ps2 = Moments::body_moments(vehicle, rho_kgpm3, true_airspeed_mps, p_b_rps, q_b_rps, r_b_rps);
+	}
+
+	std::array<T, 3> rates_dot = Inertia::rate_derivatives(vehicle, p_b_rps, q_b_rps, r_b_rps,
+		M_b_kgm2ps2[0], M_b_kgm2ps2[1], M_b_kgm2ps2[2]);
+	dx[3] = rates_dot[0];
+	dx[4] = rates_dot[1];
+	dx[5] = rates_dot[2];
+
+	Attitude::kinematics(Attitude::template kinematic_frame<T>(x), x, p_b_rps, q_b_rps, r_b_rps, std::span<T>(dx));
+}
+
+// The full 6-DoF kernel with the USSA1976 atmosphere and constant gravity as a
+// right-hand side for the templated integrators (numerical_integration_methods.h):
+//   RK4(FlatEarthRhs<>{ vehicle }, t_s, sx, h_s);
+template <class Forces = ConstantDragForces, class Moments = BrickDampingMoments, class Inertia = GeneralInertia, class Attitude = EulerAttitude>
+struct FlatEarthRhs
+{
+	const VehicleParams& vehicle;
+
+	void operator()(double t, std::span<const double> x, std::span<double> dx) const
+	{
+		flat_earth_eom_kernel<Ussa1976Atmosphere, ConstantGravity, Forces, Moments, Inertia, Attitude>(
+			t, x, vehicle, dx.first<Attitude::num_states>());
+	}
+};
+
+// Rotational block of FlatEarthRhs, same template arguments; Forces is unused
+// but kept so the two can be declared from one set of policies
+template <class Forces = ConstantDragForces, class Moments = BrickDampingMoments, class Inertia = GeneralInertia, class Attitude = EulerAttitude>
+struct FlatEarthRotationalRhs
+{
+	const VehicleParams& vehicle;
+
+	void operator()(double t, std::span<const double> x, std::span<double> dx) const
+	{
+		flat_earth_rotational_kernel<Ussa1976Atmosphere, Moments, Inertia, Attitude>(t, x, vehicle, dx.first<Attitude::num_states>());
+	}
+};
+
+#endif // FLAT_EARTH_EOM_KERNEL_H
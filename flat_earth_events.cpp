@@ -0,0 +1,112 @@
+#include <cmath>
+#include <span>
+#include "flat_earth_events.h"
+#include "flat_earth_eom_kernel.h"
+#include "ussa1976.h"
+
+namespace
+{
+	double altitude_m(std::span<const double> x)
+	{
+		return -x.back();
+	}
+
+	double airspeed_mps(std::span<const double> x)
+	{
+		return std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+	}
+
+	// Body to NED direction cosine matrix of either state layout
+	template <class Attitude>
+	void body_to_ned(std::span<const double> x, double C_b2n[3][3])
+	{
+		typename Attitude::template Frame<double> frame = Attitude::template frame<double>(x);
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			for (std::size_t j = 0; j < 3; ++j)
+			{
+				C_b2n[i][j] = frame.C_b2n[i][j];
+			}
+		}
+	}
+}
+
+Event ground_impact_event(EventAction action)
+{
+	Event event;
+	event.name = "ground_impact";
+	event.g = [](double, std::span<const double> x) { return altitude_m(x); };
+	event.direction = EventDirection::Falling;
+	event.action = action;
+	return event;
+}
+
+Event mach_event(double mach, EventDirection direction, EventAction action)
+{
+	Event event;
+	event.name = "mach_" + std::to_string(mach);
+	event.g = [mach](double, std::span<const double> x)
+	{
+		return airspeed_mps(x) / computeAtmosphere(altitude_m(x)).speed_of_sound - mach;
+	};
+	event.direction = direction;
+	event.action = action;
+	return event;
+}
+
+Event dynamic_pressure_event(double qbar_Pa, EventDirection direction, EventAction action)
+{
+	Event event;
+	event.name = "qbar_" + std::to_string(qbar_Pa);
+	event.g = [qbar_Pa](double, std::span<const double> x)
+	{
+		double V_mps = airspeed_mps(x);
+		return 0.5 * computeAtmosphere(altitude_m(x)).air_density * V_mps * V_mps - qbar_Pa;
+	};
+	event.direction = direction;
+	event.action = action;
+	return event;
+}
+
+Event ground_bounce_event(const BounceModel& bounce)
+{
+	Event event = ground_impact_event(EventAction::Reset);
+	event.name = "ground_bounce";
+	event.reset = [bounce](double, std::span<double> x)
+	{
+		double C_b2n[3][3];
+		if (x.size() == QuaternionAttitude::num_states)
+		{
+			body_to_ned<QuaternionAttitude>(x, C_b2n);
+		}
+		else
+		{
+			body_to_ned<EulerAttitude>(x, C_b2n);
+		}
+
+		double v_n_mps[3];
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			v_n_mps[i] = C_b2n[i][0] * x[0] + C_b2n[i][1] * x[1] + C_b2n[i][2] * x[2];
+		}
+
+		// v_n_mps[2] is the downward impact speed
+		if (v_n_mps[2] < bounce.min_impact_speed_mps)
+		{
+			return false;
+		}
+
+		v_n_mps[0] *= bounce.friction;
+		v_n_mps[1] *= bounce.friction;
+		v_n_mps[2] *= -bounce.restitution;
+
+		// Back to body axes with the transpose, and onto the ground
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			x[i] = C_b2n[0][i] * v_n_mps[0] + C_b2n[1][i] * v_n_mps[1] + C_b2n[2][i] * v_n_mps[2];
+		}
+		x.back() = 0.0;
+		return true;
+	};
+	return event;
+}
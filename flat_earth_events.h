@@ -0,0 +1,34 @@
+#pragma once
+#ifndef FLAT_EARTH_EVENTS_H
+#define FLAT_EARTH_EVENTS_H
+
+#include "integrator_events.h"
+
+// Events on the flat-earth state (integrator_events.h). All of them work on
+// both the 12-state Euler and the 13-state quaternion layout: the velocities
+// are x[0..2] and the down position p3 is the last state in either.
+
+// Altitude (-p3) reaching zero from above
+Event ground_impact_event(EventAction action = EventAction::Stop);
+
+// Mach number through the given value; the speed of sound is USSA1976 at the
+// current altitude
+Event mach_event(double mach, EventDirection direction = EventDirection::Any, EventAction action = EventAction::Record);
+
+// Dynamic pressure 0.5 * rho * V^2 through the given value [Pa]
+Event dynamic_pressure_event(double qbar_Pa, EventDirection direction = EventDirection::Rising, EventAction action = EventAction::Record);
+
+// Ground contact as a reset: the NED velocity at impact has its vertical part
+// reflected and scaled by restitution and its horizontal part scaled by
+// friction (the bounce of the web frontend). The run stops once the impact
+// speed falls below min_impact_speed_mps.
+struct BounceModel
+{
+	double restitution = 0.4;
+	double friction = 0.98;
+	double min_impact_speed_mps = 0.5;
+};
+
+Event ground_bounce_event(const BounceModel& bounce = BounceModel());
+
+#endif // FLAT_EARTH_EVENTS_H
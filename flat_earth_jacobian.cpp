@@ -0,0 +1,218 @@
+#include <cmath>
+#include <algorithm>
+#include <span>
+#include "flat_earth_jacobian.h"
+#include "flat_earth_eom_kernel.h"
+#include "ussa1976.h"
+
+void flat_earth_jacobian(double t, std::span<const double> x, const VehicleParams& vehicle, std::span<double, 12> dx, std::span<double, 144> J)
+{
+	/*  Arguments:
+
+		t - time [s], scalar (the model is autonomous, so df/dt = 0)
+
+		x - 12-state vector, same layout as flat_earth_eom_inplace
+
+		vehicle - compiled vehicle data
+
+		dx - receives f(t, x), identical to ConstantDragForces + BrickDampingMoments +
+		GeneralInertia in flat_earth_eom_kernel
+
+		J - receives df/dx, row-major 12 x 12
+
+		With k = 0.5 * CD * Aref and a = 0.25 * Aref * b^2 (c^2 for pitch) the aero
+		terms the kernel evaluates are
+
+			F_b = -k * rho * V * (u, v, w)
+			l = a * rho * V * (Clp * p + Clr * r),  m = a * rho * V * Cmq * q,  n = a * rho * V * (Cnp * p + Cnr * r)
+
+		so their partials with respect to the body velocities are products of
+		rho, V and u_j / V, and with respect to p3 (altitude = -p3) they pick up
+		-d(rho)/d(altitude).
+	*/
+
+	auto Jij = [&](std::size_t i, std::size_t j) -> double& { return J[12 * i + j]; };
+
+	std::fill(J.begin(), J.end(), 0.0);
+
+	// Assign current state values to variable names
+	double u_b_mps = x[0];
+	double v_b_mps = x[1];
+	double w_b_mps = x[2];
+	double p_b_rps = x[3];
+	double q_b_rps = x[4];
+	double r_b_rps = x[5];
+	double p3_n_m = x[11];
+	double uvw[3] = { u_b_mps, v_b_mps, w_b_mps };
+
+	// Euler angle trig and DCM
+	EulerAttitude::Frame<double> frame = EulerAttitude::frame(x);
+	const auto& C_b2n = frame.C_b2n;
+	double s_phi = frame.s_phi;
+	double c_phi = frame.c_phi;
+	double s_theta = frame.s_theta;
+	double c_theta = frame.c_theta;
+	double t_theta = frame.t_theta;
+	const double gz_n_mps2 = ConstantGravity::gz_n_mps2;
+
+	// Air data
+	AtmosphereProperties atmosphere = computeAtmosphere(-p3_n_m);
+	double rho_kgpm3 = atmosphere.air_density;
+	double drho_dp3 = -atmosphere.air_density_gradient;
+	double true_airspeed_mps = std::sqrt(u_b_mps * u_b_mps + v_b_mps * v_b_mps + w_b_mps * w_b_mps);
+
+	// dV/du_j = u_j / V, taken as zero at V = 0 where every term it multiplies vanishes
+	double dV_duvw[3] = { 0.0, 0.0, 0.0 };
+	if (true_airspeed_mps > 0.0)
+	{
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			dV_duvw[j] = uvw[j] / true_airspeed_mps;
+		}
+	}
+
+	// Drag force F_i = -k * rho * V * u_i, divided by mass
+	double k_over_m = 0.5 * vehicle.CD_approx * vehicle.Aref_m2 * vehicle.inv_m_kg;
+	double a_over_m[3];
+	for (std::size_t i = 0; i < 3; ++i)
+	{
+		a_over_m[i] = -k_over_m * rho_kgpm3 * true_airspeed_mps * uvw[i];
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			double dVu = (i == j ? true_airspeed_mps : 0.0) + uvw[i] * dV_duvw[j];
+			Jij(i, j) = -k_over_m * rho_kgpm3 * dVu;
+		}
+		Jij(i, 11) = -k_over_m * drho_dp3 * true_airspeed_mps * uvw[i];
+	}
+
+	// Damping moments, zero below the Cl_brick/Cm_brick/Cn_brick airspeed threshold
+	double l_b = 0.0, m_b = 0.0, n_b = 0.0;
+	double dl[12] = {}, dm[12] = {}, dn[12] = {};
+	if (true_airspeed_mps >= 1e-6)
+	{
+		double a_b = 0.25 * vehicle.Aref_m2 * vehicle.b_m * vehicle.b_m;
+		double a_c = 0.25 * vehicle.Aref_m2 * vehicle.c_m * vehicle.c_m;
+		double Cl_rate = a_b * (vehicle.Clp * p_b_rps + vehicle.Clr * r_b_rps);
+		double Cm_rate = a_c * vehicle.Cmq * q_b_rps;
+		double Cn_rate = a_b * (vehicle.Cnp * p_b_rps + vehicle.Cnr * r_b_rps);
+		double rho_V = rho_kgpm3 * true_airspeed_mps;
+
+		l_b = rho_V * Cl_rate;
+		m_b = rho_V * Cm_rate;
+		n_b = rho_V * Cn_rate;
+
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			dl[j] = rho_kgpm3 * dV_duvw[j] * Cl_rate;
+			dm[j] = rho_kgpm3 * dV_duvw[j] * Cm_rate;
+			dn[j] = rho_kgpm3 * dV_duvw[j] * Cn_rate;
+		}
+		dl[3] = rho_V * a_b * vehicle.Clp;
+		dl[5] = rho_V * a_b * vehicle.Clr;
+		dm[4] = rho_V * a_c * vehicle.Cmq;
+		dn[3] = rho_V * a_b * vehicle.Cnp;
+		dn[5] = rho_V * a_b * vehicle.Cnr;
+		dl[11] = drho_dp3 * true_airspeed_mps * Cl_rate;
+		dm[11] = drho_dp3 * true_airspeed_mps * Cm_rate;
+		dn[11] = drho_dp3 * true_airspeed_mps * Cn_rate;
+	}
+
+	// Translational dynamics
+	dx[0] = a_over_m[0] - gz_n_mps2 * s_theta - w_b_mps * q_b_rps + v_b_mps * r_b_rps;
+	dx[1] = a_over_m[1] + gz_n_mps2 * s_phi * c_theta - u_b_mps * r_b_rps + w_b_mps * p_b_rps;
+	dx[2] = a_over_m[2] + gz_n_mps2 * c_phi * c_theta - v_b_mps * p_b_rps + u_b_mps * q_b_rps;
+
+	Jij(0, 1) += r_b_rps;
+	Jij(0, 2) += -q_b_rps;
+	Jij(0, 4) = -w_b_mps;
+	Jij(0, 5) = v_b_mps;
+	Jij(0, 7) = -gz_n_mps2 * c_theta;
+
+	Jij(1, 0) += -r_b_rps;
+	Jij(1, 2) += p_b_rps;
+	Jij(1, 3) = w_b_mps;
+	Jij(1, 5) = -u_b_mps;
+	Jij(1, 6) = gz_n_mps2 * c_phi * c_theta;
+	Jij(1, 7) = -gz_n_mps2 * s_phi * s_theta;
+
+	Jij(2, 0) += q_b_rps;
+	Jij(2, 1) += -p_b_rps;
+	Jij(2, 3) = -v_b_mps;
+	Jij(2, 4) = u_b_mps;
+	Jij(2, 6) = -gz_n_mps2 * s_phi * c_theta;
+	Jij(2, 7) = -gz_n_mps2 * c_phi * s_theta;
+
+	// Rotational dynamics
+	dx[3] = vehicle.roll_pq * p_b_rps * q_b_rps - vehicle.roll_qr * q_b_rps * r_b_rps +
+		vehicle.roll_l * l_b + vehicle.roll_n * n_b;
+	dx[4] = vehicle.pitch_pr * p_b_rps * r_b_rps - vehicle.pitch_pp_rr *
+		(p_b_rps * p_b_rps - r_b_rps * r_b_rps) + vehicle.inv_Jyy * m_b;
+	dx[5] = vehicle.yaw_pq * p_b_rps * q_b_rps + vehicle.yaw_qr * q_b_rps * r_b_rps +
+		vehicle.yaw_l * l_b + vehicle.yaw_n * n_b;
+
+	for (std::size_t j = 0; j < 12; ++j)
+	{
+		Jij(3, j) = vehicle.roll_l * dl[j] + vehicle.roll_n * dn[j];
+		Jij(4, j) = vehicle.inv_Jyy * dm[j];
+		Jij(5, j) = vehicle.yaw_l * dl[j] + vehicle.yaw_n * dn[j];
+	}
+
+	Jij(3, 3) += vehicle.roll_pq * q_b_rps;
+	Jij(3, 4) += vehicle.roll_pq * p_b_rps - vehicle.roll_qr * r_b_rps;
+	Jij(3, 5) += -vehicle.roll_qr * q_b_rps;
+
+	Jij(4, 3) += vehicle.pitch_pr * r_b_rps - 2.0 * vehicle.pitch_pp_rr * p_b_rps;
+	Jij(4, 5) += vehicle.pitch_pr * p_b_rps + 2.0 * vehicle.pitch_pp_rr * r_b_rps;
+
+	Jij(5, 3) += vehicle.yaw_pq * q_b_rps;
+	Jij(5, 4) += vehicle.yaw_pq * p_b_rps + vehicle.yaw_qr * r_b_rps;
+	Jij(5, 5) += vehicle.yaw_qr * q_b_rps;
+
+	// Kinematic equations
+	double q_s_phi_r_c_phi = s_phi * q_b_rps + c_phi * r_b_rps;
+	double q_c_phi_r_s_phi = c_phi * q_b_rps - s_phi * r_b_rps;
+	double sec_theta = 1.0 / c_theta;
+
+	dx[6] = p_b_rps + t_theta * q_s_phi_r_c_phi;
+	dx[7] = q_c_phi_r_s_phi;
+	dx[8] = q_s_phi_r_c_phi * sec_theta;
+
+	Jij(6, 3) = 1.0;
+	Jij(6, 4) = t_theta * s_phi;
+	Jij(6, 5) = t_theta * c_phi;
+	Jij(6, 6) = t_theta * q_c_phi_r_s_phi;
+	Jij(6, 7) = q_s_phi_r_c_phi * sec_theta * sec_theta;
+
+	Jij(7, 4) = c_phi;
+	Jij(7, 5) = -s_phi;
+	Jij(7, 6) = -q_s_phi_r_c_phi;
+
+	Jij(8, 4) = s_phi * sec_theta;
+	Jij(8, 5) = c_phi * sec_theta;
+	Jij(8, 6) = q_c_phi_r_s_phi * sec_theta;
+	Jij(8, 7) = q_s_phi_r_c_phi * t_theta * sec_theta;
+
+	// Position (navigation) equations
+	for (std::size_t i = 0; i < 3; ++i)
+	{
+		dx[9 + i] = C_b2n[i][0] * u_b_mps + C_b2n[i][1] * v_b_mps + C_b2n[i][2] * w_b_mps;
+
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			Jij(9 + i, j) = C_b2n[i][j];
+		}
+
+		// d(C_b2n)/d(phi) maps columns (2, 3) to (3, -2)
+		Jij(9 + i, 6) = C_b2n[i][2] * v_b_mps - C_b2n[i][1] * w_b_mps;
+	}
+
+	// d(C_b2n)/d(theta): rows 1 and 2 become cos(psi) and sin(psi) times row 3,
+	// which applied to (u, v, w) is dx[11]
+	Jij(9, 7) = frame.c_psi * dx[11];
+	Jij(10, 7) = frame.s_psi * dx[11];
+	Jij(11, 7) = -c_theta * u_b_mps - s_phi * s_theta * v_b_mps - c_phi * s_theta * w_b_mps;
+
+	// d(C_b2n)/d(psi): row 1 becomes -row 2, row 2 becomes row 1
+	Jij(9, 8) = -dx[10];
+	Jij(10, 8) = dx[9];
+}
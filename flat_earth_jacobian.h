@@ -0,0 +1,33 @@
+#pragma once
+#ifndef FLAT_EARTH_JACOBIAN_H
+#define FLAT_EARTH_JACOBIAN_H
+
+#include <span>
+#include "spheres.h"
+
+// Analytic Jacobian of the 12-state flat-earth EoM (flat_earth_eom_inplace).
+// Evaluates the RHS into dx and df/dx into J in the same pass, sharing the
+// trig, DCM, air data and aero terms. J is row-major: J[12 * i + j] = d(dx[i]) / d(x[j]).
+// Includes the USSA1976 density gradient and the airspeed-dependent drag and
+// damping terms.
+void flat_earth_jacobian(
+	double t,
+	std::span<const double> x,
+	const VehicleParams& vehicle,
+	std::span<double, 12> dx,
+	std::span<double, 144> J
+);
+
+// flat_earth_jacobian as the Jacobian callable of RosenbrockStepper
+// (adaptive_integrators.h), paired with FlatEarthRhs<>
+struct FlatEarthJacobian
+{
+	const VehicleParams& vehicle;
+
+	void operator()(double t, std::span<const double> x, std::span<double> dx, std::span<double> J) const
+	{
+		flat_earth_jacobian(t, x, vehicle, dx.first<12>(), J.first<144>());
+	}
+};
+
+#endif // FLAT_EARTH_JACOBIAN_H
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+#include "flat_earth_parareal.h"
+#include "flat_earth_ensemble.h"
+#include "flat_earth_eom_kernel.h"
+
+namespace
+{
+	double elapsed_ms(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+std::vector<PararealSpeedup> parareal_speedup_report(double tf_s, double h_s, const PararealOptions& options, std::size_t num_threads)
+{
+	/*  Arguments:
+
+		tf_s - final time [s]
+
+		h_s - fine RK4 step [s], shared by the serial and the Parareal run
+
+		options - Parareal slices, coarse step and tolerance
+
+		num_threads - pool size; 0 uses one thread per core
+	*/
+
+	std::size_t nt = static_cast<std::size_t>(std::floor(tf_s / h_s + 0.5)) + 1;
+	std::vector<double> t_s(nt);
+	for (std::size_t i = 0; i < nt; ++i)
+	{
+		t_s[i] = static_cast<double>(i) * h_s;
+	}
+
+	ThreadPool pool(num_threads);
+	std::vector<PararealSpeedup> report;
+
+	for (VehiclePreset preset : { VehiclePreset::NASA_Atmos01_Sphere, VehiclePreset::NASA_Atmos02_Brick, VehiclePreset::NASA_Atmos03_Brick })
+	{
+		VehicleParams vehicle = makeVehicle(preset);
+		FlatEarthRhs<> f{ vehicle };
+		std::array<double, 12> x0_array = check_case_initial_state(preset);
+		std::vector<double> x0(x0_array.begin(), x0_array.end());
+
+		Trajectory trajectory(x0.size(), t_s);
+		trajectory.set_row(0, x0);
+
+		auto start = std::chrono::steady_clock::now();
+		RK4Stepper serial(f, x0.size());
+		integrate(serial, trajectory, h_s);
+		double serial_ms = elapsed_ms(start);
+
+		start = std::chrono::steady_clock::now();
+		PararealRun run = parareal(RK4Stepper(f, x0.size()), RK4Stepper(f, x0.size()), t_s, x0, h_s, options, pool);
+		double parareal_ms = elapsed_ms(start);
+
+		double deviation = 0.0;
+		for (std::size_t i = 0; i < nt; ++i)
+		{
+			for (std::size_t j = 0; j < x0.size(); ++j)
+			{
+				deviation = std::max(deviation, std::abs(run.trajectory(i, j) - trajectory(i, j)) / (1.0 + std::abs(trajectory(i, j))));
+			}
+		}
+
+		PararealSpeedup speedup{};
+		speedup.preset = preset;
+		speedup.threads = pool.size();
+		speedup.slices = std::min(options.slices, nt - 1);
+		speedup.iterations = run.iterations;
+		speedup.converged = run.converged;
+		speedup.serial_ms = serial_ms;
+		speedup.parareal_ms = parareal_ms;
+		speedup.speedup = serial_ms / parareal_ms;
+		speedup.eval_speedup = static_cast<double>(serial.rhs_evals()) / static_cast<double>(run.critical_path_evals);
+		speedup.max_deviation = deviation;
+
+		report.push_back(speedup);
+	}
+
+	return report;
+}
+
+void print_parareal_report(std::ostream& out, double tf_s, double h_s, const PararealOptions& options, std::size_t num_threads)
+{
+	std::vector<PararealSpeedup> report = parareal_speedup_report(tf_s, h_s, options, num_threads);
+
+	out << "Parareal vs serial RK4, h = " << h_s << " s, coarse RK4 h = " << options.h_coarse_s << " s, " << tf_s << " s, "
+		<< (report.empty() ? options.slices : report.front().slices) << " slices, " << (report.empty() ? 0 : report.front().threads) << " threads:\n";
+	out << std::left << std::setw(22) << "preset" << std::right
+		<< std::setw(8) << "iters" << std::setw(12) << "serial [ms]" << std::setw(14) << "parareal [ms]"
+		<< std::setw(10) << "speedup" << std::setw(12) << "eval bound" << std::setw(12) << "deviation" << "\n";
+
+	std::ios_base::fmtflags flags = out.flags();
+	for (const PararealSpeedup& speedup : report)
+	{
+		out << std::left << std::setw(22) << preset_name(speedup.preset) << std::right << std::fixed
+			<< std::setw(8) << speedup.iterations
+			<< std::setprecision(1) << std::setw(12) << speedup.serial_ms << std::setw(14) << speedup.parareal_ms
+			<< std::setprecision(2) << std::setw(10) << speedup.speedup << std::setw(12) << speedup.eval_speedup
+			<< std::scientific << std::setprecision(2) << std::setw(12) << speedup.max_deviation
+			<< (speedup.converged ? "" : "  not converged") << "\n";
+	}
+	out.flags(flags);
+}
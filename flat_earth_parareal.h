@@ -0,0 +1,36 @@
+#pragma once
+#ifndef FLAT_EARTH_PARAREAL_H
+#define FLAT_EARTH_PARAREAL_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+#include "parareal.h"
+#include "spheres.h"
+
+// Parareal against a serial RK4 run of the same fine grid, for one check case
+struct PararealSpeedup
+{
+	VehiclePreset preset;
+	std::size_t threads;
+	std::size_t slices;
+	std::size_t iterations;
+	bool converged;
+	double serial_ms;             // wall time of serial RK4
+	double parareal_ms;           // wall time of the Parareal run
+	double speedup;               // serial_ms / parareal_ms
+	double eval_speedup;          // serial RHS evaluations / Parareal critical-path evaluations
+	double max_deviation;         // largest |x - x_serial| / (1 + |x_serial|) over the grid
+};
+
+// Runs the NASA Atmos 01/02/03 check cases (see check_case_initial_state) to
+// tf_s with fine RK4 steps of h_s, serially and with Parareal (RK4 at
+// options.h_coarse_s as the coarse propagator) on a pool of num_threads
+// (0: one per core). eval_speedup is the speedup with one core per slice and
+// no threading overhead, an upper bound for the measured one.
+std::vector<PararealSpeedup> parareal_speedup_report(double tf_s, double h_s, const PararealOptions& options, std::size_t num_threads = 0);
+
+// Prints parareal_speedup_report as a table
+void print_parareal_report(std::ostream& out, double tf_s, double h_s, const PararealOptions& options, std::size_t num_threads = 0);
+
+#endif // FLAT_EARTH_PARAREAL_H
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include "integrator_checkpoint.h"
+
+namespace
+{
+	constexpr char MAGIC[8] = { 'F', 'E', 'C', 'K', 'P', 'T', '\0', '\1' };
+	constexpr std::uint32_t VERSION = 2;
+	constexpr std::size_t HEADER_BYTES = 104;
+	constexpr std::size_t METHOD_BYTES = 32;
+	constexpr std::size_t CHECKSUM_BYTES = 8;
+
+	static_assert(std::endian::native == std::endian::little, "checkpoint files are little-endian; add byte swapping for this target");
+
+	template <class T>
+	void put(std::vector<std::byte>& out, std::size_t offset, T value)
+	{
+		std::memcpy(out.data() + offset, &value, sizeof(T));
+	}
+
+	template <class T>
+	T get(const std::vector<std::byte>& in, std::size_t offset)
+	{
+		T value;
+		std::memcpy(&value, in.data() + offset, sizeof(T));
+		return value;
+	}
+
+	std::uint64_t checksum(std::span<const std::byte> bytes)
+	{
+		return ParameterHash().add(bytes).value();
+	}
+}
+
+void write_checkpoint(const std::string& path, const IntegratorCheckpoint& checkpoint)
+{
+	/*  Arguments:
+
+		path - checkpoint file, replaced once the new one is complete
+
+		checkpoint - run and stepper state to save
+	*/
+
+	if (checkpoint.stepper_method.size() > METHOD_BYTES)
+	{
+		throw std::invalid_argument("write_checkpoint: stepper method name longer than 32 characters: " + checkpoint.stepper_method);
+	}
+
+	std::size_t x_bytes = checkpoint.x.size() * sizeof(double);
+	std::vector<std::byte> bytes(HEADER_BYTES + x_bytes + checkpoint.stepper_state.size() + CHECKSUM_BYTES);
+
+	std::memcpy(bytes.data(), MAGIC, sizeof(MAGIC));
+	put<std::uint32_t>(bytes, 8, VERSION);
+	put<std::uint32_t>(bytes, 12, static_cast<std::uint32_t>(checkpoint.x.size()));
+	put<std::uint64_t>(bytes, 16, checkpoint.parameter_hash);
+	put<std::uint64_t>(bytes, 24, checkpoint.steps);
+	put<double>(bytes, 32, checkpoint.t0_s);
+	put<double>(bytes, 40, checkpoint.t_s);
+	put<double>(bytes, 48, checkpoint.h_s);
+	put<std::uint64_t>(bytes, 56, checkpoint.stepper_state.size());
+	std::memcpy(bytes.data() + 64, checkpoint.stepper_method.data(), checkpoint.stepper_method.size());
+	put<std::uint32_t>(bytes, 96, checkpoint.stepper_order);
+	std::memcpy(bytes.data() + HEADER_BYTES, checkpoint.x.data(), x_bytes);
+	std::copy(checkpoint.stepper_state.begin(), checkpoint.stepper_state.end(), bytes.begin() + static_cast<std::ptrdiff_t>(HEADER_BYTES + x_bytes));
+
+	std::size_t body = bytes.size() - CHECKSUM_BYTES;
+	put<std::uint64_t>(bytes, body, checksum(std::span<const std::byte>(bytes.data(), body)));
+
+	// Write beside the old checkpoint, then swap it in with one rename
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		out.close();
+		if (!out)
+		{
+			throw std::runtime_error("write_checkpoint: cannot write " + temporary);
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+	{
+		throw std::runtime_error("write_checkpoint: cannot replace " + path + ": " + error.message());
+	}
+}
+
+IntegratorCheckpoint read_checkpoint(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+	{
+		throw std::runtime_error("read_checkpoint: cannot open " + path);
+	}
+
+	std::vector<char> chars((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	std::vector<std::byte> bytes(chars.size());
+	std::memcpy(bytes.data(), chars.data(), chars.size());
+
+	if (bytes.size() < HEADER_BYTES + CHECKSUM_BYTES || std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0)
+	{
+		throw std::runtime_error("read_checkpoint: not a checkpoint file: " + path);
+	}
+	if (get<std::uint32_t>(bytes, 8) != VERSION)
+	{
+		throw std::runtime_error("read_checkpoint: unsupported version in " + path);
+	}
+
+	IntegratorCheckpoint checkpoint;
+	std::size_t num_states = get<std::uint32_t>(bytes, 12);
+	std::uint64_t stepper_bytes = get<std::uint64_t>(bytes, 56);
+	std::size_t body = bytes.size() - CHECKSUM_BYTES;
+
+	if (stepper_bytes > body || HEADER_BYTES + num_states * sizeof(double) + stepper_bytes != body
+		|| get<std::uint64_t>(bytes, body) != checksum(std::span<const std::byte>(bytes.data(), body)))
+	{
+		throw std::runtime_error("read_checkpoint: truncated or corrupted file: " + path);
+	}
+
+	checkpoint.parameter_hash = get<std::uint64_t>(bytes, 16);
+	checkpoint.steps = static_cast<std::size_t>(get<std::uint64_t>(bytes, 24));
+	checkpoint.t0_s = get<double>(bytes, 32);
+	checkpoint.t_s = get<double>(bytes, 40);
+	checkpoint.h_s = get<double>(bytes, 48);
+
+	const char* method = reinterpret_cast<const char*>(bytes.data() + 64);
+	checkpoint.stepper_method.assign(method, std::find(method, method + METHOD_BYTES, '\0'));
+	checkpoint.stepper_order = get<std::uint32_t>(bytes, 96);
+
+	checkpoint.x.resize(num_states);
+	std::memcpy(checkpoint.x.data(), bytes.data() + HEADER_BYTES, num_states * sizeof(double));
+
+	auto state = bytes.begin() + static_cast<std::ptrdiff_t>(HEADER_BYTES + num_states * sizeof(double));
+	checkpoint.stepper_state.assign(state, state + static_cast<std::ptrdiff_t>(stepper_bytes));
+	return checkpoint;
+}
+
+bool checkpoint_exists(const std::string& path)
+{
+	std::error_code error;
+	return std::filesystem::exists(path, error);
+}
+
+void remove_checkpoint(const std::string& path)
+{
+	std::error_code error;
+	std::filesystem::remove(path, error);
+}
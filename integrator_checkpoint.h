@@ -0,0 +1,354 @@
+#pragma once
+#ifndef INTEGRATOR_CHECKPOINT_H
+#define INTEGRATOR_CHECKPOINT_H
+
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "numerical_integration_methods.h"
+
+/*  Checkpoint and restart of a run (.feckpt files).
+
+	A checkpoint holds what the next step depends on: the time, the state, the
+	step count from t0_s (which keeps fixed steps on their grid), h_s and the
+	stepper's own state, i.e. the multistep derivative history, the FSAL stage
+	and next step size of an adaptive stepper, and the last step for
+	interpolate(). Restored into a stepper built the same way, the run
+	continues bit for bit as if it had never stopped. The stepper's method and
+	order are stored too, and resuming with another stepper throws, even when
+	its state happens to have the same size (AB2Stepper and the RK4-started
+	AdamsBashforthStepper<F, 2>, say).
+
+	Steppers take part through one member template that both saves and
+	restores, e.g.
+
+		template <class Archive>
+		void checkpoint(Archive& archive) { archive(k1, h_s, num_evals); }
+
+	together with a tag naming the method, e.g.
+
+		integrator_detail::StepperTag checkpoint_tag() const { return { "RK4", 4 }; }
+
+	ForwardEuler, RK4, Adams-Bashforth(-Moulton) and Dormand-Prince have both.
+
+	The vehicle and environment are not stored, only a 64-bit hash of them
+	(flat_earth_checkpoint.h builds one), so a checkpoint is a few hundred
+	bytes and cannot be resumed against a changed model.
+
+	File layout, little-endian:
+
+		  0  char[8]   magic "FECKPT\0\1"
+		  8  uint32    version (2)
+		 12  uint32    num_states
+		 16  uint64    parameter_hash
+		 24  uint64    steps              taken since t0_s
+		 32  float64   t0_s
+		 40  float64   t_s
+		 48  float64   h_s
+		 56  uint64    stepper_bytes
+		 64  char[32]  stepper method     NUL padded
+		 96  uint32    stepper order
+		100  uint32    reserved (0)
+		104  float64   x[num_states]
+		     byte      stepper state[stepper_bytes]
+		     uint64    FNV-1a of everything before it
+
+	write_checkpoint() writes a temporary file and renames it over the old
+	checkpoint, so a run killed while writing leaves the previous one intact.
+*/
+
+// FNV-1a, 64 bit, over the bytes of the values added to it
+class ParameterHash
+{
+public:
+	ParameterHash& add(std::span<const std::byte> bytes)
+	{
+		for (std::byte b : bytes)
+		{
+			hash = (hash ^ static_cast<std::uint64_t>(b)) * 0x100000001b3ull;
+		}
+		return *this;
+	}
+
+	ParameterHash& add(double value) { return add(std::as_bytes(std::span<const double>(&value, 1))); }
+
+	// Length first, so "ab" + "c" and "a" + "bc" differ
+	ParameterHash& add(std::string_view text)
+	{
+		std::uint64_t length = text.size();
+		add(std::as_bytes(std::span<const std::uint64_t>(&length, 1)));
+		return add(std::as_bytes(std::span<const char>(text.data(), text.size())));
+	}
+
+	std::uint64_t value() const { return hash; }
+
+private:
+	std::uint64_t hash = 0xcbf29ce484222325ull;
+};
+
+struct IntegratorCheckpoint
+{
+	std::uint64_t parameter_hash = 0;
+	std::size_t steps = 0;
+	double t0_s = 0.0;
+	double t_s = 0.0;
+	double h_s = 0.0;
+	std::string stepper_method;          // from the stepper's checkpoint_tag()
+	std::uint32_t stepper_order = 0;
+	std::vector<double> x;
+	std::vector<std::byte> stepper_state;
+};
+
+namespace integrator_detail
+{
+	// Integers (counters, ring buffer positions) are stored as uint64 so a
+	// checkpoint reads back on a target with another size_t
+	template <class T>
+	using CheckpointField = std::conditional_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, std::uint64_t, T>;
+}
+
+// Archive that appends a stepper's fields to bytes
+class CheckpointWriter
+{
+public:
+	template <class... T>
+	void operator()(T&... values)
+	{
+		(put(values), ...);
+	}
+
+	std::vector<std::byte> bytes;
+
+private:
+	template <class T> requires std::is_arithmetic_v<T>
+	void put(const T& value)
+	{
+		integrator_detail::CheckpointField<T> stored = static_cast<integrator_detail::CheckpointField<T>>(value);
+		std::size_t size = bytes.size();
+		bytes.resize(size + sizeof(stored));
+		std::memcpy(bytes.data() + size, &stored, sizeof(stored));
+	}
+
+	void put(const std::vector<double>& values)
+	{
+		put(static_cast<std::uint64_t>(values.size()));
+		std::size_t size = bytes.size();
+		bytes.resize(size + values.size() * sizeof(double));
+		std::memcpy(bytes.data() + size, values.data(), values.size() * sizeof(double));
+	}
+};
+
+// Archive that reads the fields back in the same order. Vectors keep their
+// size; a field that does not fit means the checkpoint came from another
+// kind or size of stepper, and throws std::runtime_error.
+class CheckpointReader
+{
+public:
+	explicit CheckpointReader(std::span<const std::byte> bytes) : bytes(bytes) {}
+
+	template <class... T>
+	void operator()(T&... values)
+	{
+		(get(values), ...);
+	}
+
+	// Every byte was read
+	bool done() const { return pos == bytes.size(); }
+
+private:
+	void take(void* out, std::size_t size)
+	{
+		if (size > bytes.size() - pos)
+		{
+			throw std::runtime_error("checkpoint: stepper state ends early; was it written by another stepper?");
+		}
+		std::memcpy(out, bytes.data() + pos, size);
+		pos += size;
+	}
+
+	template <class T> requires std::is_arithmetic_v<T>
+	void get(T& value)
+	{
+		integrator_detail::CheckpointField<T> stored;
+		take(&stored, sizeof(stored));
+		value = static_cast<T>(stored);
+	}
+
+	void get(std::vector<double>& values)
+	{
+		std::uint64_t size = 0;
+		get(size);
+		if (size != values.size())
+		{
+			throw std::runtime_error("checkpoint: stepper state does not match the stepper's size");
+		}
+		take(values.data(), values.size() * sizeof(double));
+	}
+
+	std::span<const std::byte> bytes;
+	std::size_t pos = 0;
+};
+
+// Replaces path atomically; throws std::runtime_error if it cannot
+void write_checkpoint(const std::string& path, const IntegratorCheckpoint& checkpoint);
+
+// Throws std::runtime_error for a missing, truncated or corrupted file
+IntegratorCheckpoint read_checkpoint(const std::string& path);
+
+bool checkpoint_exists(const std::string& path);
+void remove_checkpoint(const std::string& path);
+
+template <class Stepper>
+std::vector<std::byte> save_stepper_state(Stepper& stepper)
+{
+	static_assert(requires(Stepper& s, CheckpointWriter& archive) { s.checkpoint(archive); }, "this stepper has no checkpoint(archive) member");
+	CheckpointWriter archive;
+	stepper.checkpoint(archive);
+	return std::move(archive.bytes);
+}
+
+template <class Stepper>
+void restore_stepper_state(Stepper& stepper, std::span<const std::byte> state)
+{
+	static_assert(requires(Stepper& s, CheckpointReader& archive) { s.checkpoint(archive); }, "this stepper has no checkpoint(archive) member");
+	CheckpointReader archive(state);
+	stepper.checkpoint(archive);
+	if (!archive.done())
+	{
+		throw std::runtime_error("checkpoint: stepper state is longer than the stepper; was it written by another stepper?");
+	}
+}
+
+struct CheckpointOptions
+{
+	std::string path;                    // checkpoint file; empty turns checkpointing off
+	std::uint64_t parameter_hash = 0;    // of the vehicle and environment, e.g. flat_earth_parameter_hash()
+	std::size_t interval_steps = 0;      // write every interval_steps steps; 0: not by count
+	double interval_wall_s = 0.0;        // write once this much wall time has passed; 0: not by time
+	bool resume = true;                  // continue from path if it exists
+};
+
+template <class Stepper, class Observer>
+std::vector<double> integrate_checkpointed(Stepper& stepper, double t0_s, const std::vector<double>& x0, double tf_s, Observer&& observer,
+	const CheckpointOptions& options, double h_s = 0.0)
+{
+	/*  Arguments:
+
+		stepper - fixed-step or adaptive stepper with a checkpoint() member,
+		built for x0.size() states
+
+		t0_s, tf_s - start and end time [s]
+
+		x0 - initial state; ignored when resuming
+
+		observer - as for integrate_observed(), but a resumed run only calls it
+		for the steps after the checkpoint
+
+		options - checkpoint file, parameter hash and intervals
+
+		h_s - step size [s] of a fixed-step stepper; ignored by adaptive ones
+
+		Resumes from options.path when it exists and options.resume is set; a
+		checkpoint of another model (parameter_hash), another run (t0_s, h_s),
+		another stepper (method and order) or another state size throws
+		std::runtime_error rather than starting over. The checkpoint is removed once the run reaches tf_s. Returns the
+		state at tf_s.
+	*/
+
+	static_assert(requires(const Stepper& s) { { s.checkpoint_tag() } -> std::same_as<integrator_detail::StepperTag>; }, "this stepper has no checkpoint_tag() member");
+
+	if constexpr (std::is_void_v<decltype(stepper.step(t0_s, std::span<double>(), h_s))>)
+	{
+		if (h_s <= 0.0)
+		{
+			throw std::invalid_argument("integrate_checkpointed: a fixed-step stepper needs h_s > 0");
+		}
+	}
+
+	bool checkpointing = !options.path.empty();
+	std::vector<double> x = x0;
+	double t = t0_s;
+	std::size_t i = 0;
+
+	if (checkpointing && options.resume && checkpoint_exists(options.path))
+	{
+		IntegratorCheckpoint checkpoint = read_checkpoint(options.path);
+		if (checkpoint.parameter_hash != options.parameter_hash)
+		{
+			throw std::runtime_error("integrate_checkpointed: " + options.path + " was written for other vehicle or environment parameters");
+		}
+		if (checkpoint.t0_s != t0_s || checkpoint.h_s != h_s || checkpoint.x.size() != x0.size())
+		{
+			throw std::runtime_error("integrate_checkpointed: " + options.path + " was written by a run with another t0_s, h_s or state size");
+		}
+		integrator_detail::StepperTag tag = stepper.checkpoint_tag();
+		if (checkpoint.stepper_method != tag.method || checkpoint.stepper_order != tag.order)
+		{
+			throw std::runtime_error("integrate_checkpointed: " + options.path + " was written by " + checkpoint.stepper_method + " of order "
+				+ std::to_string(checkpoint.stepper_order) + ", not " + std::string(tag.method) + " of order " + std::to_string(tag.order));
+		}
+
+		restore_stepper_state(stepper, checkpoint.stepper_state);
+		x = std::move(checkpoint.x);
+		t = checkpoint.t_s;
+		i = checkpoint.steps;
+	}
+	else
+	{
+		observer(t, std::span<const double>(x));
+	}
+
+	auto save = [&]()
+	{
+		IntegratorCheckpoint checkpoint;
+		checkpoint.parameter_hash = options.parameter_hash;
+		checkpoint.steps = i;
+		checkpoint.t0_s = t0_s;
+		checkpoint.t_s = t;
+		checkpoint.h_s = h_s;
+		integrator_detail::StepperTag tag = stepper.checkpoint_tag();
+		checkpoint.stepper_method = tag.method;
+		checkpoint.stepper_order = static_cast<std::uint32_t>(tag.order);
+		checkpoint.x = x;
+		checkpoint.stepper_state = save_stepper_state(stepper);
+		write_checkpoint(options.path, checkpoint);
+	};
+
+	auto last_save = std::chrono::steady_clock::now();
+	while (t < tf_s)
+	{
+		double h = integrator_detail::advance(stepper, t, x, h_s, tf_s);
+		++i;
+		t = integrator_detail::step_end_time<Stepper>(t0_s, t, i, h, h_s, tf_s);
+		observer(t, std::span<const double>(x));
+
+		if (checkpointing && t < tf_s)
+		{
+			bool by_count = options.interval_steps > 0 && i % options.interval_steps == 0;
+			bool by_time = options.interval_wall_s > 0.0
+				&& std::chrono::duration<double>(std::chrono::steady_clock::now() - last_save).count() >= options.interval_wall_s;
+			if (by_count || by_time)
+			{
+				save();
+				last_save = std::chrono::steady_clock::now();
+			}
+		}
+	}
+
+	if (checkpointing)
+	{
+		remove_checkpoint(options.path);
+	}
+	return x;
+}
+
+#endif // INTEGRATOR_CHECKPOINT_H
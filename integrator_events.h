@@ -0,0 +1,315 @@
+#pragma once
+#ifndef INTEGRATOR_EVENTS_H
+#define INTEGRATOR_EVENTS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "numerical_integration_methods.h"
+
+/*  Zero-crossing events for the steppers.
+
+	An event is a function g(t, x) whose sign change marks something happening:
+	altitude through zero, Mach through one, dynamic pressure through a limit
+	(see flat_earth_events.h). After every step each g is compared between the
+	two ends of the step; a crossing is then located by Illinois root finding
+	on g(t, interpolate(t)), the stepper's dense output, so locating it costs
+	no RHS evaluations.
+
+	At the crossing the event stops the run, is only recorded, or applies a
+	reset map to the state (a bounce) and the run restarts from there.
+*/
+
+enum class EventAction
+{
+	Stop,    // end the run at the crossing
+	Record,  // log the crossing and carry on
+	Reset    // change the state at the crossing with Event::reset and carry on
+};
+
+enum class EventDirection
+{
+	Any,
+	Rising,   // g goes from negative to zero or positive
+	Falling   // g goes from positive to zero or negative
+};
+
+struct Event
+{
+	std::string name;
+	std::function<double(double t, std::span<const double> x)> g;
+	EventDirection direction = EventDirection::Any;
+	EventAction action = EventAction::Stop;
+
+	// Reset map for EventAction::Reset, applied to the state at the crossing.
+	// Returning false stops the run there instead (e.g. a bounce too slow to
+	// leave the ground).
+	std::function<bool(double t, std::span<double> x)> reset;
+};
+
+// One located crossing; x is the state at t_s, before any reset
+struct EventRecord
+{
+	std::size_t event;  // index into the event list
+	double t_s;
+	std::vector<double> x;
+};
+
+struct EventRun
+{
+	Trajectory trajectory;                 // t0_s, step ends and the time of a Stop or Reset crossing (twice for a reset: before and after the map); Record crossings are only in events
+	std::vector<EventRecord> events;       // every crossing, in time order
+	bool stopped = false;                  // a Stop event (or a declined reset) ended the run before tf_s
+};
+
+namespace integrator_detail
+{
+	inline bool crosses(EventDirection direction, double g0, double g1)
+	{
+		bool rising = g0 < 0.0 && g1 >= 0.0;
+		bool falling = g0 > 0.0 && g1 <= 0.0;
+
+		switch (direction)
+		{
+		case EventDirection::Rising: return rising;
+		case EventDirection::Falling: return falling;
+		default: return rising || falling;
+		}
+	}
+
+	// Illinois (modified regula falsi) on g over [t0, t1] where g changes sign.
+	// Returns a time on the far side of the crossing, within a few ulps of it,
+	// so the state there has crossed.
+	template <class Stepper>
+	double locate_crossing(const Stepper& stepper, const Event& event, double t0, double g0, double t1, double g1, std::vector<double>& x_buffer)
+	{
+		if (g1 == 0.0)
+		{
+			return t1;
+		}
+
+		double a = t0;
+		double b = t1;
+		double ga = g0;
+		double gb = g1;
+		int retained = 0;
+
+		for (int iteration = 0; iteration < 100; ++iteration)
+		{
+			if (b - a <= 4.0 * std::numeric_limits<double>::epsilon() * std::max(1.0, std::abs(b)))
+			{
+				break;
+			}
+
+			double c = b - gb * (b - a) / (gb - ga);
+			if (!(c > a && c < b))
+			{
+				c = 0.5 * (a + b);
+			}
+
+			stepper.interpolate(c, x_buffer);
+			double gc = event.g(c, x_buffer);
+
+			if (gc == 0.0)
+			{
+				return c;
+			}
+
+			if ((gc > 0.0) == (gb > 0.0))
+			{
+				// c is on the far side: move b, halve the stale end if it was kept twice
+				b = c;
+				gb = gc;
+				if (retained == -1)
+				{
+					ga *= 0.5;
+				}
+				retained = -1;
+			}
+			else
+			{
+				a = c;
+				ga = gc;
+				if (retained == 1)
+				{
+					gb *= 0.5;
+				}
+				retained = 1;
+			}
+		}
+
+		return b;
+	}
+
+	// A step that starts exactly on g = 0 (right after a reset onto the event
+	// surface, e.g. a bounce) can leave the surface and cross back within the
+	// step, with no sign change between its ends. Sample the dense output and
+	// move the start of the search to the sample farthest on the side opposite
+	// to g at the end of the step.
+	template <class Stepper>
+	void leave_surface(const Stepper& stepper, const Event& event, double& t0, double& g0, double t1, double g1, std::vector<double>& x_buffer)
+	{
+		constexpr int samples = 8;
+		double side = g1 > 0.0 ? -1.0 : 1.0;
+
+		for (int k = 1; k < samples; ++k)
+		{
+			double t = t0 + (t1 - t0) * k / samples;
+			stepper.interpolate(t, x_buffer);
+			double g = event.g(t, x_buffer);
+			if (side * g > side * g0)
+			{
+				t0 = t;
+				g0 = g;
+			}
+		}
+	}
+}
+
+template <class Stepper>
+EventRun integrate_with_events(Stepper& stepper, double t0_s, const std::vector<double>& x0, double tf_s, const std::vector<Event>& events, double h_s = 0.0)
+{
+	/*  Arguments:
+
+		stepper - any stepper with dense output, built for x0.size() states
+
+		t0_s, tf_s - start and end time [s]
+
+		x0 - initial state
+
+		events - zero-crossing events, checked after every step
+
+		h_s - step size [s] of a fixed-step stepper; ignored by adaptive ones
+
+		Runs until tf_s or until a Stop event. Crossings inside one step are
+		handled in time order; a Stop or Reset ends the step at its time, so a
+		crossing later in the same step is only seen if it recurs after the
+		reset.
+	*/
+
+	if constexpr (std::is_void_v<decltype(stepper.step(t0_s, std::span<double>(), h_s))>)
+	{
+		if (h_s <= 0.0)
+		{
+			throw std::invalid_argument("integrate_with_events: a fixed-step stepper needs h_s > 0");
+		}
+	}
+
+	for (const Event& event : events)
+	{
+		if (event.action == EventAction::Reset && !event.reset)
+		{
+			throw std::invalid_argument("integrate_with_events: event '" + event.name + "' resets but has no reset map");
+		}
+	}
+
+	std::size_t nx = x0.size();
+	std::size_t ne = events.size();
+
+	EventRun run;
+	run.trajectory = Trajectory(nx, 0);
+
+	std::vector<double> x = x0;
+	std::vector<double> x_event(nx);
+	std::vector<double> g_start(ne), g_end(ne);
+
+	// Crossings of one step; reserved once so the loop does not allocate for them
+	std::vector<std::pair<double, std::size_t>> crossings;
+	crossings.reserve(ne);
+
+	// Fixed steps count from the last restart (t0_s or a reset) to stay on its grid
+	double t = t0_s;
+	double t_grid_s = t0_s;
+	std::size_t i = 0;
+	run.trajectory.append(t, x);
+
+	for (std::size_t e = 0; e < ne; ++e)
+	{
+		g_start[e] = events[e].g(t, x);
+	}
+
+	while (t < tf_s)
+	{
+		double h = integrator_detail::advance(stepper, t, x, h_s, tf_s);
+		++i;
+		double t_end = integrator_detail::step_end_time<Stepper>(t_grid_s, t, i, h, h_s, tf_s);
+
+		// Locate every crossing in this step and take them in time order
+		crossings.clear();
+		for (std::size_t e = 0; e < ne; ++e)
+		{
+			g_end[e] = events[e].g(t_end, x);
+
+			double t_from = t;
+			double g_from = g_start[e];
+			if (g_from == 0.0 && g_end[e] != 0.0)
+			{
+				integrator_detail::leave_surface(stepper, events[e], t_from, g_from, t_end, g_end[e], x_event);
+			}
+
+			if (integrator_detail::crosses(events[e].direction, g_from, g_end[e]))
+			{
+				double t_cross = integrator_detail::locate_crossing(stepper, events[e], t_from, g_from, t_end, g_end[e], x_event);
+				crossings.emplace_back(t_cross, e);
+			}
+		}
+		std::sort(crossings.begin(), crossings.end());
+
+		bool step_cut = false;
+		for (const auto& [t_cross, e] : crossings)
+		{
+			stepper.interpolate(t_cross, x_event);
+			run.events.push_back({ e, t_cross, x_event });
+
+			if (events[e].action == EventAction::Record)
+			{
+				continue;
+			}
+
+			// Stop or Reset: the trajectory ends at the crossing
+			run.trajectory.append(t_cross, x_event);
+
+			if (events[e].action == EventAction::Stop || !events[e].reset(t_cross, x_event))
+			{
+				run.stopped = true;
+				return run;
+			}
+
+			run.trajectory.append(t_cross, x_event);
+			x = x_event;
+			t = t_cross;
+			t_grid_s = t_cross;
+			i = 0;
+			if constexpr (requires { stepper.reset(); })
+			{
+				stepper.reset();
+			}
+
+			for (std::size_t k = 0; k < ne; ++k)
+			{
+				g_start[k] = events[k].g(t, x);
+			}
+			step_cut = true;
+			break;
+		}
+
+		if (!step_cut)
+		{
+			t = t_end;
+			g_start = g_end;
+			run.trajectory.append(t, x);
+		}
+	}
+
+	return run;
+}
+
+#endif // INTEGRATOR_EVENTS_H
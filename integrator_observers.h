@@ -0,0 +1,298 @@
+#pragma once
+#ifndef INTEGRATOR_OBSERVERS_H
+#define INTEGRATOR_OBSERVERS_H
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "numerical_integration_methods.h"
+
+/*  Streaming output for long runs.
+
+	integrate() and integrate_adaptive() fill an nx x nt Trajectory, which
+	grows with duration / h (a 10 h run at 1 ms is 3.5 GB of doubles).
+	integrate_observed() keeps only the current state and hands each step end
+	to an observer, any callable
+
+		observer(double t, std::span<const double> x)
+
+	The observers here use constant memory, whatever the length of the run:
+
+		Decimator           forwards every k-th state to another observer
+		RingBufferObserver  keeps the last N states
+		FileSinkObserver    writes CSV rows as the run goes
+		StatisticsObserver  running min / max / mean / standard deviation
+
+	Several observers take one stream through observe_all(a, b, ...). Observers
+	passed as lvalues are held by reference, so their results are read from
+	the caller's objects once the run ends.
+*/
+
+template <class Stepper, class Observer>
+std::vector<double> integrate_observed(Stepper& stepper, double t0_s, const std::vector<double>& x0, double tf_s, Observer&& observer, double h_s = 0.0)
+{
+	/*  Arguments:
+
+		stepper - fixed-step or adaptive stepper built for x0.size() states
+
+		t0_s, tf_s - start and end time [s]
+
+		x0 - initial state
+
+		observer - called with t0_s and x0, then with every step end; the last
+		step lands on tf_s
+
+		h_s - step size [s] of a fixed-step stepper; ignored by adaptive ones
+
+		Returns the state at tf_s.
+	*/
+
+	if constexpr (std::is_void_v<decltype(stepper.step(t0_s, std::span<double>(), h_s))>)
+	{
+		if (h_s <= 0.0)
+		{
+			throw std::invalid_argument("integrate_observed: a fixed-step stepper needs h_s > 0");
+		}
+	}
+
+	std::vector<double> x = x0;
+	double t = t0_s;
+	observer(t, std::span<const double>(x));
+
+	std::size_t i = 0;
+	while (t < tf_s)
+	{
+		double h = integrator_detail::advance(stepper, t, x, h_s, tf_s);
+		++i;
+		t = integrator_detail::step_end_time<Stepper>(t0_s, t, i, h, h_s, tf_s);
+		observer(t, std::span<const double>(x));
+	}
+
+	return x;
+}
+
+
+// Forwards the first state and every k-th one after it
+template <class Inner>
+class Decimator
+{
+public:
+	Decimator(std::size_t every, Inner&& inner) : every(std::max<std::size_t>(1, every)), inner(std::forward<Inner>(inner)) {}
+
+	void operator()(double t, std::span<const double> x)
+	{
+		if (count++ % every == 0)
+		{
+			inner(t, x);
+		}
+	}
+
+private:
+	std::size_t every;
+	Inner inner;
+	std::size_t count = 0;
+};
+
+// Lvalue observers are held by reference, temporaries by value
+template <class Inner>
+Decimator(std::size_t, Inner&&) -> Decimator<Inner>;
+
+
+// The last `capacity` states, in one preallocated block
+class RingBufferObserver
+{
+public:
+	RingBufferObserver(std::size_t num_states, std::size_t capacity)
+		: nx(num_states), t_s(capacity), x_flat(capacity * num_states)
+	{
+		if (capacity == 0)
+		{
+			throw std::invalid_argument("RingBufferObserver: capacity must be positive");
+		}
+	}
+
+	void operator()(double t, std::span<const double> x)
+	{
+		std::size_t slot = (first + count) % t_s.size();
+		if (count == t_s.size())
+		{
+			first = (first + 1) % t_s.size();
+		}
+		else
+		{
+			++count;
+		}
+
+		t_s[slot] = t;
+		std::copy(x.begin(), x.begin() + nx, x_flat.begin() + slot * nx);
+	}
+
+	std::size_t size() const { return count; }
+	std::size_t capacity() const { return t_s.size(); }
+
+	// Entry i, oldest first
+	double time(std::size_t i) const { return t_s[index(i)]; }
+	std::span<const double> state(std::size_t i) const { return std::span<const double>(x_flat).subspan(index(i) * nx, nx); }
+
+	void clear() { first = count = 0; }
+
+private:
+	std::size_t index(std::size_t i) const
+	{
+		if (i >= count)
+		{
+			throw std::out_of_range("RingBufferObserver: index past the stored states");
+		}
+		return (first + i) % t_s.size();
+	}
+
+	std::size_t nx;
+	std::vector<double> t_s;
+	std::vector<double> x_flat;  // x_flat[slot * nx + state]
+	std::size_t first = 0;
+	std::size_t count = 0;
+};
+
+
+// CSV rows "t,x0,x1,..." written while the run goes; shortest round-trip
+// formatting, so the file reads back to the same doubles
+class FileSinkObserver
+{
+public:
+	// header - column names after "t"; empty writes no header row
+	explicit FileSinkObserver(const std::string& path, const std::vector<std::string>& header = {})
+		: out(path, std::ios::out | std::ios::trunc)
+	{
+		if (!out)
+		{
+			throw std::runtime_error("FileSinkObserver: cannot open " + path);
+		}
+
+		if (!header.empty())
+		{
+			out << "t_s";
+			for (const std::string& name : header)
+			{
+				out << ',' << name;
+			}
+			out << '\n';
+		}
+	}
+
+	void operator()(double t, std::span<const double> x)
+	{
+		char row[32 * 32];
+		char* end = row + sizeof(row);
+		char* p = std::to_chars(row, end, t).ptr;
+
+		for (double value : x)
+		{
+			// Flush a nearly full row buffer for very wide states
+			if (end - p < 32)
+			{
+				out.write(row, p - row);
+				p = row;
+			}
+			*p++ = ',';
+			p = std::to_chars(p, end, value).ptr;
+		}
+		*p++ = '\n';
+		out.write(row, p - row);
+		++rows;
+	}
+
+	std::size_t rows_written() const { return rows; }
+	void flush() { out.flush(); }
+
+private:
+	std::ofstream out;
+	std::size_t rows = 0;
+};
+
+
+// Running per-state statistics (Welford's update for the variance)
+class StatisticsObserver
+{
+public:
+	explicit StatisticsObserver(std::size_t num_states)
+		: min_values(num_states, std::numeric_limits<double>::infinity()),
+		  max_values(num_states, -std::numeric_limits<double>::infinity()),
+		  t_min(num_states), t_max(num_states), means(num_states), m2(num_states) {}
+
+	void operator()(double t, std::span<const double> x)
+	{
+		++count;
+		double inv_count = 1.0 / static_cast<double>(count);
+
+		for (std::size_t j = 0; j < means.size(); ++j)
+		{
+			double value = x[j];
+			if (value < min_values[j])
+			{
+				min_values[j] = value;
+				t_min[j] = t;
+			}
+			if (value > max_values[j])
+			{
+				max_values[j] = value;
+				t_max[j] = t;
+			}
+
+			double delta = value - means[j];
+			means[j] += delta * inv_count;
+			m2[j] += delta * (value - means[j]);
+		}
+	}
+
+	std::size_t samples() const { return count; }
+	double min(std::size_t j) const { return min_values[j]; }
+	double max(std::size_t j) const { return max_values[j]; }
+	double time_of_min(std::size_t j) const { return t_min[j]; }
+	double time_of_max(std::size_t j) const { return t_max[j]; }
+	double mean(std::size_t j) const { return means[j]; }
+
+	// Population standard deviation over the samples seen (each step end
+	// weighs the same, whatever the step length)
+	double standard_deviation(std::size_t j) const { return count > 0 ? std::sqrt(m2[j] / static_cast<double>(count)) : 0.0; }
+
+private:
+	std::vector<double> min_values, max_values;
+	std::vector<double> t_min, t_max;
+	std::vector<double> means, m2;
+	std::size_t count = 0;
+};
+
+
+// Several observers on one stream, called in order
+template <class... Observers>
+class ObserverList
+{
+public:
+	explicit ObserverList(Observers&&... observers) : observers(std::forward<Observers>(observers)...) {}
+
+	void operator()(double t, std::span<const double> x)
+	{
+		std::apply([&](auto&... observer) { (observer(t, x), ...); }, observers);
+	}
+
+private:
+	std::tuple<Observers...> observers;
+};
+
+template <class... Observers>
+ObserverList<Observers...> observe_all(Observers&&... observers)
+{
+	return ObserverList<Observers...>(std::forward<Observers>(observers)...);
+}
+
+#endif // INTEGRATOR_OBSERVERS_H
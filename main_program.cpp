@@ -2,20 +2,38 @@
 //
 
 #include "numerical_integration_methods.h"
+#include "integrator_observers.h"
 #include "flat_earth_eom.h"
 #include "matplotlibcpp.h"
 #include "ussa1976.h"
 #include "spheres.h"
+#include "trajectory_file.h"
 
 namespace plt = matplotlibcpp;
 
 
-int main()
+int main(int argc, char* argv[])
 {
     /*
     Part 1: Initialization of simulation
     */
 
+    // Command line: --fetraj <path> also saves the run as a .fetraj file
+    std::string fetraj_path;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--fetraj" && i + 1 < argc)
+        {
+            fetraj_path = argv[++i];
+        }
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--fetraj <path>]\n";
+            return 1;
+        }
+    }
+
 
     // Conversions
     double r2d = 180 / std::numbers::pi;
@@ -97,26 +115,39 @@ int main()
     Part 2: Numerically approximate solutions to the governing equations
     */
 
-    // Preallocate the solution array
-    std::vector<double> t_s; // creating empty solution vector
+    // Keep at most max_points samples for post-processing and plots; longer runs
+    // are decimated while they integrate, so memory does not grow with tf_s / h_s
+    const std::size_t max_points = 10000;
+    std::size_t num_steps = static_cast<std::size_t>(std::ceil((tf_s - t0_s) / h_s - 1e-9));
+    std::size_t every = std::max<std::size_t>(1, (num_steps + max_points - 1) / max_points);
 
-    for (double t = t0_s; t <= tf_s; t += h_s)  // Assigning size of vector using start, end and time step
-    {
-        t_s.push_back(t);
-    }
+    // Channel-major: each state is one contiguous channel for post-processing and plots
+    Trajectory ux(nx0, 0, TrajectoryLayout::ChannelMajor);
+    ux.reserve(num_steps / every + 2);
 
-    std::size_t nt_s = t_s.size();
+    // Compile the vehicle once; the map overload would redo it on every RHS call
+    const VehicleParams vehicle = compileVehicle(amod);
 
-    std::vector<std::vector<double>> x(nx0, std::vector<double>(nt_s)); // making a 2d solution array with proper size
+    // Perform forward Euler integration, keeping only the current state
+    ForwardEulerStepper stepper([&](double t, std::span<const double> x, std::span<double> dx) {
+        flat_earth_eom_inplace(t, x, vehicle, dx.first<12>());
+    }, nx0);
 
-    // Assign the initial conditions, x0, to solution array x
-    for (std::size_t i = 0; i < x.size(); ++i)
+    integrate_observed(stepper, t0_s, x0, tf_s, Decimator(every, [&](double t, std::span<const double> x) {
+        ux.append(t, x);
+    }), h_s);
+
+    std::size_t nt_s = ux.num_times();
+
+    // Save the run for post-processing outside the simulator (format in trajectory_file.h).
+    // The sample times are stored as integrated: the last step may be shortened
+    // to land on tf_s, so they are not always t0 + k * dt.
+    if (!fetraj_path.empty())
     {
-        x[i][0] = x0[i];
+        write_trajectory_file(fetraj_path, ux, flat_earth_state_channels());
     }
 
-    // Perform forward Euler integration
-    const auto [ut_s, ux] = forward_euler(flat_earth_eom, t_s, x, h_s, amod, airmod); // THIS MAY NEED FIXING
+    const std::vector<double> ut_s(ux.times().begin(), ux.times().end());
 
     // data post-processing actions
 
@@ -126,14 +157,14 @@ int main()
     std::vector<double> True_Airspeed_mps(nt_s, 0.0); // Initialize a vector with nt_s elements, all set to 0.0
 
     for (std::size_t i = 0; i < nt_s; ++i) {
-        True_Airspeed_mps[i] = std::sqrt(std::pow(ux[0][i], 2) + std::pow(ux[1][i], 2) + std::pow(ux[2][i], 2));
+        True_Airspeed_mps[i] = std::sqrt(std::pow(ux(i, 0), 2) + std::pow(ux(i, 1), 2) + std::pow(ux(i, 2), 2));
     }
 
     // Angle of attack
     std::vector<double> Alpha_rad(nt_s, 0.0); // Initialize a vector with nt_s elements, all set to 0.0
 
     for(std::size_t i = 0; i < nt_s; ++i){
-        Alpha_rad[i] = std::atan2(ux[2][i], ux[0][i]);
+        Alpha_rad[i] = std::atan2(ux(i, 2), ux(i, 0));
 
     }
 
@@ -141,13 +172,13 @@ int main()
     //     double w_over_v = 0.0;
 
 
-    //     if (ux[0][i] == 0.0 && ux[2][i] == 0.0)
+    //     if (ux(i, 0) == 0.0 && ux(i, 2) == 0.0)
     //     {
     //         w_over_v = 0.0; // To avoid division by zero
     //     }
     //     else
     //     {
-    //         w_over_v = ux[2][i] / ux[0][i];
+    //         w_over_v = ux(i, 2) / ux(i, 0);
     //     }
 
     //     Alpha_rad[i] = std::atan(w_over_v); // Compute the angle of attack in radians
@@ -163,14 +194,14 @@ int main()
     {
         double v_over_VT = 0.0;
 
-        if (ux[1][i] == 0 && True_Airspeed_mps[i] == 0)
+        if (ux(i, 1) == 0 && True_Airspeed_mps[i] == 0)
         {
             v_over_VT = 0;
         }
 
         else
         {
-            v_over_VT = ux[1][i] / True_Airspeed_mps[i];
+            v_over_VT = ux(i, 1) / True_Airspeed_mps[i];
         }
         Beta_rad[i] = std::asin(v_over_VT);
     }
@@ -184,15 +215,16 @@ int main()
         Mach[i] = True_Airspeed_mps[i] / c_mps;
     }
 
-     std::cout << "The numerical ternimal velocity is " << ux[0].back() << " m/s. \n" ;
+     std::cout << "The numerical ternimal velocity is " << ux(nt_s - 1, 0) << " m/s. \n" ;
+
     /*
     Part 3: Plot Data
     */
 
     std::cout << "hi";
     std::cout << "t_s size: " << ut_s.size() << "\n";
-    for (std::size_t i = 0; i < ux.size(); ++i) {
-        std::cout << "x[" << i << "] size: " << ux[i].size() << "\n";
+    for (std::size_t i = 0; i < ux.num_states(); ++i) {
+        std::cout << "x[" << i << "] size: " << ux.channel(i).size() << "\n";
     }
 
     // Figure 1. tanslational and rotational states
@@ -201,56 +233,56 @@ int main()
 
     // Subplot 1: Axial Velocity u^b_CM/n
     plt::subplot(2, 4, 1);
-    plt::plot(ut_s, ux[0], { {"color", "red"} });
+    plt::plot(ut_s, ux.channel(0).to_vector(), { {"color", "red"} });
     plt::xlabel("Time [s]", { {"color", "black"} });
     plt::ylabel("u [m/s]", { {"color", "black"} });
     plt::grid(true);
 
     // // Subplot 2: y-axis velocity v^b_CM/n
     plt::subplot(2, 4, 2);
-    plt::plot(ut_s, ux[1], { {"color", "red"} });
+    plt::plot(ut_s, ux.channel(1).to_vector(), { {"color", "red"} });
     plt::xlabel("Time [s]", { {"color", "black"} });
     plt::ylabel("v [m/s]", { {"color", "black"} });
     plt::grid(true);
 
     // // Subplot 3: z-axis velocity w^b_CM/n
     plt::subplot(2, 4, 3);
-    plt::plot(ut_s, ux[2], { {"color", "red"} });
+    plt::plot(ut_s, ux.channel(2).to_vector(), { {"color", "red"} });
     plt::xlabel("Time [s]", { {"color", "black"} });
     plt::ylabel("w [m/s]", { {"color", "black"} });
     plt::grid(true);
 
     // // Subplot 4: Roll angle, phi
     plt::subplot(2, 4, 4);
-    plt::plot(ut_s, ux[6], { {"color", "yellow"} });
+    plt::plot(ut_s, ux.channel(6).to_vector(), { {"color", "yellow"} });
     plt::xlabel("Time [s]", { {"color", "black"} });
     plt::ylabel("phi [rad]", { {"color", "black"} });
     plt::grid(true);
 
     // // Subplot 5: Roll rate p^b_b/n
     plt::subplot(2, 4, 5);
-    plt::plot(ut_s, ux[3], { {"color", "blue"} });
+    plt::plot(ut_s, ux.channel(3).to_vector(), { {"color", "blue"} });
     plt::xlabel("Time [s]", { {"color", "black"} });
     plt::ylabel("p [r/s]", { {"color", "black"} });
     plt::grid(true);
 
     // // Subplot 6: Pitch rate q^b_b/n
     plt::subplot(2, 4, 6);
-    plt::plot(ut_s, ux[4], { {"color", "blue"} });
+    plt::plot(ut_s, ux.channel(4).to_vector(), { {"color", "blue"} });
     plt::xlabel("Time [s]", { {"color", "black"} });
     plt::ylabel("q [r/s]", { {"color", "black"} });
     plt::grid(true);
 
     // // Subplot 7: Yaw rate r^b_b/n
     plt::subplot(2, 4, 7);
-    plt::plot(ut_s, ux[5], { {"color", "blue"} });
+    plt::plot(ut_s, ux.channel(5).to_vector(), { {"color", "blue"} });
     plt::xlabel("Time [s]", { {"color", "black"} });
     plt::ylabel("r [r/s]", { {"color", "black"} });
     plt::grid(true);
 
     // // Subplot 8: Pitch angle, theta
     plt::subplot(2, 4, 8);
-    plt::plot(ut_s, ux[7], { {"color", "yellow"} });
+    plt::plot(ut_s, ux.channel(7).to_vector(), { {"color", "yellow"} });
     plt::xlabel("Time [s]", { {"color", "black"} });
     plt::ylabel("theta [rad]", { {"color", "black"} });
     plt::grid(true);
@@ -266,20 +298,20 @@ int main()
 
     // North position p1^n_CM/T
     plt::subplot(2, 3, 1);
-    plt::plot(ut_s, ux[9], { {"color", "cyan"} });
+    plt::plot(ut_s, ux.channel(9).to_vector(), { {"color", "cyan"} });
     plt::xlabel("Time [s]", { {"color" , "black"} });
     plt::ylabel("North [m]", { {"color" , "black"} });
     plt::grid(true);
 
     // East position p^2n_CM/T
     plt::subplot(2, 3, 2);
-    plt::plot(ut_s, ux[10], { {"color" , "cyan"} });
+    plt::plot(ut_s, ux.channel(10).to_vector(), { {"color" , "cyan"} });
     plt::xlabel("Time [s]", { {"color" , "black"} });
     plt::ylabel("East [m]", { {"color" , "black"} });
     plt::grid(true);
 
     std::vector<double> plotAlt;
-    for (const auto& value : ux[11]) {  // Access the 12th row
+    for (const auto& value : ux.channel(11)) {  // Access the 12th row
         plotAlt.push_back(-value); // Negate each value and store it
     }
    
@@ -294,21 +326,21 @@ int main()
 
     //North vs East position p2^n_CM/T
     plt::subplot(2, 3, 4);
-    plt::plot(ux[10], ux[9], { {"color" , "cyan"} });
+    plt::plot(ux.channel(10).to_vector(), ux.channel(9).to_vector(), { {"color" , "cyan"} });
     plt::xlabel("East [m]", { {"color" , "black"} });
     plt::ylabel("North [m]", { {"color" , "black"} });
     plt::grid(true);
 
     //Altitude vs East position p2^n_CM/T
     plt::subplot(2, 3, 5);
-    plt::plot(ux[10], plotAlt, { {"color" , "cyan"} });
+    plt::plot(ux.channel(10).to_vector(), plotAlt, { {"color" , "cyan"} });
     plt::xlabel("East [m]", { {"color" , "black"} });
     plt::ylabel("Altitude [m]", { {"color" , "black"} });
     plt::grid(true);
 
     //Altitude vs North 
     plt::subplot(2, 3, 6);
-    plt::plot(ux[9], plotAlt, { {"color" , "cyan"} });
+    plt::plot(ux.channel(9).to_vector(), plotAlt, { {"color" , "cyan"} });
     plt::xlabel("North [m]", { {"color" , "black"} });
     plt::ylabel("Altitude [m]", { {"color" , "black"} });
     plt::grid(true);
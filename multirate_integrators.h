@@ -0,0 +1,315 @@
+#pragma once
+#ifndef MULTIRATE_INTEGRATORS_H
+#define MULTIRATE_INTEGRATORS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "numerical_integration_methods.h"
+
+/*  Multirate RK4: the rotational block substepped inside the translational step.
+
+	The state splits into a fast block, x[fast_begin .. fast_end) (body rates and
+	attitude, states 3-8 of the Euler layout and 3-9 of the quaternion layout),
+	and a slow block, the velocities and position around it. One macro step h
+	is taken fastest first:
+
+	1. The slow block over the step is predicted by the cubic Hermite through
+	   the last two step ends and their derivatives, extrapolated forward
+	   (local error O(h^4), no RHS evaluations).
+	2. The fast block takes `substeps` RK4 substeps of h / substeps with the
+	   slow states read from that prediction, through f_fast, which only has to
+	   write the fast entries of dx (FlatEarthRotationalRhs skips gravity, drag
+	   force and navigation).
+	3. The slow block takes one RK4 step of h with the full f, its stage states
+	   completed by the fast solution at t, t + h/2 and t + h.
+
+	So a macro step costs 4 full evaluations plus 4 * substeps fast-block ones,
+	against 4 * substeps full evaluations for single-rate RK4 at the fast step.
+	The first step after construction or reset() has no history to predict
+	from: it is taken twice, first with the slow block on its tangent, then
+	with the Hermite through both ends of that first pass.
+*/
+
+template <class F, class FFast>
+class MultirateRK4Stepper
+{
+public:
+	MultirateRK4Stepper(F f, FFast f_fast, std::size_t num_states, std::size_t substeps,
+		std::size_t fast_begin = 3, std::size_t fast_end = 0)
+		: f(std::move(f)), f_fast(std::move(f_fast)), substeps(substeps), fast_begin(fast_begin),
+		  fast_end(fast_end == 0 ? num_states - 3 : fast_end), x_stage(num_states), k1(num_states), k2(num_states),
+		  k3(num_states), k4(num_states), x_fast(num_states), kf1(num_states), kf2(num_states), kf3(num_states),
+		  kf4(num_states), x_previous(num_states), f_previous(num_states), x_guess(num_states), f_guess(num_states),
+		  x_trial(num_states), last(num_states)
+	{
+		/*  Arguments:
+
+			f - full right-hand side, f(t, x, dx)
+
+			f_fast - fast-block right-hand side with the same signature; writes
+			dx[fast_begin .. fast_end) only
+
+			num_states - state size (12 Euler, 13 quaternion)
+
+			substeps - fast substeps per macro step, at least 1
+
+			fast_begin, fast_end - fast block; fast_end = 0 takes everything up to
+			the position (num_states - 3)
+		*/
+
+		if (substeps == 0 || this->fast_begin >= this->fast_end || this->fast_end > num_states)
+		{
+			throw std::invalid_argument("MultirateRK4Stepper: needs substeps >= 1 and a fast block inside the state");
+		}
+
+		std::size_t nf = this->fast_end - this->fast_begin;
+		fast_nodes.resize((substeps + 1) * nf);
+		fast_slopes.resize((substeps + 1) * nf);
+		fast_mid.resize(nf);
+	}
+
+	std::size_t size() const { return x_stage.size(); }
+	std::size_t rhs_evals() const { return num_evals; }
+	std::size_t fast_rhs_evals() const { return num_fast_evals; }
+	std::size_t steps() const { return num_steps; }
+
+	// Drops the slow-block history; the next step starts up again
+	void reset() { have_previous = false; }
+
+	void step(double t, std::span<double> x, double h_s)
+	{
+		integrator_detail::check_size(x, x_stage.size());
+		last.begin(t, x, h_s);
+
+		f(t, std::span<const double>(x), k1);
+		++num_evals;
+
+		if (have_previous)
+		{
+			prediction = Prediction::History;
+			advance(t, x, h_s);
+		}
+		else
+		{
+			// Startup: a first pass with the slow block held on its tangent, then
+			// the step again with the Hermite through both ends of that pass
+			for (std::size_t j = 0; j < x.size(); ++j)
+			{
+				x_guess[j] = x[j] + h_s * k1[j];
+			}
+			std::copy(k1.begin(), k1.end(), f_guess.begin());
+			prediction = Prediction::Startup;
+
+			std::copy(x.begin(), x.end(), x_trial.begin());
+			advance(t, x_trial, h_s);
+
+			std::copy(x_trial.begin(), x_trial.end(), x_guess.begin());
+			std::copy(k4.begin(), k4.end(), f_guess.begin());
+			advance(t, x, h_s);
+		}
+
+		// History for the next prediction: this step's start and its derivative
+		t_previous = t;
+		std::copy(last.x_start.begin(), last.x_start.end(), x_previous.begin());
+		std::copy(k1.begin(), k1.end(), f_previous.begin());
+		have_previous = true;
+
+		integrator_detail::renormalize(x);
+		last.end(x);
+		++num_steps;
+	}
+
+	// State at time t within the last step: the RK4 continuous extension for the
+	// slow block and a cubic Hermite over the fast substep containing t
+	void interpolate(double t, std::span<double> x_out) const
+	{
+		double theta = last.theta(t);
+		double theta2 = theta * theta;
+		double theta3 = theta2 * theta;
+		double b1 = theta - 1.5 * theta2 + (2.0 / 3.0) * theta3;
+		double b23 = theta2 - (2.0 / 3.0) * theta3;
+		double b4 = -0.5 * theta2 + (2.0 / 3.0) * theta3;
+
+		for (std::size_t j = 0; j < x_out.size(); ++j)
+		{
+			x_out[j] = last.x_start[j] + last.h_s * (b1 * k1[j] + b23 * (k2[j] + k3[j]) + b4 * k4[j]);
+		}
+
+		std::size_t nf = fast_end - fast_begin;
+		double h = last.h_s / static_cast<double>(substeps);
+		double position = std::clamp(theta, 0.0, 1.0) * static_cast<double>(substeps);
+		std::size_t i = std::min(static_cast<std::size_t>(position), substeps - 1);
+
+		integrator_detail::hermite_cubic(position - static_cast<double>(i), h,
+			node(fast_nodes, i), node(fast_slopes, i), node(fast_nodes, i + 1), node(fast_slopes, i + 1),
+			x_out.subspan(fast_begin, nf));
+		integrator_detail::renormalize(x_out);
+	}
+
+private:
+	// Where the slow block of the fast sweep comes from: extrapolated from the
+	// previous and the current step start, or (first step) interpolated between
+	// the step start and a guess of its end
+	enum class Prediction
+	{
+		History,
+		Startup
+	};
+
+	std::span<const double> node(const std::vector<double>& nodes, std::size_t i) const
+	{
+		std::size_t nf = fast_end - fast_begin;
+		return std::span<const double>(nodes).subspan(i * nf, nf);
+	}
+
+	// Slow entries of x_out at time tau from the cubic Hermite through two
+	// anchors (see Prediction)
+	void predict_slow(double tau, std::span<double> x_out) const
+	{
+		bool history = prediction == Prediction::History;
+		double t_a = history ? t_previous : last.t_s;
+		double h_ab = history ? last.t_s - t_previous : last.h_s;
+		std::span<const double> x_a = history ? x_previous : last.x_start;
+		std::span<const double> f_a = history ? f_previous : k1;
+		std::span<const double> x_b = history ? last.x_start : x_guess;
+		std::span<const double> f_b = history ? k1 : f_guess;
+
+		double s = (tau - t_a) / h_ab;
+		std::size_t tail = x_out.size() - fast_end;
+
+		integrator_detail::hermite_cubic(s, h_ab, x_a.first(fast_begin), f_a.first(fast_begin),
+			x_b.first(fast_begin), f_b.first(fast_begin), x_out.first(fast_begin));
+		integrator_detail::hermite_cubic(s, h_ab, x_a.last(tail), f_a.last(tail),
+			x_b.last(tail), f_b.last(tail), x_out.last(tail));
+	}
+
+	// One macro step of x from the full derivative k1 at its start
+	void advance(double t, std::span<double> x, double h_s)
+	{
+		fast_sweep(t, x, h_s);
+		slow_step(t, x, h_s);
+	}
+
+	// f_fast at time tau with the fast block x_fast (+ a * k) and the predicted slow block
+	void evaluate_fast(double tau, double a, const std::vector<double>* k, std::vector<double>& out)
+	{
+		predict_slow(tau, x_stage);
+		for (std::size_t j = fast_begin; j < fast_end; ++j)
+		{
+			x_stage[j] = k ? x_fast[j] + a * (*k)[j] : x_fast[j];
+		}
+		f_fast(tau, std::span<const double>(x_stage), out);
+		++num_fast_evals;
+	}
+
+	// Step 2: RK4 substeps of the fast block, keeping the nodes and slopes for
+	// dense output and the fast state at t + h / 2 for the slow stages
+	void fast_sweep(double t, std::span<const double> x, double h_s)
+	{
+		std::size_t nf = fast_end - fast_begin;
+		double h = h_s / static_cast<double>(substeps);
+
+		std::copy(x.begin(), x.end(), x_fast.begin());
+
+		for (std::size_t i = 0; i < substeps; ++i)
+		{
+			double tau = t + static_cast<double>(i) * h;
+
+			evaluate_fast(tau, 0.0, nullptr, kf1);
+			evaluate_fast(tau + 0.5 * h, 0.5 * h, &kf1, kf2);
+			evaluate_fast(tau + 0.5 * h, 0.5 * h, &kf2, kf3);
+			evaluate_fast(tau + h, h, &kf3, kf4);
+
+			for (std::size_t j = 0; j < nf; ++j)
+			{
+				fast_nodes[i * nf + j] = x_fast[fast_begin + j];
+				fast_slopes[i * nf + j] = kf1[fast_begin + j];
+			}
+
+			// Odd substep counts: the midpoint falls inside substep (substeps - 1) / 2
+			if (substeps % 2 == 1 && 2 * i + 1 == substeps)
+			{
+				for (std::size_t j = 0; j < nf; ++j)
+				{
+					std::size_t jj = fast_begin + j;
+					fast_mid[j] = x_fast[jj] + h * ((5.0 / 24.0) * kf1[jj] + (1.0 / 6.0) * (kf2[jj] + kf3[jj]) - (1.0 / 24.0) * kf4[jj]);
+				}
+			}
+
+			for (std::size_t j = fast_begin; j < fast_end; ++j)
+			{
+				x_fast[j] = x_fast[j] + (1.0 / 6.0) * h * (kf1[j] + 2.0 * kf2[j] + 2.0 * kf3[j] + kf4[j]);
+			}
+
+			if (substeps % 2 == 0 && 2 * (i + 1) == substeps)
+			{
+				std::copy(x_fast.begin() + fast_begin, x_fast.begin() + fast_end, fast_mid.begin());
+			}
+		}
+
+		std::copy(x_fast.begin() + fast_begin, x_fast.begin() + fast_end, fast_nodes.begin() + substeps * nf);
+	}
+
+	// Step 3: RK4 on the slow block with the fast block from the sweep; the
+	// fast entries of x take the end of the sweep
+	void slow_step(double t, std::span<double> x, double h_s)
+	{
+		std::size_t nf = fast_end - fast_begin;
+		std::size_t nx = x.size();
+
+		auto stage = [&](double a, const std::vector<double>& k, std::span<const double> fast)
+		{
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				x_stage[j] = x[j] + a * k[j];
+			}
+			std::copy(fast.begin(), fast.end(), x_stage.begin() + fast_begin);
+		};
+
+		std::span<const double> fast_end_state = node(fast_nodes, substeps);
+
+		stage(0.5 * h_s, k1, fast_mid);
+		f(t + 0.5 * h_s, std::span<const double>(x_stage), k2);
+		stage(0.5 * h_s, k2, fast_mid);
+		f(t + 0.5 * h_s, std::span<const double>(x_stage), k3);
+		stage(h_s, k3, fast_end_state);
+		f(t + h_s, std::span<const double>(x_stage), k4);
+		num_evals += 3;
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			if (j < fast_begin || j >= fast_end)
+			{
+				x[j] = x[j] + (1.0 / 6.0) * h_s * (k1[j] + 2.0 * k2[j] + 2.0 * k3[j] + k4[j]);
+			}
+		}
+		std::copy(fast_end_state.begin(), fast_end_state.end(), x.begin() + fast_begin);
+
+		// Slope at the last node from the full evaluation at t + h
+		std::copy(k4.begin() + fast_begin, k4.begin() + fast_end, fast_slopes.begin() + substeps * nf);
+	}
+
+	F f;
+	FFast f_fast;
+	std::size_t substeps;
+	std::size_t fast_begin, fast_end;
+	std::vector<double> x_stage, k1, k2, k3, k4;     // full evaluations; k1..k4 also the slow dense output
+	std::vector<double> x_fast, kf1, kf2, kf3, kf4;  // fast substep state and stages
+	std::vector<double> fast_nodes, fast_slopes;     // fast block and its derivative at each substep boundary
+	std::vector<double> fast_mid;                    // fast block at t + h / 2
+	std::vector<double> x_previous, f_previous;      // start of the previous step and f there
+	std::vector<double> x_guess, f_guess, x_trial;   // startup: guessed step end and the first pass
+	double t_previous = 0.0;
+	bool have_previous = false;
+	Prediction prediction = Prediction::History;
+	integrator_detail::LastStep last;
+	std::size_t num_evals = 0;
+	std::size_t num_fast_evals = 0;
+	std::size_t num_steps = 0;
+};
+
+#endif // MULTIRATE_INTEGRATORS_H
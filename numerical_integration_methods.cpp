@@ -2,6 +2,20 @@
 #include <vector>
 #include <functional>
 #include <string>
+#include <span>
+#include <algorithm>
+
+using MapRhs = std::function<std::vector<double>(double, const std::vector<double>, const std::unordered_map<std::string, double>&, const std::unordered_map<std::string, double>&)>;
+
+// Adapts a map-based RHS to the span form the templated integrators call
+static auto span_rhs(const MapRhs& f, const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double>& airmod)
+{
+	return [&f, &amod, &airmod](double t, std::span<const double> x, std::span<double> dx)
+	{
+		std::vector<double> f_x = f(t, std::vector<double>(x.begin(), x.end()), amod, airmod);
+		std::copy(f_x.begin(), f_x.end(), dx.begin());
+	};
+}
 
 std::pair<std::vector<double>, std::vector<std::vector<double>>> forward_euler(std::function<std::vector<double>(double, const std::vector<double>, const std::unordered_map<std::string, double>&, const std::unordered_map<std::string, double>&)> f, const std::vector<double>& t_s, std::vector<std::vector<double>> sx, double h_s, const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double> airmod)
 {
@@ -13,7 +27,8 @@ std::pair<std::vector<double>, std::vector<std::vector<double>>> forward_euler(s
 		Arguments 
 		f: A function representing the right-hand sode of the differential equation (dx/dt = f(t,x))
 		t_s : A vector of points in time at which numerical solutions will be approximated
-		sx: the numerically approximated solution data to the DE, f
+		sx: the numerically approximated solution data to the DE, f. A 13-row sx is
+		the quaternion layout and has its quaternion renormalized after every step
 		h_s: the step size in seconds 
 		amod: Vehicle model data
 		airmod: Atmosphere data
@@ -21,31 +36,13 @@ std::pair<std::vector<double>, std::vector<std::vector<double>>> forward_euler(s
 		Return
 		t_s: a vector of points in time at which numerical solutions was approximated
 		sx: the numerically approximated solution to the DE, f
+
+		Runs the templated forward_euler (numerical_integration_methods.h)
 	
 	
 	*/
 
-	// Forward Euler numerical integration
-	for (std::size_t i = 1; i < t_s.size(); ++i)
-	{
-		std::vector <double> column;
-		for (const auto& row : sx)
-		{
-			column.push_back(row[i-1]);
-		}
-		std::vector<double> dx = f(t_s[i - 1], column, amod, airmod);
-
-		for (std::size_t j = 0; j < dx.size(); ++j)
-
-		{
-			sx[j][i] = sx[j][i - 1] + h_s * dx[j];
-		}
-		// THIS may need to be changed to a 2d array
-	}
-
-
-	return { t_s, sx };
-
+	return forward_euler(span_rhs(f, amod, airmod), t_s, std::move(sx), h_s);
 }
 
 
@@ -53,43 +50,7 @@ std::pair<std::vector<double>, std::vector<std::vector<double>>> AB2(std::functi
 {
 	// Performs the 2nd order Adams-Bashforth method to approximate the solution of a differential equation.
 
-
-	//Forward Euler method for first step(i=0)
-	std::vector <double> column;
-	for (const auto& row : sx)
-	{
-		column.push_back(row[0]);
-	}
-
-	std::vector<double> dx = f(t_s[0], column, amod, airmod);
-
-	for (std::size_t j = 0; j < dx.size(); ++j)
-	{
-		sx[j][1] = sx[j][0] + h_s * dx[j];
-	}
-
-	//Adams-Bashforth method for i>=1
-	for (std::size_t i = 2; i < t_s.size(); ++i)
-	{
-		std::vector<double> fim1, fim2;
-
-		std::vector<double> column_fim1, column_fim2;
-		for (const auto& row : sx)
-		{
-			column_fim1.push_back(row[i - 1]);
-			column_fim2.push_back(row[i - 2]);
-		}
-
-		fim1 = f(t_s[i - 1], column_fim1, amod, airmod);
-		fim2 = f(t_s[i - 2], column_fim2, amod, airmod);
-
-		for (std::size_t j = 0; j < sx.size(); ++j)
-		{
-			sx[j][i] = sx[j][i - 1] + 1.5 * h_s * fim1[j] - 0.5 * h_s * fim2[j];
-		}
-	}
-
-	return { t_s, sx };
+	return AB2(span_rhs(f, amod, airmod), t_s, std::move(sx), h_s);
 }
 
 
@@ -98,51 +59,25 @@ std::pair<std::vector<double>, std::vector<std::vector<double>>> RK4(std::functi
 
 	// Performs 4th order Runge-Kutta method to approximate solution of a differential equation
 
+	return RK4(span_rhs(f, amod, airmod), t_s, std::move(sx), h_s);
+}
 
-	for (std::size_t i = 1; i < t_s.size(); ++i)
-	{
-		std::vector <double> column;
-		for (const auto& row : sx)
-		{
-			column.push_back(row[i - 1]);
-		}
-
-		std::vector <double> k1 = f(t_s[i - 1], column, amod, airmod);
-
-		std::vector<double> temp_k2(column.size());
-		for (std::size_t j = 0; j < column.size(); ++j)
-		{
-			temp_k2[j] = column[j] + 0.5 * h_s * k1[j];
-		}
-
-		std::vector <double> k2 = f(t_s[i - 1] + 0.5 * h_s, temp_k2, amod, airmod);
-
-
-		std::vector<double> temp_k3(column.size());
-		for (std::size_t j = 0; j < column.size(); ++j)
-		{
-			temp_k3[j] = column[j] + 0.5 * h_s * k2[j];
-		}
-		std::vector<double> k3 = f(t_s[i - 1] + 0.5 * h_s, temp_k3, amod, airmod);
-
-		std::vector<double> temp_k4(column.size());
-		for (std::size_t j = 0; j < column.size(); ++j)
-		{
-			temp_k4[j] = column[j] + h_s * k3[j];
-		}
-
-		std::vector<double> k4 = f(t_s[i - 1] + h_s, temp_k4, amod, airmod);
 
-		// I suspect a shape issue may arise from this
-		for (std::size_t j = 0; j < sx.size(); ++j)
-		{
-			sx[j][i] = sx[j][i - 1] + (1.0 / 6.0) * h_s * (k1[j] + 2.0 * k2[j] + 2.0 * k3[j] + k4[j]);
-		}
+Trajectory forward_euler(std::function<std::vector<double>(double, const std::vector<double>, const std::unordered_map<std::string, double>&, const std::unordered_map<std::string, double>&)> f, Trajectory trajectory, double h_s, const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double> airmod)
+{
+	// forward_euler above on a Trajectory; row 0 holds the initial condition
 
+	return forward_euler(span_rhs(f, amod, airmod), std::move(trajectory), h_s);
+}
 
 
-		}
+Trajectory AB2(std::function<std::vector<double>(double, const std::vector<double>, const std::unordered_map<std::string, double>&, const std::unordered_map<std::string, double>&)> f, Trajectory trajectory, double h_s, const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double> airmod)
+{
+	return AB2(span_rhs(f, amod, airmod), std::move(trajectory), h_s);
+}
 
-	return { t_s, sx };
 
+Trajectory RK4(std::function<std::vector<double>(double, const std::vector<double>, const std::unordered_map<std::string, double>&, const std::unordered_map<std::string, double>&)> f, Trajectory trajectory, double h_s, const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double> airmod)
+{
+	return RK4(span_rhs(f, amod, airmod), std::move(trajectory), h_s);
 }
@@ -6,8 +6,17 @@
 #include <functional>
 #include <utility>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <algorithm>
+#include <span>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <cmath>
+#include <type_traits>
+#include "attitude.h"
+#include "trajectory.h"
 
 
 std::pair<std::vector<double>, std::vector<std::vector<double>>> forward_euler(std::function<std::vector<double>(double, const std::vector<double>, const std::unordered_map<std::string, double>&, const std::unordered_map<std::string, double>&)> f, const std::vector<double>& t_s, std::vector<std::vector<double>> sx, double h_s, const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double> airmod);
@@ -19,5 +28,877 @@ std::pair<std::vector<double>, std::vector<std::vector<double>>> AB2(std::functi
 std::pair<std::vector<double>, std::vector<std::vector<double>>> RK4(std::function<std::vector<double>(double, const std::vector<double>, const std::unordered_map<std::string, double>&, const std::unordered_map<std::string, double>&)> f, const std::vector<double>& t_s, std::vector<std::vector<double>> sx, double h_s, const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double> airmod);
 
 
+// Same, on a Trajectory whose row 0 holds the initial condition (trajectory.h)
+Trajectory forward_euler(std::function<std::vector<double>(double, const std::vector<double>, const std::unordered_map<std::string, double>&, const std::unordered_map<std::string, double>&)> f, Trajectory trajectory, double h_s, const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double> airmod);
+Trajectory AB2(std::function<std::vector<double>(double, const std::vector<double>, const std::unordered_map<std::string, double>&, const std::unordered_map<std::string, double>&)> f, Trajectory trajectory, double h_s, const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double> airmod);
+Trajectory RK4(std::function<std::vector<double>(double, const std::vector<double>, const std::unordered_map<std::string, double>&, const std::unordered_map<std::string, double>&)> f, Trajectory trajectory, double h_s, const std::unordered_map<std::string, double>& amod, const std::unordered_map<std::string, double> airmod);
+
+
+/*  Statically dispatched integrators.
+
+	The right-hand side is any callable
+
+		f(double t, std::span<const double> x, std::span<double> dx)
+
+	(a lambda, or FlatEarthRhs from flat_earth_eom_kernel.h) held by value in a
+	stepper, so the call is direct and the EoM can inline into the stage loop.
+
+	A stepper owns its stage buffers, sized once at construction for a state of
+	num_states, and advances one state vector in place with step(t, x, h): no
+	allocation per step, so it can sit in a real-time loop. A 13-state x is the
+	quaternion layout and has its quaternion renormalized after every step.
+	Every stepper counts its RHS evaluations and steps (rhs_evals(), steps()).
+
+	Steppers: ForwardEulerStepper, RK4Stepper, AdamsBashforthStepper<F, 2..4>
+	(AB2Stepper is order 2 with the original forward Euler start) and
+	AdamsBashforthMoultonStepper<F, 2..4>. The Adams steppers need an explicit
+	order, e.g. AdamsBashforthStepper<decltype(f), 4> stepper(f, 12).
+
+	Each stepper keeps its last step for dense output: interpolate(t, x_out)
+	gives the state at any t inside it from data the step already computed
+	(linear for Euler, the continuous extension of RK4, Hermite for the Adams
+	steppers). integrate_sampled() uses it to emit the solution on an output
+	clock of its own (sample_times) while the integrator keeps its step.
+
+	integrate() runs a stepper over a time grid and writes the solution into a
+	Trajectory (trajectory.h): one aligned block, stepped in place row by row
+	when it is TimeMajor. integrate_sampled() returns one. The older
+	sx[state][time] form of integrate() and the pair-returning forward_euler /
+	AB2 / RK4 are kept for existing callers; the std::function versions above
+	are thin wrappers over the templates.
+*/
+
+namespace integrator_detail
+{
+	inline void check_size(std::span<const double> x, std::size_t num_states)
+	{
+		if (x.size() != num_states)
+		{
+			throw std::invalid_argument("stepper: state size does not match the size it was built for");
+		}
+	}
+
+	// Renormalize the quaternion of a 13-state x
+	inline void renormalize(std::span<double> x)
+	{
+		if (x.size() == QUATERNION_STATE_SIZE)
+		{
+			normalize_quaternion(std::span<double, 4>(x.data() + QUATERNION_INDEX, 4));
+		}
+	}
+
+	// One classic RK4 step of x in place. k1 receives f(t, x), which lets the
+	// multistep methods start up with RK4 and keep k1 as derivative history.
+	template <class F>
+	void rk4_step(F& f, double t, std::span<double> x, double h_s, std::span<double> k1, std::span<double> k2,
+		std::span<double> k3, std::span<double> k4, std::span<double> x_stage)
+	{
+		std::size_t nx = x.size();
+
+		f(t, std::span<const double>(x), k1);
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			x_stage[j] = x[j] + 0.5 * h_s * k1[j];
+		}
+		f(t + 0.5 * h_s, std::span<const double>(x_stage), k2);
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			x_stage[j] = x[j] + 0.5 * h_s * k2[j];
+		}
+		f(t + 0.5 * h_s, std::span<const double>(x_stage), k3);
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			x_stage[j] = x[j] + h_s * k3[j];
+		}
+		f(t + h_s, std::span<const double>(x_stage), k4);
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			x[j] = x[j] + (1.0 / 6.0) * h_s * (k1[j] + 2.0 * k2[j] + 2.0 * k3[j] + k4[j]);
+		}
+	}
+
+	// Method and order a checkpoint was written by; restoring into a stepper
+	// with another tag is refused (see integrator_checkpoint.h)
+	struct StepperTag
+	{
+		std::string_view method;
+		std::size_t order;
+	};
+
+	// Start and end of a stepper's last step, for dense output
+	struct LastStep
+	{
+		explicit LastStep(std::size_t num_states) : x_start(num_states), x_end(num_states) {}
+
+		void begin(double t, std::span<const double> x, double h)
+		{
+			t_s = t;
+			h_s = h;
+			std::copy(x.begin(), x.end(), x_start.begin());
+		}
+
+		void end(std::span<const double> x)
+		{
+			std::copy(x.begin(), x.end(), x_end.begin());
+			taken = true;
+		}
+
+		// Fraction of the step at time t; throws outside the step
+		double theta(double t) const
+		{
+			double theta = (t - t_s) / h_s;
+			if (!taken || !(theta >= -1e-9 && theta <= 1.0 + 1e-9))
+			{
+				throw std::out_of_range("interpolate: t is outside the last step");
+			}
+			return theta;
+		}
+
+		template <class Archive>
+		void checkpoint(Archive& archive)
+		{
+			archive(t_s, h_s, x_start, x_end, taken);
+		}
+
+		double t_s = 0.0;
+		double h_s = 0.0;
+		std::vector<double> x_start, x_end;
+		bool taken = false;
+	};
+
+	// Quadratic through x0 and x1 with slope f0 at x0
+	inline void hermite_quadratic(double theta, double h, std::span<const double> x0, std::span<const double> f0,
+		std::span<const double> x1, std::span<double> out)
+	{
+		for (std::size_t j = 0; j < out.size(); ++j)
+		{
+			out[j] = x0[j] + theta * h * f0[j] + theta * theta * (x1[j] - x0[j] - h * f0[j]);
+		}
+	}
+
+	// Cubic Hermite through x0 and x1 with slopes f0 and f1
+	inline void hermite_cubic(double theta, double h, std::span<const double> x0, std::span<const double> f0,
+		std::span<const double> x1, std::span<const double> f1, std::span<double> out)
+	{
+		double theta2 = theta * theta;
+		double theta3 = theta2 * theta;
+		double h00 = 2.0 * theta3 - 3.0 * theta2 + 1.0;
+		double h10 = theta3 - 2.0 * theta2 + theta;
+		double h01 = 3.0 * theta2 - 2.0 * theta3;
+		double h11 = theta3 - theta2;
+
+		for (std::size_t j = 0; j < out.size(); ++j)
+		{
+			out[j] = h00 * x0[j] + h10 * h * f0[j] + h01 * x1[j] + h11 * h * f1[j];
+		}
+	}
+
+	// Adams-Bashforth weights of order 2 to 4, newest derivative first:
+	// x(n+1) = x(n) + h * sum_k ab[k] * f(n-k)
+	template <std::size_t Order>
+	constexpr std::array<double, Order> adams_bashforth_weights()
+	{
+		static_assert(Order >= 2 && Order <= 4, "Adams methods are provided for orders 2 to 4");
+
+		if constexpr (Order == 2) return { 3.0 / 2.0, -1.0 / 2.0 };
+		else if constexpr (Order == 3) return { 23.0 / 12.0, -16.0 / 12.0, 5.0 / 12.0 };
+		else return { 55.0 / 24.0, -59.0 / 24.0, 37.0 / 24.0, -9.0 / 24.0 };
+	}
+
+	// Adams-Moulton corrector weights of the same order, starting with f(n+1):
+	// x(n+1) = x(n) + h * (am[0] * f(n+1) + sum_k am[k] * f(n-k+1))
+	template <std::size_t Order>
+	constexpr std::array<double, Order> adams_moulton_weights()
+	{
+		static_assert(Order >= 2 && Order <= 4, "Adams methods are provided for orders 2 to 4");
+
+		if constexpr (Order == 2) return { 1.0 / 2.0, 1.0 / 2.0 };
+		else if constexpr (Order == 3) return { 5.0 / 12.0, 8.0 / 12.0, -1.0 / 12.0 };
+		else return { 9.0 / 24.0, 19.0 / 24.0, -5.0 / 24.0, 1.0 / 24.0 };
+	}
+
+	// The last Order derivatives of a trajectory in one block; push() recycles
+	// the oldest slot as the newest, so nothing is copied or allocated per step
+	template <std::size_t Order>
+	class DerivativeHistory
+	{
+	public:
+		explicit DerivativeHistory(std::size_t num_states) : n(num_states), data(Order * num_states) {}
+
+		std::span<double> push()
+		{
+			newest = (newest + 1) % Order;
+			count = count < Order ? count + 1 : Order;
+			return slot(0);
+		}
+
+		// Derivative k steps back from the newest
+		std::span<double> slot(std::size_t k) { return std::span<double>(data.data() + ((newest + Order - k) % Order) * n, n); }
+		std::span<const double> slot(std::size_t k) const { return std::span<const double>(data.data() + ((newest + Order - k) % Order) * n, n); }
+
+		std::size_t size() const { return count; }
+		void clear() { count = 0; }
+
+		template <class Archive>
+		void checkpoint(Archive& archive)
+		{
+			archive(data, newest, count);
+		}
+
+	private:
+		std::size_t n;
+		std::vector<double> data;
+		std::size_t newest = 0;
+		std::size_t count = 0;
+	};
+}
+
+template <class F>
+class ForwardEulerStepper
+{
+public:
+	ForwardEulerStepper(F f, std::size_t num_states) : f(std::move(f)), dx(num_states), last(num_states) {}
+
+	std::size_t size() const { return dx.size(); }
+	std::size_t rhs_evals() const { return num_evals; }
+	std::size_t steps() const { return num_steps; }
+
+	void step(double t, std::span<double> x, double h_s)
+	{
+		integrator_detail::check_size(x, dx.size());
+		last.begin(t, x, h_s);
+
+		f(t, std::span<const double>(x), std::span<double>(dx));
+		++num_evals;
+
+		for (std::size_t j = 0; j < x.size(); ++j)
+		{
+			x[j] = x[j] + h_s * dx[j];
+		}
+		integrator_detail::renormalize(x);
+		last.end(x);
+		++num_steps;
+	}
+
+	// State at time t within the last step, linear between its ends
+	void interpolate(double t, std::span<double> x_out) const
+	{
+		double theta = last.theta(t);
+		for (std::size_t j = 0; j < x_out.size(); ++j)
+		{
+			x_out[j] = last.x_start[j] + theta * (last.x_end[j] - last.x_start[j]);
+		}
+	}
+
+	// Saves or restores everything step() and interpolate() carry between
+	// calls (see integrator_checkpoint.h)
+	template <class Archive>
+	void checkpoint(Archive& archive)
+	{
+		last.checkpoint(archive);
+		archive(num_evals, num_steps);
+	}
+
+	integrator_detail::StepperTag checkpoint_tag() const { return { "ForwardEuler", 1 }; }
+
+private:
+	F f;
+	std::vector<double> dx;
+	integrator_detail::LastStep last;
+	std::size_t num_evals = 0;
+	std::size_t num_steps = 0;
+};
+
+// Classic 4th order Runge-Kutta
+template <class F>
+class RK4Stepper
+{
+public:
+	RK4Stepper(F f, std::size_t num_states)
+		: f(std::move(f)), x_stage(num_states), k1(num_states), k2(num_states), k3(num_states), k4(num_states), last(num_states) {}
+
+	std::size_t size() const { return x_stage.size(); }
+	std::size_t rhs_evals() const { return num_evals; }
+	std::size_t steps() const { return num_steps; }
+
+	void step(double t, std::span<double> x, double h_s)
+	{
+		integrator_detail::check_size(x, x_stage.size());
+		last.begin(t, x, h_s);
+
+		integrator_detail::rk4_step(f, t, x, h_s, k1, k2, k3, k4, x_stage);
+		num_evals += 4;
+
+		integrator_detail::renormalize(x);
+		last.end(x);
+		++num_steps;
+	}
+
+	// State at time t within the last step from the 3rd order continuous
+	// extension of RK4 (Hairer, Norsett & Wanner, II.6), built from the stages
+	// already computed
+	void interpolate(double t, std::span<double> x_out) const
+	{
+		double theta = last.theta(t);
+		double theta2 = theta * theta;
+		double theta3 = theta2 * theta;
+		double b1 = theta - 1.5 * theta2 + (2.0 / 3.0) * theta3;
+		double b23 = theta2 - (2.0 / 3.0) * theta3;
+		double b4 = -0.5 * theta2 + (2.0 / 3.0) * theta3;
+
+		for (std::size_t j = 0; j < x_out.size(); ++j)
+		{
+			x_out[j] = last.x_start[j] + last.h_s * (b1 * k1[j] + b23 * (k2[j] + k3[j]) + b4 * k4[j]);
+		}
+		integrator_detail::renormalize(x_out);
+	}
+
+	// The stages of the last step feed interpolate()
+	template <class Archive>
+	void checkpoint(Archive& archive)
+	{
+		archive(k1, k2, k3, k4);
+		last.checkpoint(archive);
+		archive(num_evals, num_steps);
+	}
+
+	integrator_detail::StepperTag checkpoint_tag() const { return { "RK4", 4 }; }
+
+private:
+	F f;
+	std::vector<double> x_stage, k1, k2, k3, k4;
+	integrator_detail::LastStep last;
+	std::size_t num_evals = 0;
+	std::size_t num_steps = 0;
+};
+
+// How a multistep method takes its first Order - 1 steps, before it has enough
+// derivative history
+enum class MultistepStartup
+{
+	ForwardEuler,
+	RK4
+};
+
+// Adams-Bashforth of order 2 to 4. The derivatives of the last Order steps sit
+// in a ring buffer, so a step costs one RHS evaluation once the history is
+// full; the first Order - 1 steps use the startup method (RK4 by default, whose
+// first stage fills the history). Steps must be consecutive on one trajectory
+// with a constant h_s; call reset() after changing the state from outside.
+template <class F, std::size_t Order>
+class AdamsBashforthStepper
+{
+public:
+	AdamsBashforthStepper(F f, std::size_t num_states, MultistepStartup startup = MultistepStartup::RK4)
+		: f(std::move(f)), startup(startup), history(num_states), x_stage(num_states), k2(num_states), k3(num_states), k4(num_states),
+		last(num_states) {}
+
+	std::size_t size() const { return x_stage.size(); }
+	std::size_t rhs_evals() const { return num_evals; }
+	std::size_t steps() const { return num_steps; }
+
+	// Forget the derivative history and start up again on the next step
+	void reset() { history.clear(); }
+
+	void step(double t, std::span<double> x, double h_s)
+	{
+		integrator_detail::check_size(x, x_stage.size());
+		last.begin(t, x, h_s);
+
+		bool starting = history.size() + 1 < Order;
+		std::span<double> f_n = history.push();
+
+		if (starting && startup == MultistepStartup::RK4)
+		{
+			integrator_detail::rk4_step(f, t, x, h_s, f_n, k2, k3, k4, x_stage);
+			num_evals += 4;
+		}
+		else
+		{
+			f(t, std::span<const double>(x), f_n);
+			++num_evals;
+
+			if (starting)
+			{
+				for (std::size_t j = 0; j < x.size(); ++j)
+				{
+					x[j] = x[j] + h_s * f_n[j];
+				}
+			}
+			else
+			{
+				std::array<double, Order> c;
+				for (std::size_t k = 0; k < Order; ++k)
+				{
+					c[k] = ab[k] * h_s;
+				}
+
+				for (std::size_t j = 0; j < x.size(); ++j)
+				{
+					double x_next = x[j];
+					for (std::size_t k = 0; k < Order; ++k)
+					{
+						x_next = x_next + c[k] * history.slot(k)[j];
+					}
+					x[j] = x_next;
+				}
+			}
+		}
+
+		integrator_detail::renormalize(x);
+		last.end(x);
+		++num_steps;
+	}
+
+	// State at time t within the last step: quadratic Hermite through both ends
+	// with the derivative at the start, the newest in the history
+	void interpolate(double t, std::span<double> x_out) const
+	{
+		double theta = last.theta(t);
+		integrator_detail::hermite_quadratic(theta, last.h_s, last.x_start, history.slot(0), last.x_end, x_out);
+		integrator_detail::renormalize(x_out);
+	}
+
+	// The derivative history, so a restored stepper continues without a new
+	// startup. The startup method is part of the tag, so a checkpoint only
+	// restores into a stepper built with the same one.
+	template <class Archive>
+	void checkpoint(Archive& archive)
+	{
+		history.checkpoint(archive);
+		last.checkpoint(archive);
+		archive(num_evals, num_steps);
+	}
+
+	integrator_detail::StepperTag checkpoint_tag() const
+	{
+		return { startup == MultistepStartup::RK4 ? "AdamsBashforth/RK4" : "AdamsBashforth/Euler", Order };
+	}
+
+private:
+	static constexpr std::array<double, Order> ab = integrator_detail::adams_bashforth_weights<Order>();
+
+	F f;
+	MultistepStartup startup;
+	integrator_detail::DerivativeHistory<Order> history;
+	std::vector<double> x_stage, k2, k3, k4;  // RK4 startup stages
+	integrator_detail::LastStep last;
+	std::size_t num_evals = 0;
+	std::size_t num_steps = 0;
+};
+
+// 2nd order Adams-Bashforth started with one forward Euler step, the scheme of
+// AB() and the original AB2
+template <class F>
+class AB2Stepper : public AdamsBashforthStepper<F, 2>
+{
+public:
+	AB2Stepper(F f, std::size_t num_states) : AdamsBashforthStepper<F, 2>(std::move(f), num_states, MultistepStartup::ForwardEuler) {}
+};
+
+// Adams-Bashforth-Moulton predictor-corrector in PECE mode: predict with
+// Adams-Bashforth, evaluate, correct with Adams-Moulton of the same order,
+// evaluate again. The final evaluation is the next step's newest derivative, so
+// a step costs two RHS evaluations once started. Startup and reset() as for
+// AdamsBashforthStepper.
+template <class F, std::size_t Order>
+class AdamsBashforthMoultonStepper
+{
+public:
+	AdamsBashforthMoultonStepper(F f, std::size_t num_states, MultistepStartup startup = MultistepStartup::RK4)
+		: f(std::move(f)), startup(startup), history(num_states), x_stage(num_states), f_predicted(num_states),
+		k2(num_states), k3(num_states), k4(num_states), last(num_states) {}
+
+	std::size_t size() const { return x_stage.size(); }
+	std::size_t rhs_evals() const { return num_evals; }
+	std::size_t steps() const { return num_steps; }
+
+	void reset()
+	{
+		history.clear();
+		have_f_n = false;
+	}
+
+	void step(double t, std::span<double> x, double h_s)
+	{
+		integrator_detail::check_size(x, x_stage.size());
+		std::size_t nx = x.size();
+		last.begin(t, x, h_s);
+
+		if (!have_f_n)
+		{
+			bool starting = history.size() + 1 < Order;
+			std::span<double> f_n = history.push();
+
+			if (starting)
+			{
+				if (startup == MultistepStartup::RK4)
+				{
+					integrator_detail::rk4_step(f, t, x, h_s, f_n, k2, k3, k4, x_stage);
+					num_evals += 4;
+				}
+				else
+				{
+					f(t, std::span<const double>(x), f_n);
+					++num_evals;
+					for (std::size_t j = 0; j < nx; ++j)
+					{
+						x[j] = x[j] + h_s * f_n[j];
+					}
+				}
+
+				integrator_detail::renormalize(x);
+				last.end(x);
+				++num_steps;
+				return;
+			}
+
+			f(t, std::span<const double>(x), f_n);
+			++num_evals;
+		}
+
+		std::array<double, Order> c_ab;
+		std::array<double, Order> c_am;
+		for (std::size_t k = 0; k < Order; ++k)
+		{
+			c_ab[k] = ab[k] * h_s;
+			c_am[k] = am[k] * h_s;
+		}
+
+		// Predict
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			double x_next = x[j];
+			for (std::size_t k = 0; k < Order; ++k)
+			{
+				x_next = x_next + c_ab[k] * history.slot(k)[j];
+			}
+			x_stage[j] = x_next;
+		}
+
+		// Evaluate
+		f(t + h_s, std::span<const double>(x_stage), std::span<double>(f_predicted));
+
+		// Correct
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			double x_next = x[j] + c_am[0] * f_predicted[j];
+			for (std::size_t k = 1; k < Order; ++k)
+			{
+				x_next = x_next + c_am[k] * history.slot(k - 1)[j];
+			}
+			x[j] = x_next;
+		}
+		integrator_detail::renormalize(x);
+
+		// Evaluate at the corrected state
+		f(t + h_s, std::span<const double>(x), history.push());
+		num_evals += 2;
+		have_f_n = true;
+		last.end(x);
+		++num_steps;
+	}
+
+	// State at time t within the last step: cubic Hermite with the derivatives
+	// at both ends once in PECE mode, quadratic Hermite during startup
+	void interpolate(double t, std::span<double> x_out) const
+	{
+		double theta = last.theta(t);
+		if (have_f_n)
+		{
+			integrator_detail::hermite_cubic(theta, last.h_s, last.x_start, history.slot(1), last.x_end, history.slot(0), x_out);
+		}
+		else
+		{
+			integrator_detail::hermite_quadratic(theta, last.h_s, last.x_start, history.slot(0), last.x_end, x_out);
+		}
+		integrator_detail::renormalize(x_out);
+	}
+
+	// As for AdamsBashforthStepper, plus whether the history already holds
+	// the derivative of the current state
+	template <class Archive>
+	void checkpoint(Archive& archive)
+	{
+		history.checkpoint(archive);
+		last.checkpoint(archive);
+		archive(have_f_n, num_evals, num_steps);
+	}
+
+	integrator_detail::StepperTag checkpoint_tag() const
+	{
+		return { startup == MultistepStartup::RK4 ? "AdamsBashforthMoulton/RK4" : "AdamsBashforthMoulton/Euler", Order };
+	}
+
+private:
+	static constexpr std::array<double, Order> ab = integrator_detail::adams_bashforth_weights<Order>();
+	static constexpr std::array<double, Order> am = integrator_detail::adams_moulton_weights<Order>();
+
+	F f;
+	MultistepStartup startup;
+	integrator_detail::DerivativeHistory<Order> history;
+	std::vector<double> x_stage, f_predicted;
+	std::vector<double> k2, k3, k4;  // RK4 startup stages
+	bool have_f_n = false;           // history already holds f(t, x) of the current state
+	integrator_detail::LastStep last;
+	std::size_t num_evals = 0;
+	std::size_t num_steps = 0;
+};
+
+template <class Stepper>
+void integrate(Stepper& stepper, const std::vector<double>& t_s, std::vector<std::vector<double>>& sx, double h_s)
+{
+	/*  Arguments:
+
+		stepper - any of the steppers above, built for sx.size() states
+
+		t_s - time vector [s]
+
+		sx - solution matrix sx[state][time]; column 0 holds the initial
+		condition, the remaining columns are overwritten with the solution
+
+		h_s - step size [s], the spacing of t_s
+	*/
+
+	std::size_t nx = sx.size();
+	std::vector<double> x(nx);
+
+	for (std::size_t j = 0; j < nx; ++j)
+	{
+		x[j] = sx[j][0];
+	}
+
+	for (std::size_t i = 1; i < t_s.size(); ++i)
+	{
+		stepper.step(t_s[i - 1], x, h_s);
+
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			sx[j][i] = x[j];
+		}
+	}
+}
+
+template <class Stepper>
+void integrate(Stepper& stepper, Trajectory& trajectory, double h_s)
+{
+	/*  Arguments:
+
+		stepper - any of the steppers above, built for trajectory.num_states()
+		states
+
+		trajectory - time grid and solution; row 0 holds the initial condition,
+		the remaining rows are overwritten with the solution
+
+		h_s - step size [s], the spacing of the trajectory times
+
+		A TimeMajor trajectory is advanced in place: each row is copied forward
+		and stepped where it lies, with no gather or scatter per step.
+	*/
+
+	std::size_t nt = trajectory.num_times();
+
+	if (trajectory.layout() == TrajectoryLayout::TimeMajor)
+	{
+		for (std::size_t i = 1; i < nt; ++i)
+		{
+			std::span<double> x = trajectory.row(i).span();
+			trajectory.row(i - 1).copy_to(x);
+			stepper.step(trajectory.time(i - 1), x, h_s);
+		}
+		return;
+	}
+
+	std::vector<double> x(trajectory.num_states());
+	trajectory.row(0).copy_to(x);
+	for (std::size_t i = 1; i < nt; ++i)
+	{
+		stepper.step(trajectory.time(i - 1), x, h_s);
+		trajectory.set_row(i, x);
+	}
+}
+
+namespace integrator_detail
+{
+	// One step of a fixed-step (step returns void) or adaptive (step returns the
+	// step taken) stepper, not past t_max. A fixed step shortened to land on
+	// t_max restarts a multistep method, whose history assumes a constant step.
+	template <class Stepper>
+	double advance(Stepper& stepper, double t, std::span<double> x, double h_s, double t_max)
+	{
+		if constexpr (std::is_void_v<decltype(stepper.step(t, x, h_s))>)
+		{
+			double h = std::min(h_s, t_max - t);
+			if constexpr (requires { stepper.reset(); })
+			{
+				if (h != h_s)
+				{
+					stepper.reset();
+				}
+			}
+			stepper.step(t, x, h);
+			return h;
+		}
+		else
+		{
+			return stepper.step(t, x, t_max);
+		}
+	}
+
+	// Time at the end of step i (counted from t0_s), whose length was h. Fixed
+	// steps are counted rather than summed, so a long run stays on the grid.
+	template <class Stepper>
+	double step_end_time(double t0_s, double t, std::size_t i, double h, double h_s, double t_max)
+	{
+		if constexpr (std::is_void_v<decltype(std::declval<Stepper&>().step(t, std::span<double>(), h_s))>)
+		{
+			double t_grid = t0_s + static_cast<double>(i) * h_s;
+			return h != h_s || t_max - t_grid <= 1e-9 * h_s ? t_max : t_grid;
+		}
+		else
+		{
+			return t_max - t <= h ? t_max : t + h;
+		}
+	}
+
+	inline void check_output_times(double t0_s, const std::vector<double>& t_out)
+	{
+		for (std::size_t k = 0; k < t_out.size(); ++k)
+		{
+			if (t_out[k] < t0_s || (k > 0 && t_out[k] < t_out[k - 1]))
+			{
+				throw std::invalid_argument("output times must be ascending and not before t0_s");
+			}
+		}
+	}
+}
+
+// Output clock from t0_s to tf_s at rate_hz (60 for playback, 100 for plots, ...)
+inline std::vector<double> sample_times(double t0_s, double tf_s, double rate_hz)
+{
+	if (rate_hz <= 0.0)
+	{
+		throw std::invalid_argument("sample_times: rate must be positive");
+	}
+
+	std::vector<double> t_out;
+	std::size_t count = static_cast<std::size_t>(std::floor((tf_s - t0_s) * rate_hz + 1e-9)) + 1;
+	t_out.reserve(count);
+	for (std::size_t k = 0; k < count; ++k)
+	{
+		t_out.push_back(t0_s + static_cast<double>(k) / rate_hz);
+	}
+	return t_out;
+}
+
+template <class Stepper>
+Trajectory integrate_sampled(Stepper& stepper, double t0_s, const std::vector<double>& x0, double h_s, const std::vector<double>& t_out, TrajectoryLayout layout = TrajectoryLayout::TimeMajor)
+{
+	/*  Arguments:
+
+		stepper - any of the fixed-step steppers above, built for x0.size() states
+
+		t0_s - initial time [s]
+
+		x0 - initial state
+
+		h_s - integration step [s]; independent of the output clock
+
+		t_out - output times [s], ascending, none before t0_s
+
+		layout - storage order of the result
+
+		Returns the solution at t_out[k], interpolated within each step by the
+		stepper's dense output, so the outputs cost no extra RHS evaluations.
+	*/
+
+	integrator_detail::check_output_times(t0_s, t_out);
+
+	std::size_t nx = x0.size();
+	std::vector<double> x = x0;
+	std::vector<double> x_out(nx);
+	Trajectory trajectory(nx, t_out, layout);
+
+	std::size_t k = 0;
+	for (; k < t_out.size() && t_out[k] <= t0_s; ++k)
+	{
+		trajectory.set_row(k, x0);
+	}
+
+	for (std::size_t i = 0; k < t_out.size(); ++i)
+	{
+		double t = t0_s + static_cast<double>(i) * h_s;
+		stepper.step(t, x, h_s);
+
+		for (; k < t_out.size() && t_out[k] <= t + h_s; ++k)
+		{
+			stepper.interpolate(t_out[k], x_out);
+			trajectory.set_row(k, x_out);
+		}
+	}
+
+	return trajectory;
+}
+
+template <class F>
+std::pair<std::vector<double>, std::vector<std::vector<double>>> forward_euler(F&& f, const std::vector<double>& t_s, std::vector<std::vector<double>> sx, double h_s)
+{
+	// Forward Euler numerical integration
+
+	ForwardEulerStepper stepper(std::forward<F>(f), sx.size());
+	integrate(stepper, t_s, sx, h_s);
+	return { t_s, std::move(sx) };
+}
+
+template <class F>
+std::pair<std::vector<double>, std::vector<std::vector<double>>> AB2(F&& f, const std::vector<double>& t_s, std::vector<std::vector<double>> sx, double h_s)
+{
+	// 2nd order Adams-Bashforth, started with one forward Euler step
+
+	AB2Stepper stepper(std::forward<F>(f), sx.size());
+	integrate(stepper, t_s, sx, h_s);
+	return { t_s, std::move(sx) };
+}
+
+template <class F>
+std::pair<std::vector<double>, std::vector<std::vector<double>>> RK4(F&& f, const std::vector<double>& t_s, std::vector<std::vector<double>> sx, double h_s)
+{
+	// Classic 4th order Runge-Kutta
+
+	RK4Stepper stepper(std::forward<F>(f), sx.size());
+	integrate(stepper, t_s, sx, h_s);
+	return { t_s, std::move(sx) };
+}
+
+// The same three on a Trajectory whose row 0 holds the initial condition
+
+template <class F>
+Trajectory forward_euler(F&& f, Trajectory trajectory, double h_s)
+{
+	ForwardEulerStepper stepper(std::forward<F>(f), trajectory.num_states());
+	integrate(stepper, trajectory, h_s);
+	return trajectory;
+}
+
+template <class F>
+Trajectory AB2(F&& f, Trajectory trajectory, double h_s)
+{
+	AB2Stepper stepper(std::forward<F>(f), trajectory.num_states());
+	integrate(stepper, trajectory, h_s);
+	return trajectory;
+}
+
+template <class F>
+Trajectory RK4(F&& f, Trajectory trajectory, double h_s)
+{
+	RK4Stepper stepper(std::forward<F>(f), trajectory.num_states());
+	integrate(stepper, trajectory, h_s);
+	return trajectory;
+}
+
 
 #endif // NUMERICAL_INTEGRATION_METHODS_H
@@ -0,0 +1,215 @@
+#pragma once
+#ifndef PARAREAL_H
+#define PARAREAL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include "numerical_integration_methods.h"
+#include "thread_pool.h"
+
+/*  Parareal: parallel-in-time integration of one trajectory.
+
+	The time grid is cut into slices. A cheap coarse propagator G (forward
+	Euler, or RK4 with a large step) runs serially across the slice boundaries
+	to guess the state at each of them; the fine integrator F then runs every
+	slice from its guessed start at the same time, one slice per thread. The
+	boundary states are corrected serially with
+
+		U[n+1] = G(U[n]) + F(U_old[n]) - G(U_old[n])
+
+	and the fine sweep repeats until the correction falls below tol (Lions,
+	Maday & Turinici 2001; Gander & Vandewalle, SISC 2007). After k iterations
+	the first k slices are exact, so at most one iteration per slice is
+	needed, and those slices drop out of later fine sweeps.
+
+	The fine steppers take the fixed step of the time grid and are reset at the
+	start of every slice. With a one-step method (forward Euler, RK4) a
+	converged run therefore reproduces the serial run of the same stepper on
+	the same grid to tol. A multistep stepper (Adams-Bashforth, ABM) has no
+	derivative history at a slice start and takes its startup steps again
+	there, so it reproduces a serial run restarted at every slice boundary
+	instead; against an uninterrupted serial run the startup error adds to tol
+	(AB2 on the Atmos03 check case, 16 slices at h = 0.001 s: 8e-7 at tol
+	1e-8).
+
+	The speedup is bounded by slices / iterations; a coarse propagator that
+	tracks the fine one well (RK4 at a few times the fine step) converges in
+	2-4 iterations.
+*/
+
+struct PararealOptions
+{
+	std::size_t slices = 8;            // time slices, at least one per pool thread
+	double h_coarse_s = 0.1;           // coarse step [s], rounded so each slice takes whole steps
+	double tol = 1e-8;                 // largest boundary correction, relative to 1 + |x|
+	std::size_t max_iterations = 0;    // 0 runs until converged (at most slices iterations)
+};
+
+struct PararealRun
+{
+	Trajectory trajectory;                 // solution on the fine grid, TimeMajor
+	std::size_t iterations = 0;            // fine sweeps
+	bool converged = false;
+	std::vector<double> corrections;       // largest boundary correction after each sweep
+	std::size_t coarse_evals = 0;          // RHS evaluations of all coarse sweeps
+	std::size_t fine_evals = 0;            // RHS evaluations of all fine sweeps
+	std::size_t critical_path_evals = 0;   // coarse evaluations plus the longest slice of each sweep
+};
+
+namespace integrator_detail
+{
+	// Coarse propagation of x over [t0, t1] in whole steps close to h_s
+	template <class Stepper>
+	void propagate_coarse(Stepper& stepper, double t0, double t1, std::span<double> x, double h_s)
+	{
+		std::size_t steps = std::max<std::size_t>(1, static_cast<std::size_t>(std::floor((t1 - t0) / h_s + 0.5)));
+		double h = (t1 - t0) / static_cast<double>(steps);
+
+		if constexpr (requires { stepper.reset(); })
+		{
+			stepper.reset();
+		}
+		for (std::size_t i = 0; i < steps; ++i)
+		{
+			stepper.step(t0 + static_cast<double>(i) * h, x, h);
+		}
+	}
+}
+
+template <class CoarseStepper, class FineStepper>
+PararealRun parareal(const CoarseStepper& coarse, const FineStepper& fine, const std::vector<double>& t_s, const std::vector<double>& x0, double h_s, const PararealOptions& options, ThreadPool& pool)
+{
+	/*  Arguments:
+
+		coarse - fixed-step stepper used as G, built for x0.size() states
+
+		fine - fixed-step stepper used as F; copied once per slice so the slices
+		can run at the same time, and reset at each slice start (a multistep
+		stepper restarts there, see above)
+
+		t_s - fine time grid [s], spacing h_s
+
+		x0 - initial state
+
+		h_s - fine step size [s]
+
+		options - slice count, coarse step and convergence tolerance
+
+		pool - threads for the fine sweeps
+	*/
+
+	std::size_t nt = t_s.size();
+	std::size_t nx = x0.size();
+	std::size_t slices = std::min(options.slices, nt > 1 ? nt - 1 : 1);
+
+	if (nt < 2 || slices == 0)
+	{
+		throw std::invalid_argument("parareal: needs a time grid of at least two points and one slice");
+	}
+
+	std::size_t max_iterations = options.max_iterations == 0 ? slices : std::min(options.max_iterations, slices);
+
+	// Slice n covers grid points first[n] .. first[n + 1]
+	std::vector<std::size_t> first(slices + 1);
+	for (std::size_t n = 0; n <= slices; ++n)
+	{
+		first[n] = n * (nt - 1) / slices;
+	}
+
+	PararealRun run;
+	run.trajectory = Trajectory(nx, t_s);
+	run.trajectory.set_row(0, x0);
+
+	CoarseStepper coarse_stepper = coarse;
+	std::vector<FineStepper> fine_steppers(slices, fine);
+
+	// U: boundary states; G_old: coarse result from the previous U; F_end: fine result
+	std::vector<std::vector<double>> U(slices + 1, x0);
+	std::vector<std::vector<double>> G_old(slices, std::vector<double>(nx));
+	std::vector<std::vector<double>> F_end(slices, std::vector<double>(nx));
+	std::vector<std::size_t> slice_evals(slices);
+	std::vector<double> x(nx);
+
+	// Initial coarse sweep
+	for (std::size_t n = 0; n < slices; ++n)
+	{
+		G_old[n] = U[n];
+		integrator_detail::propagate_coarse(coarse_stepper, t_s[first[n]], t_s[first[n + 1]], G_old[n], options.h_coarse_s);
+		U[n + 1] = G_old[n];
+	}
+
+	for (std::size_t k = 0; k < max_iterations; ++k)
+	{
+		// Fine sweep over the slices not yet exact, writing the grid solution in
+		// place; each slice owns its own rows of the trajectory
+		pool.parallel_for(slices - k, [&](std::size_t i)
+		{
+			std::size_t n = k + i;
+			FineStepper& stepper = fine_steppers[n];
+			if constexpr (requires { stepper.reset(); })
+			{
+				stepper.reset();
+			}
+
+			std::size_t evals_before = stepper.rhs_evals();
+			std::vector<double>& x_fine = F_end[n];
+			x_fine = U[n];
+			for (std::size_t p = first[n]; p < first[n + 1]; ++p)
+			{
+				stepper.step(t_s[p], x_fine, h_s);
+				run.trajectory.set_row(p + 1, x_fine);
+			}
+			slice_evals[n] = stepper.rhs_evals() - evals_before;
+		});
+
+		std::size_t longest_slice = 0;
+		for (std::size_t n = k; n < slices; ++n)
+		{
+			run.fine_evals += slice_evals[n];
+			longest_slice = std::max(longest_slice, slice_evals[n]);
+		}
+		run.critical_path_evals += longest_slice;
+		++run.iterations;
+
+		// Serial correction; slice k started from an exact state, so U[k + 1] is its fine result
+		double correction = 0.0;
+		U[k + 1] = F_end[k];
+		for (std::size_t n = k + 1; n < slices; ++n)
+		{
+			x = U[n];
+			integrator_detail::propagate_coarse(coarse_stepper, t_s[first[n]], t_s[first[n + 1]], x, options.h_coarse_s);
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				double corrected = x[j] + F_end[n][j] - G_old[n][j];
+				double difference = std::abs(corrected - U[n + 1][j]) / (1.0 + std::abs(corrected));
+
+				// Written so a NaN correction sticks and the run is not taken as converged
+				if (!(difference <= correction))
+				{
+					correction = difference;
+				}
+				U[n + 1][j] = corrected;
+			}
+			G_old[n] = x;
+		}
+		run.corrections.push_back(correction);
+
+		if (correction <= options.tol)
+		{
+			run.converged = true;
+			break;
+		}
+	}
+
+	// Slices up to the last sweep are exact once every slice has had its sweep
+	run.converged = run.converged || run.iterations == slices;
+
+	run.coarse_evals = coarse_stepper.rhs_evals();
+	run.critical_path_evals += run.coarse_evals;
+	return run;
+}
+
+#endif // PARAREAL_H
@@ -0,0 +1,18 @@
+#pragma once
+#ifndef SCALAR_TRAITS_H
+#define SCALAR_TRAITS_H
+
+// Underlying floating-point type of a scalar used by the generic EoM code:
+// double for double, float for float, and the value type for Dual numbers
+// (specialized in dual.h). Generic code writes constants as scalar_t<T>(0.5) so
+// float kernels stay in float and dual kernels multiply by a plain scalar.
+template <class T>
+struct scalar_traits
+{
+	using scalar = T;
+};
+
+template <class T>
+using scalar_t = typename scalar_traits<T>::scalar;
+
+#endif // SCALAR_TRAITS_H
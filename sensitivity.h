@@ -0,0 +1,165 @@
+#pragma once
+#ifndef SENSITIVITY_H
+#define SENSITIVITY_H
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "dual.h"
+#include "flat_earth_eom_kernel.h"
+#include "spheres.h"
+
+/*  Forward sensitivities of the 12-state flat-earth trajectory.
+
+	The EoM kernel, USSA1976 and the brick moment helpers are generic over the
+	scalar type, so running them on Dual<double, N> carries dx/dp for N seeded
+	parameters alongside the state. propagate_sensitivities integrates the dual
+	state with fixed-step RK4 and returns, at every step, the state values and
+	the N partials of each state with respect to the chosen parameters: one
+	integration instead of one re-simulation per parameter.
+
+	The full kernel (drag, damping, Jxz) is always used so the sensitivity to a
+	coefficient that is zero on the preset (e.g. Clp of a sphere) is still
+	reported.
+*/
+
+// Parameters that can be differentiated against: vehicle coefficients and the
+// initial value of each state
+enum class SensitivityParameter
+{
+	CD_approx,
+	Clp,
+	Clr,
+	Cmq,
+	Cnp,
+	Cnr,
+	m_kg,
+	u0,
+	v0,
+	w0,
+	p0,
+	q0,
+	r0,
+	phi0,
+	theta0,
+	psi0,
+	p10,
+	p20,
+	p30
+};
+
+template <std::size_t N>
+using SensitivityScalar = Dual<double, N>;
+
+// State with its partials: x[i].v is state i, x[i].d[k] is d(state i)/d(parameter k)
+template <std::size_t N>
+using SensitivityState = std::array<SensitivityScalar<N>, 12>;
+
+template <std::size_t N>
+std::vector<SensitivityState<N>> propagate_sensitivities(
+	const VehicleParams& vehicle,
+	std::span<const double, 12> x0,
+	const std::array<SensitivityParameter, N>& parameters,
+	const std::vector<double>& t_s,
+	double h_s)
+{
+	/*  Arguments:
+
+		vehicle - compiled vehicle data (compileVehicle / makeVehicle)
+
+		x0 - initial 12-state vector, same layout as flat_earth_eom_inplace
+
+		parameters - the N parameters to seed; column k of every partial
+		corresponds to parameters[k]
+
+		t_s - time vector [s], as passed to RK4
+
+		h_s - fixed step [s], the spacing of t_s
+
+		Returns the dual state at every t_s, stepped exactly as RK4 steps the
+		double state, so result[n][i].v matches RK4 and
+		result[n][i].d[k] = d x_i(t_s[n]) / d parameters[k].
+	*/
+
+	using Scalar = SensitivityScalar<N>;
+	using State = SensitivityState<N>;
+
+	if (h_s <= 0.0)
+	{
+		throw std::invalid_argument("propagate_sensitivities: step size must be positive");
+	}
+
+	BasicVehicleParams<Scalar> dual_vehicle = convertVehicle<Scalar>(vehicle);
+
+	State x;
+	for (std::size_t i = 0; i < 12; ++i)
+	{
+		x[i] = Scalar(x0[i]);
+	}
+
+	// Seed one derivative direction per parameter
+	for (std::size_t k = 0; k < N; ++k)
+	{
+		switch (parameters[k])
+		{
+		case SensitivityParameter::CD_approx: dual_vehicle.CD_approx.d[k] = 1.0; break;
+		case SensitivityParameter::Clp: dual_vehicle.Clp.d[k] = 1.0; break;
+		case SensitivityParameter::Clr: dual_vehicle.Clr.d[k] = 1.0; break;
+		case SensitivityParameter::Cmq: dual_vehicle.Cmq.d[k] = 1.0; break;
+		case SensitivityParameter::Cnp: dual_vehicle.Cnp.d[k] = 1.0; break;
+		case SensitivityParameter::Cnr: dual_vehicle.Cnr.d[k] = 1.0; break;
+		case SensitivityParameter::m_kg: dual_vehicle.m_kg.d[k] = 1.0; break;
+		default:
+			x[static_cast<std::size_t>(parameters[k]) - static_cast<std::size_t>(SensitivityParameter::u0)].d[k] = 1.0;
+			break;
+		}
+	}
+
+	// Mass feeds inv_m_kg, so the derived constants are rebuilt from the seeded fields
+	compileVehicle(dual_vehicle);
+
+	auto eom = [&](double t, const State& state, State& dstate)
+	{
+		flat_earth_eom_kernel<Ussa1976Atmosphere, ConstantGravity, ConstantDragForces, BrickDampingMoments, GeneralInertia>(
+			t, std::span<const Scalar>(state), dual_vehicle, std::span<Scalar, 12>(dstate));
+	};
+
+	std::vector<State> trajectory;
+	trajectory.reserve(t_s.size());
+	trajectory.push_back(x);
+
+	State k1, k2, k3, k4, x_stage;
+
+	for (std::size_t n = 1; n < t_s.size(); ++n)
+	{
+		eom(t_s[n - 1], x, k1);
+		for (std::size_t i = 0; i < 12; ++i)
+		{
+			x_stage[i] = x[i] + 0.5 * h_s * k1[i];
+		}
+		eom(t_s[n - 1] + 0.5 * h_s, x_stage, k2);
+		for (std::size_t i = 0; i < 12; ++i)
+		{
+			x_stage[i] = x[i] + 0.5 * h_s * k2[i];
+		}
+		eom(t_s[n - 1] + 0.5 * h_s, x_stage, k3);
+		for (std::size_t i = 0; i < 12; ++i)
+		{
+			x_stage[i] = x[i] + h_s * k3[i];
+		}
+		eom(t_s[n - 1] + h_s, x_stage, k4);
+
+		for (std::size_t i = 0; i < 12; ++i)
+		{
+			x[i] = x[i] + (1.0 / 6.0) * h_s * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+		}
+
+		trajectory.push_back(x);
+	}
+
+	return trajectory;
+}
+
+#endif // SENSITIVITY_H
@@ -5,6 +5,8 @@
 #include <unordered_map>
 #include <string>
 #include <any>
+#include <stdexcept>
+#include "spheres.h"
 
 
 std::tuple<double, double, double, double> CalcSphereProps(double r_sphere_m, double rho_sphere_kgpm3)
@@ -492,30 +494,6 @@ std::unordered_map<std::string, double> NASA_Atmos03_Brick()
 }
 
 // Roll, Pitch, Yaw moment coefficent for dampended tumbling brick simulation
-double Cl_brick(double Clp, double Clr, double p_b_rps, double r_b_rps, double b_m, double true_airspeed_mps)
-{
-    if (true_airspeed_mps < 1e-6) return 0.0;  // Avoid division by zero
-    double Cl = Clp * p_b_rps * b_m / (2 * true_airspeed_mps) + Clr * r_b_rps * b_m / (2 * true_airspeed_mps);
-    return Cl;
-}
-
-double Cm_brick(double Cmq, double q_b_rps, double c_m, double true_airspeed_mps)
-{
-	if (true_airspeed_mps < 1e-6) return 0.0;  
-	double Cm = Cmq * q_b_rps * c_m / (2 * true_airspeed_mps);
-
-	return Cm;
-}
-
-double Cn_brick(double Cnp, double Cnr, double p_b_rps, double r_b_rps, double b_m, double true_airspeed_mps)
-{
-	if (true_airspeed_mps < 1e-6) return 0.0;  
-	double Cn = Cnp * p_b_rps * b_m / (2 * true_airspeed_mps) + Cnr * r_b_rps * b_m / (2 * true_airspeed_mps);
-
-	return Cn;
-
-}
-
 double sphere_drag(double mach)
 {
 
@@ -531,4 +509,60 @@ double sphere_drag(double mach)
 	}
 
 	return cd;
-}
\ No newline at end of file
+}
+
+static double amod_value_or(const std::unordered_map<std::string, double>& amod, const std::string& key, double fallback)
+{
+	auto it = amod.find(key);
+	return it == amod.end() ? fallback : it->second;
+}
+
+VehicleParams compileVehicle(const std::unordered_map<std::string, double>& amod)
+{
+	VehicleParams vehicle;
+
+	vehicle.m_kg = amod.at("m_kg");
+	vehicle.Jxx_b_kgm2 = amod.at("Jxx_b_kgm2");
+	vehicle.Jyy_b_kgm2 = amod.at("Jyy_b_kgm2");
+	vehicle.Jzz_b_kgm2 = amod.at("Jzz_b_kgm2");
+	vehicle.Jxz_b_kgm2 = amod_value_or(amod, "Jxz_b_kgm2", 0.0);
+
+	// The sphere presets only carry their radius as a reference length
+	double r_sphere_m = amod_value_or(amod, "r_sphere_m", 0.0);
+	vehicle.Aref_m2 = amod.at("Aref_m2");
+	vehicle.b_m = amod_value_or(amod, "b_m", r_sphere_m);
+	vehicle.c_m = amod_value_or(amod, "c_m", r_sphere_m);
+
+	vehicle.CD_approx = amod_value_or(amod, "CD_approx", 0.0);
+	vehicle.Clp = amod_value_or(amod, "Clp", 0.0);
+	vehicle.Clr = amod_value_or(amod, "Clr", 0.0);
+	vehicle.Cmq = amod_value_or(amod, "Cmq", 0.0);
+	vehicle.Cnp = amod_value_or(amod, "Cnp", 0.0);
+	vehicle.Cnr = amod_value_or(amod, "Cnr", 0.0);
+
+	compileVehicle(vehicle);
+
+	return vehicle;
+}
+
+std::unordered_map<std::string, double> makeVehicleModel(VehiclePreset preset)
+{
+	switch (preset)
+	{
+	case VehiclePreset::Musketball50cal: return Musketball50cal();
+	case VehiclePreset::Carronade12lb: return Carronade12lb();
+	case VehiclePreset::BlueBerry: return BlueBerry();
+	case VehiclePreset::Bowlingball: return Bowlingball();
+	case VehiclePreset::TsarCannonball: return TsarCannonball();
+	case VehiclePreset::NASA_Atmos01_Sphere: return NASA_Atmos01_Sphere();
+	case VehiclePreset::NASA_Atmos02_Brick: return NASA_Atmos02_Brick();
+	case VehiclePreset::NASA_Atmos03_Brick: return NASA_Atmos03_Brick();
+	}
+
+	throw std::invalid_argument("makeVehicleModel: unknown vehicle preset");
+}
+
+VehicleParams makeVehicle(VehiclePreset preset)
+{
+	return compileVehicle(makeVehicleModel(preset));
+}
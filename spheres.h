@@ -5,6 +5,136 @@
 #include <tuple>
 #include <unordered_map>
 #include <string>
+#include "scalar_traits.h"
+
+// Typed vehicle parameter block. Built once from an amod map by compileVehicle so
+// the equations of motion read plain fields instead of hashing string keys.
+// Aligned to a cache line; the hot fields fit in the first three lines.
+// Generic over the scalar type so Dual numbers can carry parameter sensitivities;
+// VehicleParams is the double instantiation everything else uses.
+template <class T>
+struct alignas(64) BasicVehicleParams
+{
+	// Mass and moments of inertia
+	T m_kg = T(0);
+	T Jxx_b_kgm2 = T(0);
+	T Jyy_b_kgm2 = T(0);
+	T Jzz_b_kgm2 = T(0);
+	T Jxz_b_kgm2 = T(0);
+
+	// Reference dimensions
+	T Aref_m2 = T(0);
+	T b_m = T(0);
+	T c_m = T(0);
+
+	// Aerodynamic coefficients
+	T CD_approx = T(0);
+	T Clp = T(0);
+	T Clr = T(0);
+	T Cmq = T(0);
+	T Cnp = T(0);
+	T Cnr = T(0);
+
+	// Derived constants, filled in by compileVehicle
+	T inv_m_kg = T(0);     // 1 / m
+	T Den = T(0);          // Jxx * Jzz - Jxz^2
+	T roll_pq = T(0);      // p*q coefficient of the roll equation, divided by Den
+	T roll_qr = T(0);      // q*r coefficient of the roll equation, divided by Den
+	T roll_l = T(0);       // Jzz / Den
+	T roll_n = T(0);       // Jxz / Den
+	T pitch_pr = T(0);     // (Jzz - Jxx) / Jyy
+	T pitch_pp_rr = T(0);  // Jxz / Jyy
+	T inv_Jyy = T(0);      // 1 / Jyy
+	T yaw_pq = T(0);       // p*q coefficient of the yaw equation, divided by Den
+	T yaw_qr = T(0);       // q*r coefficient of the yaw equation, divided by Den
+	T yaw_l = T(0);        // Jxz / Den
+	T yaw_n = T(0);        // Jxz / Den
+};
+
+using VehicleParams = BasicVehicleParams<double>;
+
+// Vehicle presets, for building a VehicleParams without going through a map by hand
+enum class VehiclePreset
+{
+	Musketball50cal,
+	Carronade12lb,
+	BlueBerry,
+	Bowlingball,
+	TsarCannonball,
+	NASA_Atmos01_Sphere,
+	NASA_Atmos02_Brick,
+	NASA_Atmos03_Brick
+};
+
+// Fill in the derived constants of a vehicle whose raw fields are set
+template <class T>
+void compileVehicle(BasicVehicleParams<T>& vehicle)
+{
+	using S = scalar_t<T>;
+
+	T Jxx = vehicle.Jxx_b_kgm2;
+	T Jyy = vehicle.Jyy_b_kgm2;
+	T Jzz = vehicle.Jzz_b_kgm2;
+	T Jxz = vehicle.Jxz_b_kgm2;
+
+	// Denominator in roll and yaw rate equations
+	vehicle.Den = Jxx * Jzz - Jxz * Jxz;
+	vehicle.inv_m_kg = S(1) / vehicle.m_kg;
+
+	// Roll equation coefficients
+	vehicle.roll_pq = Jzz * (Jxx - Jyy + Jzz) / vehicle.Den;
+	vehicle.roll_qr = Jzz * (Jzz * (Jzz - Jyy) + Jxz * Jxz) / vehicle.Den;
+	vehicle.roll_l = Jzz / vehicle.Den;
+	vehicle.roll_n = Jxz / vehicle.Den;
+
+	// Pitch equation coefficients
+	vehicle.pitch_pr = (Jzz - Jxx) / Jyy;
+	vehicle.pitch_pp_rr = Jxz / Jyy;
+	vehicle.inv_Jyy = S(1) / Jyy;
+
+	// Yaw equation coefficients
+	vehicle.yaw_pq = (Jzz * (Jxx - Jyy) + Jxz * Jxz) / vehicle.Den;
+	vehicle.yaw_qr = Jxz * (Jxx - Jyy + Jzz) / vehicle.Den;
+	vehicle.yaw_l = Jxz / vehicle.Den;
+	vehicle.yaw_n = Jxz / vehicle.Den;
+}
+
+// Copy the raw fields of a compiled vehicle into another scalar type (e.g. a
+// Dual, before seeding the parameters to differentiate) and recompile
+template <class U>
+BasicVehicleParams<U> convertVehicle(const VehicleParams& vehicle)
+{
+	BasicVehicleParams<U> converted;
+
+	converted.m_kg = U(vehicle.m_kg);
+	converted.Jxx_b_kgm2 = U(vehicle.Jxx_b_kgm2);
+	converted.Jyy_b_kgm2 = U(vehicle.Jyy_b_kgm2);
+	converted.Jzz_b_kgm2 = U(vehicle.Jzz_b_kgm2);
+	converted.Jxz_b_kgm2 = U(vehicle.Jxz_b_kgm2);
+	converted.Aref_m2 = U(vehicle.Aref_m2);
+	converted.b_m = U(vehicle.b_m);
+	converted.c_m = U(vehicle.c_m);
+	converted.CD_approx = U(vehicle.CD_approx);
+	converted.Clp = U(vehicle.Clp);
+	converted.Clr = U(vehicle.Clr);
+	converted.Cmq = U(vehicle.Cmq);
+	converted.Cnp = U(vehicle.Cnp);
+	converted.Cnr = U(vehicle.Cnr);
+
+	compileVehicle(converted);
+
+	return converted;
+}
+
+// Convert an amod map into a compiled VehicleParams. Keys a preset does not
+// define (e.g. damping derivatives on the spheres) default to zero.
+VehicleParams compileVehicle(const std::unordered_map<std::string, double>& amod);
+
+// Build the amod map of a preset
+std::unordered_map<std::string, double> makeVehicleModel(VehiclePreset preset);
+
+// Build and compile a preset
+VehicleParams makeVehicle(VehiclePreset preset);
 
 // Function to calculate properties of a sphere
 std::tuple<double, double, double, double> CalcSphereProps(double r_sphere_m, double rho_sphere_kgpm3);
@@ -29,11 +159,41 @@ std::unordered_map<std::string, double> NASA_Atmos02_Brick();
 
 std::unordered_map<std::string, double> NASA_Atmos03_Brick();
 
-double Cl_brick(double Clp, double Clr, double p_b_rps, double r_b_rps, double b_m, double true_airspeed_mps);
-
-double Cm_brick(double Cmq, double q_b_rps, double c_m, double true_airspeed_mps);
-
-double Cn_brick(double Cnp, double Cnr, double p_b_rps, double r_b_rps, double b_m, double true_airspeed_mps);
+// Damping moment coefficients of the bricks, generic over the scalar type
+template <class T>
+T Cl_brick(T Clp, T Clr, T p_b_rps, T r_b_rps, T b_m, T true_airspeed_mps)
+{
+	using S = scalar_t<T>;
+	if (true_airspeed_mps < S(1e-6)) return T(0);  // Avoid division by zero
+	T Cl = Clp * p_b_rps * b_m / (S(2) * true_airspeed_mps) + Clr * r_b_rps * b_m / (S(2) * true_airspeed_mps);
+	return Cl;
+}
+
+template <class T>
+T Cm_brick(T Cmq, T q_b_rps, T c_m, T true_airspeed_mps)
+{
+	using S = scalar_t<T>;
+	if (true_airspeed_mps < S(1e-6))
+	{
+		return T(0);
+	}
+	T Cm = Cmq * q_b_rps * c_m / (S(2) * true_airspeed_mps);
+
+	return Cm;
+}
+
+template <class T>
+T Cn_brick(T Cnp, T Cnr, T p_b_rps, T r_b_rps, T b_m, T true_airspeed_mps)
+{
+	using S = scalar_t<T>;
+	if (true_airspeed_mps < S(1e-6))
+	{
+		return T(0);
+	}
+	T Cn = Cnp * p_b_rps * b_m / (S(2) * true_airspeed_mps) + Cnr * r_b_rps * b_m / (S(2) * true_airspeed_mps);
+
+	return Cn;
+}
 
 double sphere_drag(double mach);
 
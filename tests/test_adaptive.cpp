@@ -0,0 +1,127 @@
+// Checks DormandPrince45Stepper and the sampled drivers on problems with a
+// known solution: the step ends and the dense output against the tolerance,
+// and the accepted, rejected and RHS counters
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <span>
+#include <vector>
+#include "adaptive_integrators.h"
+#include "numerical_integration_methods.h"
+
+namespace
+{
+	constexpr double OMEGA = 2.0 * std::numbers::pi;
+	constexpr double TF_S = 10.0;
+
+	// x'' = -omega^2 x from x = 1, x' = 0
+	void oscillator(double, std::span<const double> x, std::span<double> dx)
+	{
+		dx[0] = x[1];
+		dx[1] = -OMEGA * OMEGA * x[0];
+	}
+
+	double oscillator_error(double t, std::span<const double> x)
+	{
+		return std::max(std::abs(x[0] - std::cos(OMEGA * t)), std::abs(x[1] + OMEGA * std::sin(OMEGA * t)) / OMEGA);
+	}
+
+	int report(bool pass, const char* what, double value)
+	{
+		std::printf("%s %-48s %.3e\n", pass ? "ok  " : "FAIL", what, value);
+		return pass ? 0 : 1;
+	}
+}
+
+int main()
+{
+	int failures = 0;
+
+	// Ten periods of the oscillator at three tolerances: the global error
+	// at the step ends and at a 7.3 Hz output clock stays within a small
+	// multiple of the tolerance and falls with it
+	for (double tol : { 1e-6, 1e-8, 1e-10 })
+	{
+		StepSizeControl control;
+		control.abs_tol = { tol };
+		control.rel_tol = { tol };
+
+		DormandPrince45Stepper stepper(oscillator, 2, control);
+		Trajectory steps = integrate_adaptive(stepper, 0.0, { 1.0, 0.0 }, TF_S);
+
+		double step_error = 0.0;
+		for (std::size_t k = 0; k < steps.num_times(); ++k)
+		{
+			step_error = std::max(step_error, oscillator_error(steps.time(k), steps.row(k).span()));
+		}
+
+		// FSAL: the first stage and the starting-step probe, then six per attempt
+		bool counted = stepper.rhs_evals() == 2 + 6 * (stepper.accepted_steps() + stepper.rejected_steps())
+			&& stepper.accepted_steps() + 1 == steps.num_times() && steps.time(steps.num_times() - 1) == TF_S;
+
+		DormandPrince45Stepper sampled_stepper(oscillator, 2, control);
+		std::vector<double> t_out = sample_times(0.0, TF_S, 7.3);
+		Trajectory sampled = integrate_adaptive_sampled(sampled_stepper, 0.0, { 1.0, 0.0 }, t_out);
+
+		double dense_error = 0.0;
+		for (std::size_t k = 0; k < sampled.num_times(); ++k)
+		{
+			dense_error = std::max(dense_error, oscillator_error(sampled.time(k), sampled.row(k).span()));
+		}
+
+		std::printf("     tol %.0e: %zu accepted, %zu rejected, %zu RHS evaluations\n", tol,
+			stepper.accepted_steps(), stepper.rejected_steps(), stepper.rhs_evals());
+		failures += report(step_error <= 50.0 * tol, "DP45 oscillator step-end error / tol", step_error / tol);
+		failures += report(dense_error <= 50.0 * tol, "DP45 oscillator 7.3 Hz dense-output error / tol", dense_error / tol);
+		failures += report(counted, "DP45 counters consistent with the steps", 0.0);
+		failures += report(sampled_stepper.rhs_evals() == stepper.rhs_evals(), "dense output costs no RHS evaluations", 0.0);
+	}
+
+	// x' = 0 before t = 1 and 1 after: the steps across the kink fail their
+	// error test and are retried. The error estimate under-reads a kink, so
+	// the step that takes it leaves more than the tolerance; after it the
+	// solution max(0, t - 1) is followed exactly.
+	{
+		StepSizeControl control;
+		control.abs_tol = { 1e-8 };
+		control.rel_tol = { 1e-8 };
+		control.h_initial_s = 0.3;
+
+		DormandPrince45Stepper stepper([](double t, std::span<const double>, std::span<double> dx) { dx[0] = t < 1.0 ? 0.0 : 1.0; }, 1, control);
+		Trajectory steps = integrate_adaptive(stepper, 0.0, { 0.0 }, 3.0);
+		double error = std::abs(steps(steps.num_times() - 1, 0) - 2.0);
+
+		failures += report(stepper.rejected_steps() > 0, "DP45 rejects steps across a kink", static_cast<double>(stepper.rejected_steps()));
+		failures += report(error <= 1e-6, "DP45 error after the kink", error);
+	}
+
+	// RK4 on the fixed-step clock, sampled at 7.3 Hz: the dense output error
+	// is of the order of the step-end error
+	{
+		constexpr double H_S = 0.01;
+		RK4Stepper stepper(oscillator, 2);
+		Trajectory steps = integrate_sampled(stepper, 0.0, { 1.0, 0.0 }, H_S, sample_times(0.0, TF_S, 1.0 / H_S));
+
+		RK4Stepper sampled_stepper(oscillator, 2);
+		std::vector<double> t_out = sample_times(0.0, TF_S, 7.3);
+		Trajectory sampled = integrate_sampled(sampled_stepper, 0.0, { 1.0, 0.0 }, H_S, t_out);
+
+		double step_error = 0.0;
+		for (std::size_t k = 0; k < steps.num_times(); ++k)
+		{
+			step_error = std::max(step_error, oscillator_error(steps.time(k), steps.row(k).span()));
+		}
+		double dense_error = 0.0;
+		for (std::size_t k = 0; k < sampled.num_times(); ++k)
+		{
+			dense_error = std::max(dense_error, oscillator_error(sampled.time(k), sampled.row(k).span()));
+		}
+
+		failures += report(step_error <= 1e-5, "RK4 h = 0.01 oscillator step-end error", step_error);
+		failures += report(dense_error <= 1.5 * step_error, "RK4 7.3 Hz dense-output error / step-end error", dense_error / step_error);
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Checks that integrate_checkpointed resumes a killed run bit for bit, and
+// that a checkpoint refuses to resume into another stepper, including one
+// whose state has the same size (AB2Stepper and AdamsBashforthStepper<F, 2>)
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "flat_earth_checkpoint.h"
+#include "flat_earth_eom.h"
+#include "flat_earth_eom_kernel.h"
+#include "flat_earth_ensemble.h"
+#include "integrator_checkpoint.h"
+#include "numerical_integration_methods.h"
+
+namespace
+{
+	constexpr double H_S = 0.001;
+	constexpr double TF_S = 5.0;
+	constexpr std::size_t INTERVAL_STEPS = 1000;
+	constexpr std::size_t KILL_STEP = 2500;
+
+	struct Killed {};
+
+	// Runs until KILL_STEP, leaving the checkpoint of step 2000 behind
+	template <class Stepper>
+	void killed_run(Stepper& stepper, const std::vector<double>& x0, const CheckpointOptions& options)
+	{
+		std::size_t steps = 0;
+		try
+		{
+			integrate_checkpointed(stepper, 0.0, x0, TF_S, [&](double, std::span<const double>)
+			{
+				if (steps++ == KILL_STEP)
+				{
+					throw Killed{};
+				}
+			}, options, H_S);
+		}
+		catch (const Killed&)
+		{
+		}
+	}
+
+	template <class Stepper>
+	bool refuses(Stepper& stepper, const std::vector<double>& x0, const CheckpointOptions& options)
+	{
+		try
+		{
+			integrate_checkpointed(stepper, 0.0, x0, TF_S, [](double, std::span<const double>) {}, options, H_S);
+		}
+		catch (const std::runtime_error& error)
+		{
+			std::printf("      refused: %s\n", error.what());
+			return true;
+		}
+		return false;
+	}
+}
+
+int main()
+{
+	const VehicleParams vehicle = makeVehicle(VehiclePreset::NASA_Atmos03_Brick);
+	const std::array<double, 12> initial = check_case_initial_state(VehiclePreset::NASA_Atmos03_Brick);
+	const std::vector<double> x0(initial.begin(), initial.end());
+	using Rhs = FlatEarthRhs<>;
+
+	CheckpointOptions options;
+	options.path = "test_checkpoint.feckpt";
+	options.parameter_hash = flat_earth_parameter_hash(vehicle);
+	options.interval_steps = INTERVAL_STEPS;
+	remove_checkpoint(options.path);
+
+	int failures = 0;
+
+	// Uninterrupted against killed and resumed
+	{
+		AB2Stepper<Rhs> reference(Rhs{ vehicle }, 12);
+		CheckpointOptions off;
+		std::vector<double> expected = integrate_checkpointed(reference, 0.0, x0, TF_S, [](double, std::span<const double>) {}, off, H_S);
+
+		AB2Stepper<Rhs> first(Rhs{ vehicle }, 12);
+		killed_run(first, x0, options);
+		bool written = checkpoint_exists(options.path);
+
+		AB2Stepper<Rhs> second(Rhs{ vehicle }, 12);
+		std::vector<double> resumed = integrate_checkpointed(second, 0.0, x0, TF_S, [](double, std::span<const double>) {}, options, H_S);
+
+		bool pass = written && std::memcmp(expected.data(), resumed.data(), expected.size() * sizeof(double)) == 0;
+		std::printf("%s AB2Stepper resumed bit for bit\n", pass ? "ok  " : "FAIL");
+		failures += pass ? 0 : 1;
+	}
+
+	// Same state size, other startup
+	{
+		AB2Stepper<Rhs> first(Rhs{ vehicle }, 12);
+		killed_run(first, x0, options);
+
+		AdamsBashforthStepper<Rhs, 2> other(Rhs{ vehicle }, 12);
+		bool pass = refuses(other, x0, options);
+		std::printf("%s AB2Stepper checkpoint into AdamsBashforthStepper<F, 2>\n", pass ? "ok  " : "FAIL");
+		failures += pass ? 0 : 1;
+
+		RK4Stepper<Rhs> rk4(Rhs{ vehicle }, 12);
+		pass = refuses(rk4, x0, options);
+		std::printf("%s AB2Stepper checkpoint into RK4Stepper\n", pass ? "ok  " : "FAIL");
+		failures += pass ? 0 : 1;
+	}
+
+	remove_checkpoint(options.path);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+// Checks the double and float batched EoM against flat_earth_eom_inplace, lane
+// by lane, for every preset. The lane count is not a multiple of any SIMD width
+// so the scalar tail runs too. Built once per instruction set (CMakeLists.txt);
+// FLAT_EARTH_EXPECTED_BATCH_WIDTH makes sure the intended vector path was compiled.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <span>
+#include <vector>
+#include "flat_earth_eom.h"
+#include "flat_earth_eom_batch.h"
+#include "test_states.h"
+
+namespace
+{
+	// 5 lanes per preset and 3 more: 43 leaves a tail for widths 4, 8 and 16
+	constexpr std::size_t NUM_LANES = 5 * NUM_TEST_PRESETS + 3;
+
+	// Largest difference of batch from reference over all lanes and states,
+	// relative to 1 + |reference|
+	template <class T>
+	double max_error(const std::vector<std::array<double, 12>>& reference, const std::array<std::vector<T>, 12>& batch)
+	{
+		double error = 0.0;
+		for (std::size_t i = 0; i < reference.size(); ++i)
+		{
+			for (std::size_t j = 0; j < 12; ++j)
+			{
+				double difference = std::abs(static_cast<double>(batch[j][i]) - reference[i][j]) / (1.0 + std::abs(reference[i][j]));
+				error = std::max(error, std::isnan(difference) ? INFINITY : difference);
+			}
+		}
+		return error;
+	}
+}
+
+int main()
+{
+#if defined(FLAT_EARTH_EXPECTED_BATCH_WIDTH) && (defined(__GNUC__) || defined(__clang__))
+	// Built for an instruction set this CPU does not have: skip (CTest SKIP_RETURN_CODE)
+#if defined(__AVX512F__)
+	if (!__builtin_cpu_supports("avx512f"))
+	{
+		std::printf("skipped: no AVX-512F on this CPU\n");
+		return 77;
+	}
+#elif defined(__AVX2__)
+	if (!__builtin_cpu_supports("avx2"))
+	{
+		std::printf("skipped: no AVX2 on this CPU\n");
+		return 77;
+	}
+#endif
+#endif
+
+	int failures = 0;
+
+#ifdef FLAT_EARTH_EXPECTED_BATCH_WIDTH
+	if (flat_earth_eom_batch_width() != FLAT_EARTH_EXPECTED_BATCH_WIDTH
+		|| flat_earth_eom_batch_width_float() != 2 * FLAT_EARTH_EXPECTED_BATCH_WIDTH)
+	{
+		std::printf("FAIL: batch width %zu (float %zu), expected %d\n",
+			flat_earth_eom_batch_width(), flat_earth_eom_batch_width_float(), FLAT_EARTH_EXPECTED_BATCH_WIDTH);
+		++failures;
+	}
+#endif
+
+	std::vector<VehicleParams> vehicles(NUM_LANES);
+	for (std::size_t i = 0; i < NUM_LANES; ++i)
+	{
+		vehicles[i] = makeVehicle(TEST_PRESETS[i % NUM_TEST_PRESETS]);
+	}
+
+	std::mt19937_64 rng(20240611);
+	std::vector<std::array<double, 12>> states(NUM_LANES);
+	for (std::array<double, 12>& x : states)
+	{
+		x = random_flight_state(rng);
+	}
+
+	// Double kernel against the scalar kernel on the same states
+	{
+		std::vector<std::array<double, 12>> reference(NUM_LANES);
+		std::array<std::vector<double>, 12> x, dx;
+		std::array<const double*, 12> x_ptr;
+		std::array<double*, 12> dx_ptr;
+		for (std::size_t j = 0; j < 12; ++j)
+		{
+			x[j].resize(NUM_LANES);
+			dx[j].assign(NUM_LANES, NAN);
+			x_ptr[j] = x[j].data();
+			dx_ptr[j] = dx[j].data();
+		}
+
+		for (std::size_t i = 0; i < NUM_LANES; ++i)
+		{
+			flat_earth_eom_inplace(0.0, states[i], vehicles[i], reference[i]);
+			for (std::size_t j = 0; j < 12; ++j)
+			{
+				x[j][i] = states[i][j];
+			}
+		}
+
+		flat_earth_eom_batch(0.0, NUM_LANES, x_ptr, VehicleBatch(vehicles), dx_ptr);
+
+		double error = max_error(reference, dx);
+		bool pass = error <= 1e-12;
+		std::printf("%s double: width %zu, %zu lanes, max error %.2e\n", pass ? "ok  " : "FAIL", flat_earth_eom_batch_width(), NUM_LANES, error);
+		failures += pass ? 0 : 1;
+	}
+
+	// Float kernel against the scalar kernel on the states rounded to float
+	{
+		std::vector<std::array<double, 12>> reference(NUM_LANES);
+		std::array<std::vector<float>, 12> x, dx;
+		std::array<const float*, 12> x_ptr;
+		std::array<float*, 12> dx_ptr;
+		for (std::size_t j = 0; j < 12; ++j)
+		{
+			x[j].resize(NUM_LANES);
+			dx[j].assign(NUM_LANES, NAN);
+			x_ptr[j] = x[j].data();
+			dx_ptr[j] = dx[j].data();
+		}
+
+		for (std::size_t i = 0; i < NUM_LANES; ++i)
+		{
+			std::array<double, 12> rounded;
+			for (std::size_t j = 0; j < 12; ++j)
+			{
+				x[j][i] = static_cast<float>(states[i][j]);
+				rounded[j] = x[j][i];
+			}
+			flat_earth_eom_inplace(0.0, rounded, vehicles[i], reference[i]);
+		}
+
+		flat_earth_eom_batch(0.0, NUM_LANES, x_ptr, VehicleBatchFloat(vehicles), dx_ptr);
+
+		double error = max_error(reference, dx);
+		bool pass = error <= 5e-5;
+		std::printf("%s float:  width %zu, %zu lanes, max error %.2e\n", pass ? "ok  " : "FAIL", flat_earth_eom_batch_width_float(), NUM_LANES, error);
+		failures += pass ? 0 : 1;
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// Checks integrate_with_events: ground impact and Mach crossings located on
+// RK4 and Dormand-Prince dense output agree, fixed steps stay on the t0 + k * h
+// grid, and a bouncing brick settles and stops
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <span>
+#include <vector>
+#include "adaptive_integrators.h"
+#include "flat_earth_eom_kernel.h"
+#include "flat_earth_ensemble.h"
+#include "flat_earth_events.h"
+#include "numerical_integration_methods.h"
+
+namespace
+{
+	constexpr double TF_S = 200.0;
+
+	int report(bool pass, const char* what, double value)
+	{
+		std::printf("%s %-44s %.3e\n", pass ? "ok  " : "FAIL", what, value);
+		return pass ? 0 : 1;
+	}
+
+	// Time of the first crossing of event e, or NaN
+	double first_crossing(const EventRun& run, std::size_t e)
+	{
+		for (const EventRecord& record : run.events)
+		{
+			if (record.event == e)
+			{
+				return record.t_s;
+			}
+		}
+		return NAN;
+	}
+
+	std::size_t count_crossings(const EventRun& run, std::size_t e)
+	{
+		return static_cast<std::size_t>(std::count_if(run.events.begin(), run.events.end(),
+			[e](const EventRecord& record) { return record.event == e; }));
+	}
+}
+
+int main()
+{
+	using Rhs = FlatEarthRhs<>;
+	int failures = 0;
+
+	StepSizeControl control;
+	control.abs_tol = { 1e-10 };
+	control.rel_tol = { 1e-10 };
+
+	// Atmos01 sphere dropped from 9146 m: impact, Mach 0.1 and 500 Pa on the way down
+	{
+		const VehicleParams vehicle = makeVehicle(VehiclePreset::NASA_Atmos01_Sphere);
+		const std::array<double, 12> initial = check_case_initial_state(VehiclePreset::NASA_Atmos01_Sphere);
+		const std::vector<double> x0(initial.begin(), initial.end());
+		const std::vector<Event> events = { ground_impact_event(), mach_event(0.1), dynamic_pressure_event(500.0) };
+
+		constexpr double H_S = 0.01;
+		RK4Stepper<Rhs> rk4(Rhs{ vehicle }, 12);
+		EventRun fixed = integrate_with_events(rk4, 0.0, x0, TF_S, events, H_S);
+
+		DormandPrince45Stepper<Rhs> dp45(Rhs{ vehicle }, 12, control);
+		EventRun adaptive = integrate_with_events(dp45, 0.0, x0, TF_S, events);
+
+		double impact_fixed = first_crossing(fixed, 0);
+		double impact_adaptive = first_crossing(adaptive, 0);
+		failures += report(fixed.stopped && adaptive.stopped && impact_fixed > 50.0, "Atmos01 impact with RK4 [s]", impact_fixed);
+		failures += report(std::abs(impact_fixed - impact_adaptive) <= 1e-9, "Atmos01 impact, RK4 - DP45 [s]", impact_fixed - impact_adaptive);
+
+		double mach_fixed = first_crossing(fixed, 1);
+		double mach_adaptive = first_crossing(adaptive, 1);
+		failures += report(std::abs(mach_fixed - mach_adaptive) <= 1e-9, "Atmos01 Mach 0.1, RK4 - DP45 [s]", mach_fixed - mach_adaptive);
+
+		double qbar_fixed = first_crossing(fixed, 2);
+		double qbar_adaptive = first_crossing(adaptive, 2);
+		failures += report(std::abs(qbar_fixed - qbar_adaptive) <= 1e-9, "Atmos01 500 Pa, RK4 - DP45 [s]", qbar_fixed - qbar_adaptive);
+
+		// Record crossings add no trajectory point: every point but the last
+		// (the impact) is a step end on the grid, counted, not summed
+		double off_grid = 0.0;
+		for (std::size_t k = 0; k + 1 < fixed.trajectory.num_times(); ++k)
+		{
+			off_grid = std::max(off_grid, std::abs(fixed.trajectory.time(k) - static_cast<double>(k) * H_S));
+		}
+		failures += report(off_grid == 0.0, "RK4 step ends off t0 + k * h [s]", off_grid);
+
+		double altitude = -fixed.trajectory(fixed.trajectory.num_times() - 1, 11);
+		failures += report(std::abs(altitude) <= 1e-9, "RK4 altitude at the impact point [m]", altitude);
+	}
+
+	// Atmos03 brick from 20 m, bouncing until the impact speed is below 0.5 m/s
+	{
+		const VehicleParams vehicle = makeVehicle(VehiclePreset::NASA_Atmos03_Brick);
+		std::array<double, 12> initial = check_case_initial_state(VehiclePreset::NASA_Atmos03_Brick);
+		initial[11] = -20.0;
+		const std::vector<double> x0(initial.begin(), initial.end());
+		const std::vector<Event> events = { ground_bounce_event() };
+
+		RK4Stepper<Rhs> rk4(Rhs{ vehicle }, 12);
+		EventRun fixed = integrate_with_events(rk4, 0.0, x0, TF_S, events, 0.001);
+
+		DormandPrince45Stepper<Rhs> dp45(Rhs{ vehicle }, 12, control);
+		EventRun adaptive = integrate_with_events(dp45, 0.0, x0, TF_S, events);
+
+		std::size_t bounces = count_crossings(fixed, 0);
+		double settle_fixed = fixed.events.empty() ? NAN : fixed.events.back().t_s;
+		double settle_adaptive = adaptive.events.empty() ? NAN : adaptive.events.back().t_s;
+
+		failures += report(fixed.stopped && adaptive.stopped && settle_fixed < 10.0, "brick bounce settles, RK4 [s]", settle_fixed);
+		failures += report(bounces >= 3 && bounces == count_crossings(adaptive, 0), "brick ground contacts, RK4 and DP45", static_cast<double>(bounces));
+		failures += report(std::abs(settle_fixed - settle_adaptive) <= 1e-6, "brick settle time, RK4 - DP45 [s]", settle_fixed - settle_adaptive);
+
+		// Each contact is slower than the one before
+		auto speed = [](const EventRecord& record) { return std::hypot(record.x[0], record.x[1], record.x[2]); };
+		bool slowing = true;
+		for (std::size_t k = 1; k < fixed.events.size(); ++k)
+		{
+			slowing = slowing && speed(fixed.events[k]) < speed(fixed.events[k - 1]);
+		}
+		failures += report(slowing, "brick impact speeds decrease", 0.0);
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+// Checks the fast_math.h error table: the largest error of each function in
+// ulp against long double libm, over 2e6 random points per range, must stay
+// within the documented bound
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include "fast_math.h"
+
+namespace
+{
+	constexpr std::size_t NUM_POINTS = 2000000;
+
+	// Error of value in units of the last place of the reference rounded to T
+	template <class T>
+	double ulp_error(T value, long double reference)
+	{
+		T rounded = static_cast<T>(reference);
+		T magnitude = std::abs(rounded);
+		long double ulp = static_cast<long double>(std::nextafter(magnitude, std::numeric_limits<T>::infinity()) - magnitude);
+		return static_cast<double>(std::abs(static_cast<long double>(value) - reference) / ulp);
+	}
+
+	int check(const char* name, double max_ulp, double bound)
+	{
+		bool pass = max_ulp <= bound;
+		std::printf("%s %-30s %.2f ulp (bound %.1f)\n", pass ? "ok  " : "FAIL", name, max_ulp, bound);
+		return pass ? 0 : 1;
+	}
+
+	template <class T>
+	double sincos_max_ulp(std::mt19937_64& rng, T range)
+	{
+		std::uniform_real_distribution<T> angle(-range, range);
+		double max_ulp = 0.0;
+		for (std::size_t k = 0; k < NUM_POINTS; ++k)
+		{
+			T x = angle(rng);
+			T s, c;
+			fast_sincos(x, s, c);
+			max_ulp = std::max({ max_ulp, ulp_error(s, std::sin(static_cast<long double>(x))), ulp_error(c, std::cos(static_cast<long double>(x))) });
+		}
+		return max_ulp;
+	}
+
+	// Magnitudes log-uniform over 1e-4 to 1e4, signs random
+	template <class T>
+	double atan2_max_ulp(std::mt19937_64& rng)
+	{
+		std::uniform_real_distribution<double> exponent(-4.0, 4.0);
+		std::bernoulli_distribution negative(0.5);
+		double max_ulp = 0.0;
+		for (std::size_t k = 0; k < NUM_POINTS; ++k)
+		{
+			T y = static_cast<T>((negative(rng) ? -1.0 : 1.0) * std::pow(10.0, exponent(rng)));
+			T x = static_cast<T>((negative(rng) ? -1.0 : 1.0) * std::pow(10.0, exponent(rng)));
+			max_ulp = std::max(max_ulp, ulp_error(fast_atan2(y, x), std::atan2(static_cast<long double>(y), static_cast<long double>(x))));
+		}
+		return max_ulp;
+	}
+
+	template <class T>
+	double asin_max_ulp(std::mt19937_64& rng)
+	{
+		std::uniform_real_distribution<T> unit(T(-1), T(1));
+		double max_ulp = 0.0;
+		for (std::size_t k = 0; k < NUM_POINTS; ++k)
+		{
+			T x = unit(rng);
+			max_ulp = std::max(max_ulp, ulp_error(fast_asin(x), std::asin(static_cast<long double>(x))));
+		}
+		return max_ulp;
+	}
+}
+
+int main()
+{
+	std::mt19937_64 rng(20240613);
+	int failures = 0;
+
+	failures += check("fast_sincos  |x| <= 4", sincos_max_ulp(rng, 4.0), 1.5);
+	failures += check("fast_sincos  |x| <= 1e5", sincos_max_ulp(rng, 1e5), 2.5);
+	failures += check("fast_sincos  |x| <= 4, float", sincos_max_ulp(rng, 4.0f), 1.6);
+	failures += check("fast_sincos  |x| <= 1e3, float", sincos_max_ulp(rng, 1e3f), 1.6);
+	failures += check("fast_atan2", atan2_max_ulp<double>(rng), 1.8);
+	failures += check("fast_atan2, float", atan2_max_ulp<float>(rng), 3.2);
+	failures += check("fast_asin", asin_max_ulp<double>(rng), 2.6);
+	failures += check("fast_asin, float", asin_max_ulp<float>(rng), 3.8);
+
+	return failures == 0 ? 0 : 1;
+}
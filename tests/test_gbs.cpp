@@ -0,0 +1,171 @@
+// Checks GraggBulirschStoerStepper on problems with a known solution: the
+// step ends with and without dense output, the interpolant between them and
+// the ERRINT rejection that keeps it near the tolerance, and the order the
+// controller climbs to at tight tolerances
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "adaptive_integrators.h"
+#include "numerical_integration_methods.h"
+
+namespace
+{
+	constexpr double OMEGA = 2.0 * std::numbers::pi;
+	constexpr double TF_S = 10.0;
+
+	// x'' = -omega^2 x from x = 1, x' = 0
+	void oscillator(double, std::span<const double> x, std::span<double> dx)
+	{
+		dx[0] = x[1];
+		dx[1] = -OMEGA * OMEGA * x[0];
+	}
+
+	double oscillator_error(double t, std::span<const double> x)
+	{
+		return std::max(std::abs(x[0] - std::cos(OMEGA * t)), std::abs(x[1] + OMEGA * std::sin(OMEGA * t)) / OMEGA);
+	}
+
+	// x' = -2 t x^2 from x = 1: x = 1 / (1 + t^2), whose poles at +-i keep the
+	// high derivatives large
+	void rational(double t, std::span<const double> x, std::span<double> dx)
+	{
+		dx[0] = -2.0 * t * x[0] * x[0];
+	}
+
+	double rational_error(double t, std::span<const double> x)
+	{
+		return std::abs(x[0] - 1.0 / (1.0 + t * t));
+	}
+
+	// x' = 2 t cos(t^2) from x = 0: x = sin(t^2), a chirp. Long steps of high
+	// order land on the ends but can swing between them.
+	void chirp(double t, std::span<const double>, std::span<double> dx)
+	{
+		dx[0] = 2.0 * t * std::cos(t * t);
+	}
+
+	double chirp_error(double t, std::span<const double> x)
+	{
+		return std::abs(x[0] - std::sin(t * t));
+	}
+
+	int report(bool pass, const char* what, double value)
+	{
+		std::printf("%s %-48s %.3e\n", pass ? "ok  " : "FAIL", what, value);
+		return pass ? 0 : 1;
+	}
+
+	template <class Error>
+	double max_error(const Trajectory& trajectory, Error&& error)
+	{
+		double worst = 0.0;
+		for (std::size_t k = 0; k < trajectory.num_times(); ++k)
+		{
+			worst = std::max(worst, error(trajectory.time(k), trajectory.row(k).span()));
+		}
+		return worst;
+	}
+}
+
+int main()
+{
+	int failures = 0;
+
+	// Ten periods of the oscillator: the step ends with both substep sequences,
+	// and a 7.3 Hz output clock off the step ends, within a small multiple of
+	// the tolerance
+	for (double tol : { 1e-6, 1e-9, 1e-12 })
+	{
+		StepSizeControl control;
+		control.abs_tol = { tol };
+		control.rel_tol = { tol };
+
+		GraggBulirschStoerStepper stepper(oscillator, 2, control, false);
+		Trajectory steps = integrate_adaptive(stepper, 0.0, { 1.0, 0.0 }, TF_S);
+		double step_error = max_error(steps, oscillator_error);
+
+		GraggBulirschStoerStepper dense_stepper(oscillator, 2, control, true);
+		Trajectory dense_steps = integrate_adaptive(dense_stepper, 0.0, { 1.0, 0.0 }, TF_S);
+		double dense_step_error = max_error(dense_steps, oscillator_error);
+
+		GraggBulirschStoerStepper sampled_stepper(oscillator, 2, control, true);
+		Trajectory sampled = integrate_adaptive_sampled(sampled_stepper, 0.0, { 1.0, 0.0 }, sample_times(0.0, TF_S, 7.3));
+		double dense_error = max_error(sampled, oscillator_error);
+
+		bool counted = stepper.accepted_steps() + 1 == steps.num_times() && steps.time(steps.num_times() - 1) == TF_S;
+
+		std::printf("     tol %.0e: %zu accepted, %zu rejected, %zu RHS evaluations, order %zu (dense: %zu, %zu, %zu)\n", tol,
+			stepper.accepted_steps(), stepper.rejected_steps(), stepper.rhs_evals(), stepper.order(),
+			dense_stepper.accepted_steps(), dense_stepper.rejected_steps(), dense_stepper.rhs_evals());
+		failures += report(step_error <= 50.0 * tol, "GBS oscillator step-end error / tol", step_error / tol);
+		failures += report(dense_step_error <= 50.0 * tol, "GBS dense oscillator step-end error / tol", dense_step_error / tol);
+		failures += report(dense_error <= 50.0 * tol, "GBS oscillator 7.3 Hz dense-output error / tol", dense_error / tol);
+		failures += report(counted, "GBS counters consistent with the steps", 0.0);
+		failures += report(sampled_stepper.rhs_evals() == dense_stepper.rhs_evals(), "dense output costs no RHS evaluations", 0.0);
+	}
+
+	// 1 / (1 + t^2) over [0, 5] at 1e-10: few long steps of high order, and
+	// an interpolant no worse between the ends than at them
+	{
+		StepSizeControl control;
+		control.abs_tol = { 1e-10 };
+		control.rel_tol = { 1e-10 };
+
+		GraggBulirschStoerStepper stepper(rational, 1, control, true);
+		Trajectory steps = integrate_adaptive(stepper, 0.0, { 1.0 }, 5.0);
+		double step_error = max_error(steps, rational_error);
+
+		GraggBulirschStoerStepper sampled_stepper(rational, 1, control, true);
+		Trajectory sampled = integrate_adaptive_sampled(sampled_stepper, 0.0, { 1.0 }, sample_times(0.0, 5.0, 100.0));
+		double dense_error = max_error(sampled, rational_error);
+
+		std::printf("     1 / (1 + t^2): %zu accepted, %zu rejected, %zu RHS evaluations\n",
+			stepper.accepted_steps(), stepper.rejected_steps(), stepper.rhs_evals());
+		failures += report(step_error <= 1e-8, "GBS 1 / (1 + t^2) step-end error", step_error);
+		failures += report(dense_error <= std::max(10.0 * step_error, 1e-9), "GBS 1 / (1 + t^2) 100 Hz dense-output error", dense_error);
+		failures += report(stepper.order() >= 8, "GBS order at tol 1e-10", static_cast<double>(stepper.order()));
+	}
+
+	// The chirp over [0, 10] at 1e-6 sampled at 100 Hz: without the ERRINT
+	// rejection the interpolant is off by 0.38 between step ends that are
+	// within 2e-6. ERRINT estimates from the last term only, so it is not
+	// held to the tolerance itself.
+	{
+		StepSizeControl control;
+		control.abs_tol = { 1e-6 };
+		control.rel_tol = { 1e-6 };
+
+		GraggBulirschStoerStepper stepper(chirp, 1, control, true);
+		Trajectory sampled = integrate_adaptive_sampled(stepper, 0.0, { 0.0 }, sample_times(0.0, 10.0, 100.0));
+		double dense_error = max_error(sampled, chirp_error);
+
+		std::printf("     sin(t^2): %zu accepted, %zu rejected, %zu RHS evaluations\n",
+			stepper.accepted_steps(), stepper.rejected_steps(), stepper.rhs_evals());
+		failures += report(stepper.rejected_steps() > 0, "GBS rejects steps on the interpolation error", static_cast<double>(stepper.rejected_steps()));
+		failures += report(dense_error <= 2e-5, "GBS sin(t^2) 100 Hz dense-output error", dense_error);
+	}
+
+	// Without dense output there is nothing to interpolate
+	{
+		GraggBulirschStoerStepper stepper(oscillator, 2, StepSizeControl(), false);
+		std::vector<double> x = { 1.0, 0.0 };
+		double h = stepper.step(0.0, x, 1.0);
+		bool threw = false;
+		try
+		{
+			stepper.interpolate(0.5 * h, x);
+		}
+		catch (const std::logic_error&)
+		{
+			threw = true;
+		}
+		failures += report(threw, "GBS without dense output refuses interpolate()", 0.0);
+	}
+
+	return failures == 0 ? 0 : 1;
+}
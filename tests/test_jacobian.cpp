@@ -0,0 +1,110 @@
+// Checks flat_earth_jacobian against central differences of
+// flat_earth_eom_inplace, all 144 entries, on random states of every preset and
+// of a brick with every aero and inertia term switched on
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "flat_earth_eom.h"
+#include "flat_earth_jacobian.h"
+#include "test_states.h"
+
+namespace
+{
+	constexpr std::size_t STATES_PER_VEHICLE = 25;
+
+	// Central-difference df/dx, row-major like flat_earth_jacobian
+	std::array<double, 144> central_difference_jacobian(const std::array<double, 12>& x, const VehicleParams& vehicle)
+	{
+		std::array<double, 144> J{};
+		std::array<double, 12> x_plus = x, x_minus = x, dx_plus, dx_minus;
+
+		for (std::size_t j = 0; j < 12; ++j)
+		{
+			// cbrt(eps) scaled to the state balances truncation against rounding
+			double delta = 6e-6 * std::max(1.0, std::abs(x[j]));
+			x_plus[j] = x[j] + delta;
+			x_minus[j] = x[j] - delta;
+
+			flat_earth_eom_inplace(0.0, x_plus, vehicle, dx_plus);
+			flat_earth_eom_inplace(0.0, x_minus, vehicle, dx_minus);
+			for (std::size_t i = 0; i < 12; ++i)
+			{
+				J[12 * i + j] = (dx_plus[i] - dx_minus[i]) / (x_plus[j] - x_minus[j]);
+			}
+
+			x_plus[j] = x[j];
+			x_minus[j] = x[j];
+		}
+		return J;
+	}
+}
+
+int main()
+{
+	std::vector<std::pair<const char*, VehicleParams>> vehicles;
+	const char* names[] = { "Musketball50cal", "Carronade12lb", "BlueBerry", "Bowlingball", "TsarCannonball",
+		"NASA_Atmos01_Sphere", "NASA_Atmos02_Brick", "NASA_Atmos03_Brick" };
+	for (std::size_t k = 0; k < NUM_TEST_PRESETS; ++k)
+	{
+		vehicles.emplace_back(names[k], makeVehicle(TEST_PRESETS[k]));
+	}
+
+	// The presets leave Jxz, Clr, Cnp and (on the bricks) drag at zero
+	VehicleParams all_terms = makeVehicle(VehiclePreset::NASA_Atmos03_Brick);
+	all_terms.CD_approx = 0.8;
+	all_terms.Jxz_b_kgm2 = 0.1 * all_terms.Jxx_b_kgm2;
+	all_terms.Clr = 0.3;
+	all_terms.Cnp = -0.2;
+	compileVehicle(all_terms);
+	vehicles.emplace_back("Atmos03, all terms", all_terms);
+
+	std::mt19937_64 rng(20240612);
+	int failures = 0;
+
+	for (const auto& [name, vehicle] : vehicles)
+	{
+		// Each entry's difference relative to its own size, floored at 1e-3 of
+		// the row's largest entry: the central difference error follows the
+		// size of the terms that cancel in a small entry, not the entry itself
+		double max_error = 0.0;
+		double max_rhs_error = 0.0;
+
+		for (std::size_t k = 0; k < STATES_PER_VEHICLE; ++k)
+		{
+			const std::array<double, 12> x = random_flight_state(rng);
+
+			std::array<double, 12> dx, dx_eom;
+			std::array<double, 144> J;
+			flat_earth_jacobian(0.0, x, vehicle, dx, J);
+			flat_earth_eom_inplace(0.0, x, vehicle, dx_eom);
+			const std::array<double, 144> J_fd = central_difference_jacobian(x, vehicle);
+
+			for (std::size_t i = 0; i < 12; ++i)
+			{
+				max_rhs_error = std::max(max_rhs_error, std::abs(dx[i] - dx_eom[i]) / (1.0 + std::abs(dx_eom[i])));
+
+				double row_scale = 0.0;
+				for (std::size_t j = 0; j < 12; ++j)
+				{
+					row_scale = std::max(row_scale, std::abs(J_fd[12 * i + j]));
+				}
+				for (std::size_t j = 0; j < 12; ++j)
+				{
+					double scale = std::max({ std::abs(J_fd[12 * i + j]), 1e-3 * row_scale, 1e-12 });
+					double error = std::abs(J[12 * i + j] - J_fd[12 * i + j]) / scale;
+					max_error = std::max(max_error, std::isnan(error) ? INFINITY : error);
+				}
+			}
+		}
+
+		bool pass = max_error <= 1e-6 && max_rhs_error <= 1e-12;
+		std::printf("%s %-20s df/dx error %.1e, RHS error %.1e\n", pass ? "ok  " : "FAIL", name, max_error, max_rhs_error);
+		failures += pass ? 0 : 1;
+	}
+
+	return failures == 0 ? 0 : 1;
+}
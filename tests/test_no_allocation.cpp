@@ -0,0 +1,127 @@
+// Checks that the in-place EoM and a stepper built once allocate nothing per step
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "flat_earth_eom.h"
+#include "flat_earth_eom_kernel.h"
+#include "flat_earth_ensemble.h"
+#include "numerical_integration_methods.h"
+#include "ussa1976.h"
+
+namespace
+{
+	std::size_t allocations = 0;
+
+	void* counted_alloc(std::size_t size)
+	{
+		++allocations;
+		if (void* p = std::malloc(size == 0 ? 1 : size))
+		{
+			return p;
+		}
+		throw std::bad_alloc();
+	}
+
+	void* counted_aligned_alloc(std::size_t size, std::align_val_t align)
+	{
+		++allocations;
+		std::size_t alignment = static_cast<std::size_t>(align);
+		if (void* p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+		{
+			return p;
+		}
+		throw std::bad_alloc();
+	}
+}
+
+// Every heap allocation in the program goes through these
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return counted_aligned_alloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return counted_aligned_alloc(size, align); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace
+{
+	constexpr std::size_t NUM_STEPS = 10000;
+	constexpr double H_S = 0.001;
+
+	int report(const char* loop, std::size_t count)
+	{
+		std::printf("%-40s %zu allocations in %zu steps\n", loop, count, NUM_STEPS);
+		return count == 0 ? 0 : 1;
+	}
+}
+
+int main()
+{
+	const VehicleParams vehicle = makeVehicle(VehiclePreset::NASA_Atmos03_Brick);
+	const std::array<double, 12> x0 = check_case_initial_state(VehiclePreset::NASA_Atmos03_Brick);
+	int failures = 0;
+
+	// Stepper built and state allocated before counting starts
+	{
+		RK4Stepper stepper(FlatEarthRhs<>{ vehicle }, 12);
+		std::array<double, 12> x = x0;
+
+		std::size_t before = allocations;
+		for (std::size_t i = 0; i < NUM_STEPS; ++i)
+		{
+			stepper.step(static_cast<double>(i) * H_S, x, H_S);
+		}
+		failures += report("RK4Stepper(FlatEarthRhs<>)", allocations - before);
+	}
+
+	// Forward Euler on the typed kernel
+	{
+		std::array<double, 12> x = x0;
+		std::array<double, 12> dx{};
+
+		std::size_t before = allocations;
+		for (std::size_t i = 0; i < NUM_STEPS; ++i)
+		{
+			flat_earth_eom_inplace(static_cast<double>(i) * H_S, x, vehicle, dx);
+			for (std::size_t j = 0; j < 12; ++j)
+			{
+				x[j] += H_S * dx[j];
+			}
+		}
+		failures += report("flat_earth_eom_inplace(VehicleParams)", allocations - before);
+	}
+
+	// Forward Euler on the map kernel
+	{
+		const std::unordered_map<std::string, double> amod = makeVehicleModel(VehiclePreset::NASA_Atmos03_Brick);
+		const std::unordered_map<std::string, double> atmosphere = computeProperties(-x0[11]);
+		const std::unordered_map<std::string, double> airmod = { {"alt_m", -x0[11]}, {"rho_kgpm3", atmosphere.at("air_density")},
+			{"c_mps", atmosphere.at("speed_of_sound")}, {"g_mps2", 9.81} };
+		std::array<double, 12> x = x0;
+		std::array<double, 12> dx{};
+
+		std::size_t before = allocations;
+		for (std::size_t i = 0; i < NUM_STEPS; ++i)
+		{
+			flat_earth_eom_inplace(static_cast<double>(i) * H_S, x, amod, airmod, dx);
+			for (std::size_t j = 0; j < 12; ++j)
+			{
+				x[j] += H_S * dx[j];
+			}
+		}
+		failures += report("flat_earth_eom_inplace(amod, airmod)", allocations - before);
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// Checks the dual-number partials of propagate_sensitivities against
+// differences of the same RK4 run, for every parameter on the Atmos01 sphere
+// and the Atmos03 brick
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+#include <vector>
+#include "flat_earth_ensemble.h"
+#include "sensitivity.h"
+
+namespace
+{
+	constexpr double H_S = 0.01;
+	constexpr double TF_S = 5.0;
+	constexpr double TOLERANCE = 1e-7;
+
+	constexpr std::array<SensitivityParameter, 19> PARAMETERS = {
+		SensitivityParameter::CD_approx, SensitivityParameter::Clp, SensitivityParameter::Clr, SensitivityParameter::Cmq,
+		SensitivityParameter::Cnp, SensitivityParameter::Cnr, SensitivityParameter::m_kg,
+		SensitivityParameter::u0, SensitivityParameter::v0, SensitivityParameter::w0,
+		SensitivityParameter::p0, SensitivityParameter::q0, SensitivityParameter::r0,
+		SensitivityParameter::phi0, SensitivityParameter::theta0, SensitivityParameter::psi0,
+		SensitivityParameter::p10, SensitivityParameter::p20, SensitivityParameter::p30
+	};
+
+	// The value a parameter perturbs, in the vehicle or the initial state
+	double& parameter_value(SensitivityParameter parameter, VehicleParams& vehicle, std::array<double, 12>& x0)
+	{
+		switch (parameter)
+		{
+		case SensitivityParameter::CD_approx: return vehicle.CD_approx;
+		case SensitivityParameter::Clp: return vehicle.Clp;
+		case SensitivityParameter::Clr: return vehicle.Clr;
+		case SensitivityParameter::Cmq: return vehicle.Cmq;
+		case SensitivityParameter::Cnp: return vehicle.Cnp;
+		case SensitivityParameter::Cnr: return vehicle.Cnr;
+		case SensitivityParameter::m_kg: return vehicle.m_kg;
+		default:
+			return x0[static_cast<std::size_t>(parameter) - static_cast<std::size_t>(SensitivityParameter::u0)];
+		}
+	}
+
+	// State values of the run with one parameter moved by offset; the seeded
+	// direction does not change them
+	std::vector<SensitivityState<1>> run_with_offset(const VehicleParams& base, std::array<double, 12> x0, SensitivityParameter parameter,
+		double offset, const std::vector<double>& t_s)
+	{
+		VehicleParams vehicle = base;
+		parameter_value(parameter, vehicle, x0) += offset;
+		compileVehicle(vehicle);
+		return propagate_sensitivities<1>(vehicle, x0, { SensitivityParameter::u0 }, t_s, H_S);
+	}
+}
+
+int main()
+{
+	std::vector<double> t_s;
+	for (std::size_t n = 0; n <= static_cast<std::size_t>(std::lround(TF_S / H_S)); ++n)
+	{
+		t_s.push_back(static_cast<double>(n) * H_S);
+	}
+
+	const std::pair<const char*, VehiclePreset> cases[] = {
+		{ "NASA_Atmos01_Sphere", VehiclePreset::NASA_Atmos01_Sphere },
+		{ "NASA_Atmos03_Brick", VehiclePreset::NASA_Atmos03_Brick }
+	};
+	int failures = 0;
+
+	for (const auto& [name, preset] : cases)
+	{
+		const VehicleParams vehicle = makeVehicle(preset);
+		// Thrown at 20 m/s: the check cases start at rest, where the airspeed
+		// has no derivative and differences straddle the kink
+		std::array<double, 12> x0 = check_case_initial_state(preset);
+		x0[0] += 20.0;
+		const std::vector<SensitivityState<PARAMETERS.size()>> dual = propagate_sensitivities(vehicle, x0, PARAMETERS, t_s, H_S);
+
+		// The altitude of several km sets the rounding noise of every difference
+		double state_size = 1.0;
+		for (const SensitivityState<PARAMETERS.size()>& x : dual)
+		{
+			for (const SensitivityScalar<PARAMETERS.size()>& xi : x)
+			{
+				state_size = std::max(state_size, std::abs(xi.v));
+			}
+		}
+
+		double max_error = 0.0;
+		for (std::size_t k = 0; k < PARAMETERS.size(); ++k)
+		{
+			VehicleParams probe_vehicle = vehicle;
+			std::array<double, 12> probe_x0 = x0;
+			double delta = 1e-3 * std::max(1.0, std::abs(parameter_value(PARAMETERS[k], probe_vehicle, probe_x0)));
+			double noise = 1e2 * DBL_EPSILON * state_size / delta;
+
+			const std::vector<SensitivityState<1>> plus = run_with_offset(vehicle, x0, PARAMETERS[k], delta, t_s);
+			const std::vector<SensitivityState<1>> minus = run_with_offset(vehicle, x0, PARAMETERS[k], -delta, t_s);
+			const std::vector<SensitivityState<1>> plus2 = run_with_offset(vehicle, x0, PARAMETERS[k], 2.0 * delta, t_s);
+			const std::vector<SensitivityState<1>> minus2 = run_with_offset(vehicle, x0, PARAMETERS[k], -2.0 * delta, t_s);
+
+			// Fourth-order central difference, so delta can be large enough to
+			// keep rounding small. Each partial is compared with its largest
+			// value over the run, floored where the rounding noise of the
+			// difference reaches the tolerance.
+			for (std::size_t i = 0; i < 12; ++i)
+			{
+				double partial_scale = noise / TOLERANCE;
+				double difference = 0.0;
+				for (std::size_t n = 0; n < t_s.size(); ++n)
+				{
+					double fd = (8.0 * (plus[n][i].v - minus[n][i].v) - (plus2[n][i].v - minus2[n][i].v)) / (12.0 * delta);
+					partial_scale = std::max(partial_scale, std::abs(fd));
+					difference = std::max(difference, std::abs(dual[n][i].d[k] - fd));
+				}
+				max_error = std::max(max_error, std::isnan(difference) ? INFINITY : difference / partial_scale);
+			}
+		}
+
+		bool pass = max_error <= TOLERANCE;
+		std::printf("%s %-20s partial error %.1e over %zu parameters\n", pass ? "ok  " : "FAIL", name, max_error, PARAMETERS.size());
+		failures += pass ? 0 : 1;
+	}
+
+	return failures == 0 ? 0 : 1;
+}
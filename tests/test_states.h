@@ -0,0 +1,41 @@
+#pragma once
+#ifndef TEST_STATES_H
+#define TEST_STATES_H
+
+#include <array>
+#include <cstddef>
+#include <random>
+#include "spheres.h"
+
+// Shared inputs of the EoM tests
+
+constexpr VehiclePreset TEST_PRESETS[] = {
+	VehiclePreset::Musketball50cal,
+	VehiclePreset::Carronade12lb,
+	VehiclePreset::BlueBerry,
+	VehiclePreset::Bowlingball,
+	VehiclePreset::TsarCannonball,
+	VehiclePreset::NASA_Atmos01_Sphere,
+	VehiclePreset::NASA_Atmos02_Brick,
+	VehiclePreset::NASA_Atmos03_Brick
+};
+
+constexpr std::size_t NUM_TEST_PRESETS = sizeof(TEST_PRESETS) / sizeof(TEST_PRESETS[0]);
+
+// Random 12-state flight condition: up to 300 m/s, 2 rev/s, pitch within 80 deg
+// of level, altitude between sea level and 19 km (inside the two USSA1976
+// layers computeAtmosphere differentiates)
+inline std::array<double, 12> random_flight_state(std::mt19937_64& rng)
+{
+	std::uniform_real_distribution<double> velocity(-300.0, 300.0);
+	std::uniform_real_distribution<double> rate(-12.0, 12.0);
+	std::uniform_real_distribution<double> angle(-3.14, 3.14);
+	std::uniform_real_distribution<double> pitch(-1.4, 1.4);
+	std::uniform_real_distribution<double> position(-1000.0, 1000.0);
+	std::uniform_real_distribution<double> altitude(0.0, 19000.0);
+
+	return { velocity(rng), velocity(rng), velocity(rng), rate(rng), rate(rng), rate(rng),
+		angle(rng), pitch(rng), angle(rng), position(rng), position(rng), -altitude(rng) };
+}
+
+#endif // TEST_STATES_H
@@ -0,0 +1,168 @@
+// Round trips through the Gorilla and QuantizedDelta block codecs: block
+// sizes around the 64-value groups, bit-exact special values, the
+// QuantizedDelta error bound and the inputs the encoders refuse
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "trajectory_codec.h"
+
+namespace
+{
+	// 0, 1, 2: the values written in full; 65, 66, 67: one group of second
+	// differences starts at value 2, so these end just before, on and after
+	// the first group boundary
+	constexpr std::size_t SIZES[] = { 0, 1, 2, 3, 64, 65, 66, 67, 130, 131, 1000 };
+
+	int report(bool pass, const char* what, std::size_t size, double value)
+	{
+		if (!pass)
+		{
+			std::printf("FAIL %-40s n = %-5zu %.3e\n", what, size, value);
+		}
+		return pass ? 0 : 1;
+	}
+
+	// A smooth channel with integrator-like noise in the low bits
+	std::vector<double> smooth_values(std::size_t n, std::mt19937_64& rng)
+	{
+		std::uniform_real_distribution<double> noise(-1e-12, 1e-12);
+		std::vector<double> values(n);
+		for (std::size_t k = 0; k < n; ++k)
+		{
+			double t = 0.001 * static_cast<double>(k);
+			values[k] = 9144.0 - 4.9 * t * t + 30.0 * std::sin(3.0 * t) + noise(rng);
+		}
+		return values;
+	}
+
+	bool same_bits(const std::vector<double>& a, const std::vector<double>& b)
+	{
+		return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+			[](double x, double y) { return std::bit_cast<std::uint64_t>(x) == std::bit_cast<std::uint64_t>(y); });
+	}
+
+	std::vector<double> gorilla_roundtrip(const std::vector<double>& values)
+	{
+		std::vector<std::byte> block;
+		gorilla_encode(values, block);
+		std::vector<double> decoded(values.size());
+		gorilla_decode(block, decoded);
+		return decoded;
+	}
+
+	// Largest |decoded - value| less the half ulp of value the rounding adds
+	double quantized_excess(const std::vector<double>& values, double max_error)
+	{
+		std::vector<std::byte> block;
+		quantized_delta_encode(values, max_error, block);
+		std::vector<double> decoded(values.size());
+		quantized_delta_decode(block, max_error, decoded);
+
+		double excess = -INFINITY;
+		for (std::size_t k = 0; k < values.size(); ++k)
+		{
+			double half_ulp = 0.5 * (std::nextafter(std::abs(values[k]), INFINITY) - std::abs(values[k]));
+			excess = std::max(excess, std::abs(decoded[k] - values[k]) - max_error - half_ulp);
+		}
+		return values.empty() ? 0.0 : excess;
+	}
+
+	template <class F>
+	bool throws_invalid_argument(F&& f)
+	{
+		try
+		{
+			f();
+		}
+		catch (const std::invalid_argument&)
+		{
+			return true;
+		}
+		return false;
+	}
+}
+
+int main()
+{
+	std::mt19937_64 rng(20240917);
+	int failures = 0;
+
+	for (std::size_t n : SIZES)
+	{
+		std::vector<double> smooth = smooth_values(n, rng);
+
+		// Random bit patterns: every control code and window width
+		std::vector<double> random(n);
+		for (double& value : random)
+		{
+			value = std::bit_cast<double>(rng() & 0xffefffffffffffffull);  // no NaN or Inf exponents
+		}
+
+		failures += report(same_bits(gorilla_roundtrip(smooth), smooth), "Gorilla smooth", n, 0.0);
+		failures += report(same_bits(gorilla_roundtrip(random), random), "Gorilla random bits", n, 0.0);
+
+		for (double max_error : { 1e-9, 1e-6, 1e-3, 0.5 })
+		{
+			double excess = quantized_excess(smooth, max_error);
+			failures += report(excess <= 0.0, "QuantizedDelta |error| <= max_error", n, excess);
+		}
+
+		// Wide second differences, so the 64-value groups need many bits
+		std::uniform_real_distribution<double> wide(-1e6, 1e6);
+		std::vector<double> rough(n);
+		for (double& value : rough)
+		{
+			value = wide(rng);
+		}
+		double excess = quantized_excess(rough, 1e-3);
+		failures += report(excess <= 0.0, "QuantizedDelta rough |error| <= max_error", n, excess);
+
+		// None copies the doubles through encode_block / decode_block
+		std::vector<std::byte> block;
+		encode_block(ColumnCodec::None, smooth, 0.0, block);
+		std::vector<double> decoded(n);
+		decode_block(ColumnCodec::None, block, 0.0, decoded);
+		failures += report(same_bits(decoded, smooth), "None", n, 0.0);
+	}
+
+	// Special values keep their bits, in the middle of a smooth run and back to back
+	{
+		const double nan_payload = std::bit_cast<double>(0x7ff8dead0000beefull);
+		std::vector<double> special = { 1.0, 2.0, 3.0, -0.0, 0.0, -0.0, std::numeric_limits<double>::quiet_NaN(), nan_payload,
+			4.0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), 5.0, 1e300, -1e300, 1e300,
+			std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::max(), 6.0, 7.0, 8.0 };
+		failures += report(same_bits(gorilla_roundtrip(special), special), "Gorilla -0.0, NaN, Inf, 1e300", special.size(), 0.0);
+
+		std::vector<double> nans(70, nan_payload);
+		failures += report(same_bits(gorilla_roundtrip(nans), nans), "Gorilla NaN run", nans.size(), 0.0);
+	}
+
+	// The encoders refuse what they cannot bound
+	{
+		std::vector<double> values = smooth_values(100, rng);
+		std::vector<std::byte> block;
+
+		for (double bad : { std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() })
+		{
+			std::vector<double> with_bad = values;
+			with_bad[50] = bad;
+			failures += report(throws_invalid_argument([&] { quantized_delta_encode(with_bad, 1e-6, block); }), "QuantizedDelta throws on non-finite", 100, bad);
+		}
+		for (double max_error : { 0.0, -1e-6, std::numeric_limits<double>::quiet_NaN() })
+		{
+			failures += report(throws_invalid_argument([&] { quantized_delta_encode(values, max_error, block); }), "QuantizedDelta throws on max_error <= 0", 100, max_error);
+		}
+		failures += report(throws_invalid_argument([&] { quantized_delta_encode(values, 1e-300, block); }), "QuantizedDelta throws past 52 bits", 100, 1e-300);
+	}
+
+	std::printf("%s trajectory codec round trips, block sizes 0 to 1000\n", failures == 0 ? "ok  " : "FAIL");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+// Round trips through TrajectoryFileWriter and TrajectoryFileReader: a
+// streamed file of several chunks with a partial last one, a float32
+// channel, stored sample times from write_trajectory_file, reads that cross
+// chunks, and version 2 files with Gorilla and QuantizedDelta channels
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "trajectory_file.h"
+
+namespace
+{
+	constexpr const char* PATH = "test_trajectory_file.fetraj";
+	constexpr std::size_t CHUNK_SAMPLES = 1000;
+	constexpr double MAX_ERROR = 1e-6;
+
+	int report(bool pass, const char* what, double value)
+	{
+		std::printf("%s %-52s %.3e\n", pass ? "ok  " : "FAIL", what, value);
+		return pass ? 0 : 1;
+	}
+
+	// Sample k of channel j: smooth, with every mantissa bit in use
+	double value(std::size_t k, std::size_t j)
+	{
+		double t = 0.01 * static_cast<double>(k);
+		return 100.0 * std::sin(t + static_cast<double>(j)) + std::exp(0.1 * t) / 3.0;
+	}
+
+	bool same_bits(double a, double b)
+	{
+		return std::bit_cast<std::uint64_t>(a) == std::bit_cast<std::uint64_t>(b);
+	}
+
+	template <class E, class F>
+	bool throws(F&& f)
+	{
+		try
+		{
+			f();
+		}
+		catch (const E&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	// Largest |read - expected| of channel j over samples [first, first + count),
+	// where expected(k) is what the channel should hold
+	template <class F>
+	double read_error(const TrajectoryFileReader& reader, std::size_t j, std::size_t first, std::size_t count, F&& expected)
+	{
+		std::vector<double> out(count);
+		reader.read(j, first, out);
+		double error = 0.0;
+		for (std::size_t k = 0; k < count; ++k)
+		{
+			double e = expected(first + k);
+			error = std::max(error, same_bits(out[k], e) ? 0.0 : std::abs(out[k] - e));
+		}
+		return error;
+	}
+}
+
+int main()
+{
+	int failures = 0;
+
+	// Streamed through the observer at a fixed step: 2500 samples are two full
+	// chunks and a half one, 3000 end on a chunk boundary
+	for (std::size_t num_samples : { std::size_t(2500), std::size_t(3000) })
+	{
+		const std::vector<ChannelSpec> channels = {
+			{ "a", "m", ColumnType::Float64 },
+			{ "b", "m/s", ColumnType::Float32 }
+		};
+		TrajectoryFileOptions options;
+		options.t0_s = 1.5;
+		options.dt_s = 0.01;
+		options.chunk_samples = CHUNK_SAMPLES;
+
+		std::size_t written = 0;
+		{
+			TrajectoryFileWriter writer(PATH, channels, options);
+			for (std::size_t k = 0; k < num_samples; ++k)
+			{
+				double x[] = { value(k, 0), value(k, 1) };
+				writer(options.t0_s + static_cast<double>(k) * options.dt_s, x);
+			}
+			written = writer.samples_written();
+			writer.close();
+		}
+
+		TrajectoryFileReader reader(PATH);
+		std::size_t chunks = (num_samples + CHUNK_SAMPLES - 1) / CHUNK_SAMPLES;
+		std::printf("     %zu samples in %zu chunks of %zu\n", num_samples, reader.num_chunks(), reader.chunk_samples());
+		failures += report(written == num_samples && reader.num_samples() == num_samples && reader.num_chunks() == chunks
+			&& reader.chunk_samples() == CHUNK_SAMPLES && reader.num_channels() == 2, "v1 streamed: sample and chunk counts", 0.0);
+		failures += report(reader.find_channel("b") == 1 && reader.channel_spec(1).units == "m/s" && reader.channel_spec(1).type == ColumnType::Float32,
+			"v1 streamed: channel table", 0.0);
+		failures += report(reader.t0_s() == options.t0_s && reader.dt_s() == options.dt_s
+			&& reader.time(num_samples - 1) == options.t0_s + static_cast<double>(num_samples - 1) * options.dt_s, "v1 streamed: t0 + k * dt", 0.0);
+
+		// Every column straight from the mapping, the last one short
+		bool columns_match = true;
+		for (std::size_t c = 0; c < reader.num_chunks(); ++c)
+		{
+			std::span<const double> a = reader.column<double>(0, c);
+			std::span<const float> b = reader.column<float>(1, c);
+			columns_match = columns_match && a.size() == std::min(CHUNK_SAMPLES, num_samples - c * CHUNK_SAMPLES) && b.size() == a.size();
+			for (std::size_t k = 0; k < a.size() && columns_match; ++k)
+			{
+				std::size_t n = c * CHUNK_SAMPLES + k;
+				columns_match = same_bits(a[k], value(n, 0)) && b[k] == static_cast<float>(value(n, 1));
+			}
+		}
+		failures += report(columns_match, "v1 streamed: column<T>(j, c) bit for bit", 0.0);
+
+		// From inside the first chunk to inside the last
+		std::size_t first = CHUNK_SAMPLES - 100;
+		std::size_t count = num_samples - first - 10;
+		failures += report(read_error(reader, 0, first, count, [](std::size_t k) { return value(k, 0); }) == 0.0,
+			"v1 streamed: float64 read() across chunks", 0.0);
+		failures += report(read_error(reader, 1, first, count, [](std::size_t k) { return static_cast<double>(static_cast<float>(value(k, 1))); }) == 0.0,
+			"v1 streamed: float32 read() across chunks, widened", 0.0);
+
+		std::vector<double> past(11);
+		failures += report(throws<std::out_of_range>([&] { reader.read(0, num_samples - 10, past); }), "v1 streamed: read() past the end throws", 0.0);
+		failures += report(throws<std::logic_error>([&] { reader.channel(0); }), "v1 streamed: channel() of a chunked file throws", 0.0);
+		failures += report(throws<std::invalid_argument>([&] { reader.column<double>(1, 0); }), "v1 streamed: column<double> of float32 throws", 0.0);
+	}
+
+	// A finished run at irregular times: one chunk and a "t_s" channel
+	{
+		constexpr std::size_t NUM_SAMPLES = 777;
+		Trajectory trajectory(12, 0);
+		double t = 0.25;
+		for (std::size_t k = 0; k < NUM_SAMPLES; ++k)
+		{
+			double x[12];
+			for (std::size_t j = 0; j < 12; ++j)
+			{
+				x[j] = value(k, j);
+			}
+			trajectory.append(t, x);
+			t += 0.001 * (1.0 + static_cast<double>(k % 7));
+		}
+		write_trajectory_file(PATH, trajectory, flat_earth_state_channels());
+
+		TrajectoryFileReader reader(PATH);
+		failures += report(reader.num_chunks() == 1 && reader.num_samples() == NUM_SAMPLES && reader.num_channels() == 13
+			&& reader.dt_s() == 0.0 && reader.t0_s() == trajectory.time(0), "write_trajectory_file: one chunk, dt_s = 0", 0.0);
+		failures += report(reader.find_channel("t_s") == 0 && reader.channel_spec(0).units == "s", "write_trajectory_file: t_s is channel 0", 0.0);
+
+		bool match = true;
+		std::span<const double> times = reader.channel(0);
+		for (std::size_t k = 0; k < NUM_SAMPLES; ++k)
+		{
+			match = match && same_bits(reader.time(k), trajectory.time(k)) && same_bits(times[k], trajectory.time(k));
+		}
+		for (std::size_t j = 0; j < 12; ++j)
+		{
+			std::span<const double> column = reader.channel(j + 1);
+			for (std::size_t k = 0; k < NUM_SAMPLES; ++k)
+			{
+				match = match && same_bits(column[k], trajectory(k, j));
+			}
+		}
+		failures += report(match, "write_trajectory_file: times and states bit for bit", 0.0);
+	}
+
+	// Version 2: a compressed file streamed in chunks with stored times, raw
+	// float64 and float32 columns next to Gorilla and QuantizedDelta blocks
+	{
+		constexpr std::size_t NUM_SAMPLES = 2345;
+		const std::vector<ChannelSpec> channels = {
+			{ "raw", "m", ColumnType::Float64 },
+			{ "single", "deg", ColumnType::Float32 },
+			{ "gorilla", "m/s", ColumnType::Float64, ColumnCodec::Gorilla },
+			{ "quantized", "rad", ColumnType::Float64, ColumnCodec::QuantizedDelta, MAX_ERROR }
+		};
+		TrajectoryFileOptions options;
+		options.chunk_samples = CHUNK_SAMPLES;
+
+		auto time = [](std::size_t k) { return 0.002 * static_cast<double>(k) + 1e-5 * static_cast<double>(k % 3); };
+		Trajectory trajectory(channels.size(), 0);
+		for (std::size_t k = 0; k < NUM_SAMPLES; ++k)
+		{
+			double x[] = { value(k, 0), value(k, 1), value(k, 2), value(k, 3) };
+			trajectory.append(time(k), x);
+		}
+		{
+			TrajectoryFileWriter writer(PATH, channels, options);
+			writer.write(trajectory);
+			writer.close();
+		}
+
+		TrajectoryFileReader reader(PATH);
+		failures += report(reader.num_samples() == NUM_SAMPLES && reader.num_chunks() == 3 && reader.num_channels() == 5,
+			"v2: sample and chunk counts", 0.0);
+		failures += report(reader.channel_spec(3).codec == ColumnCodec::Gorilla && reader.channel_spec(4).codec == ColumnCodec::QuantizedDelta
+			&& reader.channel_spec(4).max_error == MAX_ERROR && reader.channel_spec(0).codec == ColumnCodec::None, "v2: codecs in the channel table", 0.0);
+
+		bool times_match = true;
+		for (std::size_t k = 0; k < NUM_SAMPLES; ++k)
+		{
+			times_match = times_match && same_bits(reader.time(k), time(k));
+		}
+		failures += report(times_match && reader.column<double>(0, 2).size() == NUM_SAMPLES - 2 * CHUNK_SAMPLES,
+			"v2: t_s stays raw, time(k) bit for bit", 0.0);
+		failures += report(throws<std::invalid_argument>([&] { reader.column<double>(3, 0); }), "v2: column() of a compressed channel throws", 0.0);
+
+		std::size_t first = 500;
+		std::size_t count = NUM_SAMPLES - first - 5;
+		failures += report(read_error(reader, 1, first, count, [](std::size_t k) { return value(k, 0); }) == 0.0,
+			"v2: raw float64 read() across chunks", 0.0);
+		failures += report(read_error(reader, 2, first, count, [](std::size_t k) { return static_cast<double>(static_cast<float>(value(k, 1))); }) == 0.0,
+			"v2: raw float32 read() across chunks, widened", 0.0);
+		failures += report(read_error(reader, 3, first, count, [](std::size_t k) { return value(k, 2); }) == 0.0,
+			"v2: Gorilla read() across chunks bit for bit", 0.0);
+		double quantized_error = read_error(reader, 4, first, count, [](std::size_t k) { return value(k, 3); });
+		failures += report(quantized_error <= MAX_ERROR + 1e-12, "v2: QuantizedDelta read() error [rad]", quantized_error);
+
+		// decode_chunk gives the same values as read(), the last chunk short
+		std::vector<double> whole(NUM_SAMPLES);
+		reader.read(3, 0, whole);
+		bool chunks_match = true;
+		for (std::size_t c = 0; c < reader.num_chunks(); ++c)
+		{
+			std::vector<double> chunk(std::min(CHUNK_SAMPLES, NUM_SAMPLES - c * CHUNK_SAMPLES));
+			reader.decode_chunk(3, c, chunk);
+			chunks_match = chunks_match && std::equal(chunk.begin(), chunk.end(), whole.begin() + static_cast<std::ptrdiff_t>(c * CHUNK_SAMPLES), same_bits);
+		}
+		failures += report(chunks_match, "v2: decode_chunk() per chunk, partial last", 0.0);
+	}
+
+	std::remove(PATH);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(std::size_t num_threads)
+{
+	/*  Arguments:
+
+		num_threads - threads taking part in a loop, the caller included;
+		0 uses std::thread::hardware_concurrency() (at least 1)
+	*/
+
+	if (num_threads == 0)
+	{
+		num_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+	}
+
+	workers.reserve(num_threads - 1);
+	for (std::size_t i = 1; i < num_threads; ++i)
+	{
+		workers.emplace_back([this] { worker_loop(); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	work_ready.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& task)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current_task = &task;
+		task_count = count;
+		next_index = 0;
+		tasks_finished = 0;
+		first_error = nullptr;
+		++generation;
+	}
+	work_ready.notify_all();
+
+	run_tasks();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	work_done.wait(lock, [this] { return tasks_finished == task_count; });
+	current_task = nullptr;
+
+	if (first_error)
+	{
+		std::exception_ptr error = first_error;
+		first_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void ThreadPool::worker_loop()
+{
+	std::size_t seen_generation = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			work_ready.wait(lock, [&] { return stopping || generation != seen_generation; });
+			if (stopping)
+			{
+				return;
+			}
+			seen_generation = generation;
+		}
+
+		run_tasks();
+	}
+}
+
+void ThreadPool::run_tasks()
+{
+	// Take indices until the loop is exhausted; tasks run outside the lock
+	for (;;)
+	{
+		std::size_t i;
+		const std::function<void(std::size_t)>* task;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (current_task == nullptr || next_index >= task_count)
+			{
+				return;
+			}
+			i = next_index++;
+			task = current_task;
+		}
+
+		std::exception_ptr error;
+		try
+		{
+			(*task)(i);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (error && !first_error)
+			{
+				first_error = error;
+			}
+			last = ++tasks_finished == task_count;
+		}
+		if (last)
+		{
+			work_done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for fork-join loops (the Parareal fine sweeps).
+// Workers are started once and sleep between loops, so a loop costs a wake-up
+// rather than a thread creation. The calling thread takes part in every loop,
+// so a pool of size 1 has no workers and runs everything inline.
+class ThreadPool
+{
+public:
+	// num_threads counts the caller; 0 means std::thread::hardware_concurrency()
+	explicit ThreadPool(std::size_t num_threads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	std::size_t size() const { return workers.size() + 1; }
+
+	// Runs task(i) for every i in [0, count) across the pool and returns when all
+	// are done. Indices are handed out one at a time, so tasks of uneven length
+	// balance themselves. The first exception thrown by a task is rethrown here
+	// after the loop drains.
+	void parallel_for(std::size_t count, const std::function<void(std::size_t)>& task);
+
+private:
+	void worker_loop();
+	void run_tasks();
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable work_ready;
+	std::condition_variable work_done;
+
+	// Current loop, guarded by mutex
+	const std::function<void(std::size_t)>* current_task = nullptr;
+	std::size_t task_count = 0;
+	std::size_t next_index = 0;
+	std::size_t tasks_finished = 0;
+	std::size_t generation = 0;
+	std::exception_ptr first_error;
+	bool stopping = false;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,354 @@
+#pragma once
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/*  Trajectory storage.
+
+	The solution of nx states at nt times lives in one 64-byte aligned block,
+	in either of two layouts:
+
+		TimeMajor     (AoS) x(k, j) at [k * nx + j]. The state at one time is
+		              contiguous, which is what a stepper advances in place.
+		ChannelMajor  (SoA) x(k, j) at [j * ld + k]. One state over time is
+		              contiguous, which is what plotting and post-processing
+		              read. ld rounds the capacity up to whole 64-byte lines,
+		              so every channel starts on a line.
+
+	row(k) (the state at time k) and channel(j) (state j over time) are views
+	into the block: contiguous in the layout that favours them, strided in the
+	other, never a copy. with_layout() transposes into a new Trajectory once,
+	e.g. integrate in TimeMajor and post-process in ChannelMajor.
+
+	The times sit in the same block, ahead of the states.
+*/
+
+enum class TrajectoryLayout
+{
+	TimeMajor,      // AoS: x(k, j) at [k * nx + j]
+	ChannelMajor    // SoA: x(k, j) at [j * ld + k]
+};
+
+// Non-owning view of size elements spaced stride apart; stride 1 is a span
+template <class T>
+class StridedView
+{
+public:
+	using value_type = std::remove_cv_t<T>;
+
+	class iterator
+	{
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = std::remove_cv_t<T>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T*;
+		using reference = T&;
+
+		iterator() = default;
+		iterator(T* p, std::ptrdiff_t stride) : p(p), stride(stride) {}
+
+		T& operator*() const { return *p; }
+		T* operator->() const { return p; }
+		T& operator[](std::ptrdiff_t i) const { return p[i * stride]; }
+
+		iterator& operator++() { p += stride; return *this; }
+		iterator operator++(int) { iterator it = *this; p += stride; return it; }
+		iterator& operator--() { p -= stride; return *this; }
+		iterator operator--(int) { iterator it = *this; p -= stride; return it; }
+		iterator& operator+=(std::ptrdiff_t n) { p += n * stride; return *this; }
+		iterator& operator-=(std::ptrdiff_t n) { p -= n * stride; return *this; }
+
+		friend iterator operator+(iterator it, std::ptrdiff_t n) { return it += n; }
+		friend iterator operator+(std::ptrdiff_t n, iterator it) { return it += n; }
+		friend iterator operator-(iterator it, std::ptrdiff_t n) { return it -= n; }
+		friend std::ptrdiff_t operator-(const iterator& a, const iterator& b) { return (a.p - b.p) / a.stride; }
+		friend bool operator==(const iterator& a, const iterator& b) { return a.p == b.p; }
+		friend auto operator<=>(const iterator& a, const iterator& b) { return a.p <=> b.p; }
+
+	private:
+		T* p = nullptr;
+		std::ptrdiff_t stride = 1;
+	};
+
+	StridedView() = default;
+	StridedView(T* data, std::size_t size, std::size_t stride) : first(data), count(size), step(stride) {}
+
+	// Spans (and StridedView<double> -> StridedView<const double>) convert implicitly
+	template <class U> requires std::is_convertible_v<U (*)[], T (*)[]>
+	StridedView(std::span<U> values) : first(values.data()), count(values.size()), step(1) {}
+
+	template <class U> requires (!std::is_same_v<U, T> && std::is_convertible_v<U (*)[], T (*)[]>)
+	StridedView(StridedView<U> other) : first(other.data()), count(other.size()), step(other.stride()) {}
+
+	T* data() const { return first; }
+	std::size_t size() const { return count; }
+	std::size_t stride() const { return step; }
+	bool empty() const { return count == 0; }
+	bool contiguous() const { return step == 1 || count <= 1; }
+
+	T& operator[](std::size_t i) const { return first[i * step]; }
+
+	iterator begin() const { return iterator(first, static_cast<std::ptrdiff_t>(step)); }
+	iterator end() const { return iterator(first + count * step, static_cast<std::ptrdiff_t>(step)); }
+
+	// The view as a span; only for a contiguous view
+	std::span<T> span() const
+	{
+		if (!contiguous())
+		{
+			throw std::logic_error("StridedView: a strided view is not a span");
+		}
+		return std::span<T>(first, count);
+	}
+
+	void copy_to(std::span<value_type> out) const
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			out[i] = first[i * step];
+		}
+	}
+
+	std::vector<value_type> to_vector() const { return std::vector<value_type>(begin(), end()); }
+
+private:
+	T* first = nullptr;
+	std::size_t count = 0;
+	std::size_t step = 1;
+};
+
+
+class Trajectory
+{
+public:
+	static constexpr std::size_t ALIGNMENT_BYTES = 64;
+
+	Trajectory() = default;
+
+	// num_times points, times and states zeroed
+	Trajectory(std::size_t num_states, std::size_t num_times, TrajectoryLayout layout = TrajectoryLayout::TimeMajor)
+		: nx(num_states), storage_layout(layout)
+	{
+		allocate(num_times);
+		nt = num_times;
+	}
+
+	// One point per entry of t_s, states zeroed
+	Trajectory(std::size_t num_states, const std::vector<double>& t_s, TrajectoryLayout layout = TrajectoryLayout::TimeMajor)
+		: Trajectory(num_states, t_s.size(), layout)
+	{
+		std::copy(t_s.begin(), t_s.end(), t_data);
+	}
+
+	Trajectory(const Trajectory& other) : nx(other.nx), storage_layout(other.storage_layout)
+	{
+		allocate(other.nt);
+		nt = other.nt;
+		copy_points(other);
+	}
+
+	Trajectory& operator=(const Trajectory& other)
+	{
+		if (this != &other)
+		{
+			Trajectory copy(other);
+			swap(copy);
+		}
+		return *this;
+	}
+
+	Trajectory(Trajectory&& other) noexcept { swap(other); }
+	Trajectory& operator=(Trajectory&& other) noexcept { swap(other); return *this; }
+
+	void swap(Trajectory& other) noexcept
+	{
+		std::swap(nx, other.nx);
+		std::swap(nt, other.nt);
+		std::swap(cap, other.cap);
+		std::swap(ld, other.ld);
+		std::swap(storage_layout, other.storage_layout);
+		std::swap(block, other.block);
+		std::swap(t_data, other.t_data);
+		std::swap(x_data, other.x_data);
+	}
+
+	std::size_t num_states() const { return nx; }
+	std::size_t num_times() const { return nt; }
+	std::size_t capacity() const { return cap; }
+	TrajectoryLayout layout() const { return storage_layout; }
+
+	double& time(std::size_t k) { return t_data[k]; }
+	double time(std::size_t k) const { return t_data[k]; }
+	std::span<double> times() { return std::span<double>(t_data, nt); }
+	std::span<const double> times() const { return std::span<const double>(t_data, nt); }
+
+	// State j at time k
+	double& operator()(std::size_t k, std::size_t j) { return x_data[offset(k, j)]; }
+	double operator()(std::size_t k, std::size_t j) const { return x_data[offset(k, j)]; }
+
+	// The state at time k; contiguous in TimeMajor
+	StridedView<double> row(std::size_t k) { return StridedView<double>(x_data + offset(k, 0), nx, state_stride()); }
+	StridedView<const double> row(std::size_t k) const { return StridedView<const double>(x_data + offset(k, 0), nx, state_stride()); }
+
+	// State j over time; contiguous in ChannelMajor
+	StridedView<double> channel(std::size_t j) { return StridedView<double>(x_data + offset(0, j), nt, time_stride()); }
+	StridedView<const double> channel(std::size_t j) const { return StridedView<const double>(x_data + offset(0, j), nt, time_stride()); }
+
+	// Distance in doubles between neighbouring states of one time / times of one state
+	std::size_t state_stride() const { return storage_layout == TrajectoryLayout::TimeMajor ? 1 : ld; }
+	std::size_t time_stride() const { return storage_layout == TrajectoryLayout::TimeMajor ? nx : 1; }
+
+	void set_row(std::size_t k, std::span<const double> x)
+	{
+		check_state_size(x.size());
+		StridedView<double> r = row(k);
+		for (std::size_t j = 0; j < nx; ++j)
+		{
+			r[j] = x[j];
+		}
+	}
+
+	// Adds a point at the end, growing the block geometrically like std::vector
+	void append(double t, std::span<const double> x)
+	{
+		check_state_size(x.size());
+		if (nt == cap)
+		{
+			reserve(std::max<std::size_t>(2 * cap, 64));
+		}
+		t_data[nt] = t;
+		++nt;
+		set_row(nt - 1, x);
+	}
+
+	void reserve(std::size_t num_times)
+	{
+		if (num_times <= cap)
+		{
+			return;
+		}
+
+		Trajectory grown;
+		grown.nx = nx;
+		grown.storage_layout = storage_layout;
+		grown.allocate(num_times);
+		grown.nt = nt;
+		grown.copy_points(*this);
+		swap(grown);
+	}
+
+	// Copy in the given layout, with capacity trimmed to num_times()
+	Trajectory with_layout(TrajectoryLayout layout) const
+	{
+		Trajectory out(nx, nt, layout);
+		out.copy_points(*this);
+		return out;
+	}
+
+private:
+	struct AlignedDelete
+	{
+		void operator()(double* p) const { ::operator delete[](p, std::align_val_t(ALIGNMENT_BYTES)); }
+	};
+
+	static constexpr std::size_t LINE_DOUBLES = ALIGNMENT_BYTES / sizeof(double);
+
+	static std::size_t round_to_line(std::size_t n) { return (n + LINE_DOUBLES - 1) / LINE_DOUBLES * LINE_DOUBLES; }
+
+	std::size_t offset(std::size_t k, std::size_t j) const
+	{
+		return storage_layout == TrajectoryLayout::TimeMajor ? k * nx + j : j * ld + k;
+	}
+
+	void check_state_size(std::size_t size) const
+	{
+		if (size != nx)
+		{
+			throw std::invalid_argument("Trajectory: state size does not match num_states()");
+		}
+	}
+
+	// Zeroed block for num_times points: the times, then the states from the next line
+	void allocate(std::size_t num_times)
+	{
+		std::size_t t_size = round_to_line(num_times);
+		ld = round_to_line(num_times);
+		std::size_t x_size = storage_layout == TrajectoryLayout::TimeMajor ? num_times * nx : nx * ld;
+		std::size_t total = std::max<std::size_t>(1, t_size + x_size);
+
+		block.reset(static_cast<double*>(::operator new[](total * sizeof(double), std::align_val_t(ALIGNMENT_BYTES))));
+		std::fill(block.get(), block.get() + total, 0.0);
+
+		cap = num_times;
+		t_data = block.get();
+		x_data = block.get() + t_size;
+	}
+
+	// Times and states of the first nt points of other, in this layout
+	void copy_points(const Trajectory& other)
+	{
+		std::copy(other.t_data, other.t_data + nt, t_data);
+
+		if (storage_layout == other.storage_layout && storage_layout == TrajectoryLayout::TimeMajor)
+		{
+			std::copy(other.x_data, other.x_data + nt * nx, x_data);
+		}
+		else if (storage_layout == other.storage_layout)
+		{
+			for (std::size_t j = 0; j < nx; ++j)
+			{
+				std::copy(other.x_data + j * other.ld, other.x_data + j * other.ld + nt, x_data + j * ld);
+			}
+		}
+		else
+		{
+			// Transpose in blocks of times, so the time-major side of a block
+			// stays in L1 while each channel of it is read or written
+			constexpr std::size_t block_times = 64;
+			const double* src = other.x_data;
+			bool to_time_major = storage_layout == TrajectoryLayout::TimeMajor;
+			std::size_t channel_stride = to_time_major ? other.ld : ld;
+
+			for (std::size_t k0 = 0; k0 < nt; k0 += block_times)
+			{
+				std::size_t k1 = std::min(nt, k0 + block_times);
+				for (std::size_t j = 0; j < nx; ++j)
+				{
+					for (std::size_t k = k0; k < k1; ++k)
+					{
+						if (to_time_major)
+						{
+							x_data[k * nx + j] = src[j * channel_stride + k];
+						}
+						else
+						{
+							x_data[j * channel_stride + k] = src[k * nx + j];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	std::size_t nx = 0;
+	std::size_t nt = 0;
+	std::size_t cap = 0;
+	std::size_t ld = 0;   // channel stride of ChannelMajor
+	TrajectoryLayout storage_layout = TrajectoryLayout::TimeMajor;
+	std::unique_ptr<double[], AlignedDelete> block;
+	double* t_data = nullptr;
+	double* x_data = nullptr;
+};
+
+#endif // TRAJECTORY_H
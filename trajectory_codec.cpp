@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "trajectory_codec.h"
+
+namespace
+{
+	constexpr std::size_t PADDING_BYTES = 16;
+	constexpr std::size_t GROUP = 64;
+	constexpr double MAX_QUANTA = 4503599627370496.0;  // 2^52
+
+	// LSB-first bit packing into whole 64-bit words
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<std::byte>& out) : out(out) {}
+
+		// Low n bits of bits, n <= 64
+		void put(std::uint64_t bits, unsigned n)
+		{
+			if (n < 64)
+			{
+				bits &= (std::uint64_t{ 1 } << n) - 1;
+			}
+			acc |= bits << filled;
+			if (filled + n >= 64)
+			{
+				flush_word();
+				unsigned used = 64 - filled;
+				acc = used == 64 ? 0 : bits >> used;
+				filled = filled + n - 64;
+			}
+			else
+			{
+				filled += n;
+			}
+		}
+
+		void finish()
+		{
+			std::size_t bytes = (filled + 7) / 8;
+			std::size_t size = out.size();
+			out.resize(size + bytes + PADDING_BYTES);
+			std::memcpy(out.data() + size, &acc, bytes);
+			std::fill(out.begin() + static_cast<std::ptrdiff_t>(size + bytes), out.end(), std::byte{ 0 });
+		}
+
+	private:
+		void flush_word()
+		{
+			std::size_t size = out.size();
+			out.resize(size + 8);
+			std::memcpy(out.data() + size, &acc, 8);
+		}
+
+		std::vector<std::byte>& out;
+		std::uint64_t acc = 0;
+		unsigned filled = 0;
+	};
+
+	class BitReader
+	{
+	public:
+		explicit BitReader(std::span<const std::byte> block) : p(block.data()), limit(block.size() > PADDING_BYTES ? 8 * (block.size() - PADDING_BYTES) : 0)
+		{
+			if (block.size() < PADDING_BYTES)
+			{
+				throw std::invalid_argument("trajectory codec: block too short");
+			}
+		}
+
+		// Next n bits, n <= 64
+		std::uint64_t get(unsigned n)
+		{
+			if (pos + n > limit)
+			{
+				throw std::invalid_argument("trajectory codec: block ends before its values");
+			}
+
+			std::size_t byte = pos >> 3;
+			unsigned shift = pos & 7;
+			std::uint64_t word;
+			std::memcpy(&word, p + byte, 8);
+			std::uint64_t v = word >> shift;
+			if (shift + n > 64)
+			{
+				std::uint64_t next;
+				std::memcpy(&next, p + byte + 8, 8);
+				v |= next << (64 - shift);
+			}
+			pos += n;
+			return n == 64 ? v : v & ((std::uint64_t{ 1 } << n) - 1);
+		}
+
+		bool bit() { return get(1) != 0; }
+
+	private:
+		const std::byte* p;
+		std::size_t limit;
+		std::size_t pos = 0;
+	};
+
+	std::uint64_t zigzag(std::int64_t v)
+	{
+		return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+	}
+
+	std::int64_t unzigzag(std::uint64_t v)
+	{
+		return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+	}
+
+	// Extrapolation of the next value from the last two; no multiply, so no FMA
+	double predict(double previous, double before)
+	{
+		return previous + (previous - before);
+	}
+}
+
+void gorilla_encode(std::span<const double> values, std::vector<std::byte>& out)
+{
+	BitWriter writer(out);
+	if (values.empty())
+	{
+		writer.finish();
+		return;
+	}
+
+	writer.put(std::bit_cast<std::uint64_t>(values[0]), 64);
+
+	// No window until the first full control code
+	unsigned window_leading = 65;
+	unsigned window_trailing = 0;
+	double previous = values[0];
+	double before = values[0];
+
+	for (std::size_t k = 1; k < values.size(); ++k)
+	{
+		double prediction = k == 1 ? previous : predict(previous, before);
+		std::uint64_t x = std::bit_cast<std::uint64_t>(values[k]) ^ std::bit_cast<std::uint64_t>(prediction);
+
+		if (x == 0)
+		{
+			writer.put(0, 1);
+		}
+		else
+		{
+			unsigned leading = std::min<unsigned>(static_cast<unsigned>(std::countl_zero(x)), 31);
+			unsigned trailing = static_cast<unsigned>(std::countr_zero(x));
+
+			if (window_leading <= leading && window_trailing <= trailing)
+			{
+				// '10': the meaningful bits fit the previous window
+				writer.put(0b01, 2);
+				writer.put(x >> window_trailing, 64 - window_leading - window_trailing);
+			}
+			else
+			{
+				// '11': new window, 5 bits of leading zeros, 6 of length (0 means 64)
+				unsigned length = 64 - leading - trailing;
+				writer.put(0b11, 2);
+				writer.put(leading, 5);
+				writer.put(length & 63, 6);
+				writer.put(x >> trailing, length);
+				window_leading = leading;
+				window_trailing = trailing;
+			}
+		}
+
+		before = previous;
+		previous = values[k];
+	}
+
+	writer.finish();
+}
+
+void gorilla_decode(std::span<const std::byte> block, std::span<double> out)
+{
+	if (out.empty())
+	{
+		return;
+	}
+
+	BitReader reader(block);
+	double previous = std::bit_cast<double>(reader.get(64));
+	double before = previous;
+	out[0] = previous;
+
+	unsigned window_leading = 0;
+	unsigned window_trailing = 0;
+
+	for (std::size_t k = 1; k < out.size(); ++k)
+	{
+		double prediction = k == 1 ? previous : predict(previous, before);
+		std::uint64_t x = 0;
+
+		if (reader.bit())
+		{
+			if (reader.bit())
+			{
+				window_leading = static_cast<unsigned>(reader.get(5));
+				unsigned length = static_cast<unsigned>(reader.get(6));
+				length = length == 0 ? 64 : length;
+				window_trailing = 64 - window_leading - length;
+			}
+			x = reader.get(64 - window_leading - window_trailing) << window_trailing;
+		}
+
+		before = previous;
+		previous = std::bit_cast<double>(std::bit_cast<std::uint64_t>(prediction) ^ x);
+		out[k] = previous;
+	}
+}
+
+void quantized_delta_encode(std::span<const double> values, double max_error, std::vector<std::byte>& out)
+{
+	if (!(max_error > 0.0))
+	{
+		throw std::invalid_argument("quantized_delta_encode: max_error must be positive");
+	}
+
+	double inv_step = 0.5 / max_error;
+	std::vector<std::int64_t> q(values.size());
+	for (std::size_t k = 0; k < values.size(); ++k)
+	{
+		double scaled = std::nearbyint(values[k] * inv_step);
+		if (!(std::abs(scaled) <= MAX_QUANTA))
+		{
+			throw std::invalid_argument("quantized_delta_encode: value not finite or too large for max_error");
+		}
+		q[k] = static_cast<std::int64_t>(scaled);
+	}
+
+	BitWriter writer(out);
+	if (!q.empty())
+	{
+		writer.put(zigzag(q[0]), 64);
+	}
+	if (q.size() > 1)
+	{
+		writer.put(zigzag(q[1] - q[0]), 64);
+	}
+
+	// Second differences, bit packed per group at the group's widest value
+	std::uint64_t group[GROUP];
+	for (std::size_t first = 2; first < q.size(); first += GROUP)
+	{
+		std::size_t count = std::min(GROUP, q.size() - first);
+		std::uint64_t any = 0;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			std::size_t k = first + i;
+			group[i] = zigzag((q[k] - q[k - 1]) - (q[k - 1] - q[k - 2]));
+			any |= group[i];
+		}
+
+		unsigned width = 64 - static_cast<unsigned>(std::countl_zero(any));
+		writer.put(width, 7);
+		if (width == 0)
+		{
+			continue;
+		}
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			writer.put(group[i], width);
+		}
+	}
+
+	writer.finish();
+}
+
+void quantized_delta_decode(std::span<const std::byte> block, double max_error, std::span<double> out)
+{
+	if (out.empty())
+	{
+		return;
+	}
+
+	double step = 2.0 * max_error;
+	BitReader reader(block);
+
+	std::int64_t q = unzigzag(reader.get(64));
+	out[0] = static_cast<double>(q) * step;
+	if (out.size() == 1)
+	{
+		return;
+	}
+
+	std::int64_t delta = unzigzag(reader.get(64));
+	q += delta;
+	out[1] = static_cast<double>(q) * step;
+
+	for (std::size_t first = 2; first < out.size(); first += GROUP)
+	{
+		std::size_t count = std::min(GROUP, out.size() - first);
+		unsigned width = static_cast<unsigned>(reader.get(7));
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			delta += width == 0 ? 0 : unzigzag(reader.get(width));
+			q += delta;
+			out[first + i] = static_cast<double>(q) * step;
+		}
+	}
+}
+
+void encode_block(ColumnCodec codec, std::span<const double> values, double max_error, std::vector<std::byte>& out)
+{
+	switch (codec)
+	{
+	case ColumnCodec::None:
+	{
+		std::size_t size = out.size();
+		out.resize(size + values.size_bytes());
+		std::memcpy(out.data() + size, values.data(), values.size_bytes());
+		return;
+	}
+	case ColumnCodec::Gorilla:
+		gorilla_encode(values, out);
+		return;
+	case ColumnCodec::QuantizedDelta:
+		quantized_delta_encode(values, max_error, out);
+		return;
+	}
+	throw std::invalid_argument("encode_block: unknown codec");
+}
+
+void decode_block(ColumnCodec codec, std::span<const std::byte> block, double max_error, std::span<double> out)
+{
+	switch (codec)
+	{
+	case ColumnCodec::None:
+		if (block.size() < out.size_bytes())
+		{
+			throw std::invalid_argument("decode_block: raw block shorter than its values");
+		}
+		std::memcpy(out.data(), block.data(), out.size_bytes());
+		return;
+	case ColumnCodec::Gorilla:
+		gorilla_decode(block, out);
+		return;
+	case ColumnCodec::QuantizedDelta:
+		quantized_delta_decode(block, max_error, out);
+		return;
+	}
+	throw std::invalid_argument("decode_block: unknown codec");
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef TRAJECTORY_CODEC_H
+#define TRAJECTORY_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/*  Block codecs for one channel of a trajectory.
+
+	Gorilla (lossless): every value is XORed with a prediction and only the
+	meaningful bits of the XOR are written, after a control code that reuses
+	the previous leading/trailing zero window when it still fits (Pelkonen et
+	al., "Gorilla", VLDB 2015). The prediction is the linear extrapolation
+	x[k-1] + (x[k-1] - x[k-2]) rather than Gorilla's x[k-1], which on the
+	RK4 check cases at 1 ms raises the ratio from 1.08-3.3 to 1.24-3.6. It is
+	computed without a multiply, so no FMA contraction can make encoder and
+	decoder disagree. Integrator output carries noise in the low mantissa
+	bits, so expect little from lossless coding of fast-moving states.
+
+	QuantizedDelta (bounded error): values are rounded to integers
+	q = round(x / (2 max_error)), so |x - decoded| <= max_error (plus half an
+	ulp of x). q[0] and q[1] - q[0] are written in full, then the second
+	differences are zigzag coded and bit packed in groups of 64 at the width of
+	the group's largest value. A smooth channel has second differences of a few
+	quanta, so a value costs a few bits.
+
+	Encoders append one block to out; the block carries no length, so the
+	decoder is told how many values it holds. Blocks end with 16 bytes of
+	padding so the bit reader can load whole words.
+*/
+
+enum class ColumnCodec : std::uint16_t
+{
+	None = 0,
+	Gorilla = 1,
+	QuantizedDelta = 2
+};
+
+void gorilla_encode(std::span<const double> values, std::vector<std::byte>& out);
+void gorilla_decode(std::span<const std::byte> block, std::span<double> out);
+
+// Throws std::invalid_argument for a non-finite value, or for max_error so
+// small against the values that q would need more than 52 bits
+void quantized_delta_encode(std::span<const double> values, double max_error, std::vector<std::byte>& out);
+void quantized_delta_decode(std::span<const std::byte> block, double max_error, std::span<double> out);
+
+// Either codec by id; None appends or copies the raw doubles
+void encode_block(ColumnCodec codec, std::span<const double> values, double max_error, std::vector<std::byte>& out);
+void decode_block(ColumnCodec codec, std::span<const std::byte> block, double max_error, std::span<double> out);
+
+#endif // TRAJECTORY_CODEC_H
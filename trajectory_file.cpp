@@ -0,0 +1,667 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include "trajectory_file.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr char MAGIC[8] = { 'F', 'E', 'T', 'R', 'A', 'J', '\0', '\1' };
+	constexpr std::uint32_t VERSION_RAW = 1;
+	constexpr std::uint32_t VERSION_BLOCKS = 2;
+	constexpr std::size_t HEADER_BYTES = 64;
+	constexpr std::size_t CHANNEL_BYTES = 64;
+	constexpr std::size_t NAME_BYTES = 40;
+	constexpr std::size_t UNITS_BYTES = 12;
+	constexpr std::uint64_t COLUMN_ALIGNMENT = 64;
+	constexpr std::uint64_t DATA_ALIGNMENT = 4096;
+	constexpr std::size_t INDEX_ENTRY_BYTES = 16;
+
+	static_assert(std::endian::native == std::endian::little, "trajectory files are little-endian; add byte swapping for this target");
+
+	std::uint64_t round_up(std::uint64_t n, std::uint64_t alignment)
+	{
+		return (n + alignment - 1) / alignment * alignment;
+	}
+
+	std::size_t type_size(ColumnType type)
+	{
+		switch (type)
+		{
+		case ColumnType::Float64:
+			return sizeof(double);
+		case ColumnType::Float32:
+			return sizeof(float);
+		}
+		throw std::invalid_argument("trajectory file: unknown column type");
+	}
+
+	template <class T>
+	void put(std::byte* p, T value)
+	{
+		std::memcpy(p, &value, sizeof(T));
+	}
+
+	template <class T>
+	T get(const std::byte* p)
+	{
+		T value;
+		std::memcpy(&value, p, sizeof(T));
+		return value;
+	}
+
+	// Column offsets within a chunk and the chunk size
+	std::uint64_t layout_columns(const std::vector<ChannelSpec>& columns, std::size_t chunk_samples, std::vector<std::uint64_t>& offsets)
+	{
+		std::uint64_t offset = 0;
+		offsets.clear();
+		for (const ChannelSpec& column : columns)
+		{
+			offsets.push_back(offset);
+			offset += round_up(static_cast<std::uint64_t>(chunk_samples) * type_size(column.type), COLUMN_ALIGNMENT);
+		}
+		return offset;
+	}
+}
+
+std::vector<ChannelSpec> flat_earth_state_channels(ColumnType type)
+{
+	return {
+		{ "u_b_mps", "m/s", type },
+		{ "v_b_mps", "m/s", type },
+		{ "w_b_mps", "m/s", type },
+		{ "p_b_rps", "rad/s", type },
+		{ "q_b_rps", "rad/s", type },
+		{ "r_b_rps", "rad/s", type },
+		{ "phi_rad", "rad", type },
+		{ "theta_rad", "rad", type },
+		{ "psi_rad", "rad", type },
+		{ "p1_n_m", "m", type },
+		{ "p2_n_m", "m", type },
+		{ "p3_n_m", "m", type }
+	};
+}
+
+TrajectoryFileWriter::TrajectoryFileWriter(const std::string& path, const std::vector<ChannelSpec>& channels, const TrajectoryFileOptions& options)
+	: out(path, std::ios::binary | std::ios::out | std::ios::trunc), path(path), options(options), chunk_samples(options.chunk_samples)
+{
+	/*  Arguments:
+
+		path - file to create (overwritten)
+
+		channels - name, units and column type of each value passed per sample
+
+		options - t0 and fixed output step (dt_s = 0 stores the times), and the
+		samples per chunk (0 writes one chunk on close)
+	*/
+
+	if (!out)
+	{
+		throw std::runtime_error("TrajectoryFileWriter: cannot open " + path);
+	}
+
+	if (options.dt_s == 0.0)
+	{
+		columns.push_back({ "t_s", "s", ColumnType::Float64 });
+	}
+	columns.insert(columns.end(), channels.begin(), channels.end());
+
+	for (const ChannelSpec& column : columns)
+	{
+		if (column.name.size() >= NAME_BYTES || column.units.size() >= UNITS_BYTES)
+		{
+			throw std::invalid_argument("TrajectoryFileWriter: channel name or units too long: " + column.name);
+		}
+		type_size(column.type);
+
+		if (column.codec != ColumnCodec::None)
+		{
+			if (column.type != ColumnType::Float64)
+			{
+				throw std::invalid_argument("TrajectoryFileWriter: compressed channels must be Float64: " + column.name);
+			}
+			if (column.codec == ColumnCodec::QuantizedDelta && !(column.max_error > 0.0))
+			{
+				throw std::invalid_argument("TrajectoryFileWriter: QuantizedDelta needs a positive max_error: " + column.name);
+			}
+			compressed = true;
+		}
+	}
+
+	data_offset = round_up(HEADER_BYTES + columns.size() * CHANNEL_BYTES, DATA_ALIGNMENT);
+	block_offset = data_offset;
+	chunk.resize(columns.size() * std::max<std::size_t>(chunk_samples, 1));
+
+	// Header now, patched with the final count and chunk size on close
+	write_header();
+}
+
+TrajectoryFileWriter::~TrajectoryFileWriter()
+{
+	try
+	{
+		close();
+	}
+	catch (...)
+	{
+		// A destructor cannot report the failure; call close() to see it
+	}
+}
+
+void TrajectoryFileWriter::operator()(double t, std::span<const double> x)
+{
+	std::size_t first_channel = options.dt_s == 0.0 ? 1 : 0;
+	if (closed)
+	{
+		throw std::logic_error("TrajectoryFileWriter: write after close");
+	}
+	if (x.size() + first_channel != columns.size())
+	{
+		throw std::invalid_argument("TrajectoryFileWriter: sample size does not match the channels");
+	}
+
+	// The whole run is buffered when it is written as a single chunk
+	if (chunk_samples == 0 && chunk_fill * columns.size() == chunk.size())
+	{
+		std::vector<double> grown(2 * chunk.size());
+		std::size_t old_capacity = chunk.size() / columns.size();
+		for (std::size_t c = 0; c < columns.size(); ++c)
+		{
+			std::copy_n(chunk.begin() + c * old_capacity, chunk_fill, grown.begin() + c * 2 * old_capacity);
+		}
+		chunk.swap(grown);
+	}
+
+	std::size_t capacity = chunk.size() / columns.size();
+	if (first_channel == 1)
+	{
+		chunk[chunk_fill] = t;
+	}
+	for (std::size_t j = 0; j < x.size(); ++j)
+	{
+		chunk[(first_channel + j) * capacity + chunk_fill] = x[j];
+	}
+	++chunk_fill;
+	++num_samples;
+
+	if (chunk_samples != 0 && chunk_fill == chunk_samples)
+	{
+		write_chunk();
+	}
+}
+
+void TrajectoryFileWriter::write(const Trajectory& trajectory)
+{
+	std::vector<double> x(trajectory.num_states());
+	for (std::size_t k = 0; k < trajectory.num_times(); ++k)
+	{
+		trajectory.row(k).copy_to(x);
+		(*this)(trajectory.time(k), x);
+	}
+}
+
+void TrajectoryFileWriter::close()
+{
+	if (closed)
+	{
+		return;
+	}
+	closed = true;
+
+	if (chunk_samples == 0)
+	{
+		// One chunk holding every sample
+		chunk_samples = std::max<std::size_t>(num_samples, 1);
+		if (chunk_fill > 0)
+		{
+			write_chunk();
+		}
+	}
+	else if (chunk_fill > 0)
+	{
+		write_chunk();
+	}
+
+	if (compressed)
+	{
+		out.seekp(static_cast<std::streamoff>(block_offset));
+		out.write(reinterpret_cast<const char*>(block_index.data()), static_cast<std::streamsize>(block_index.size() * sizeof(std::uint64_t)));
+	}
+
+	write_header();
+	out.close();
+	if (!out)
+	{
+		throw std::runtime_error("TrajectoryFileWriter: write failed for " + path);
+	}
+}
+
+void TrajectoryFileWriter::write_header()
+{
+	chunk_bytes = layout_columns(columns, std::max<std::size_t>(chunk_samples, 1), column_offsets);
+
+	std::vector<std::byte> header(data_offset);
+	std::memcpy(header.data(), MAGIC, sizeof(MAGIC));
+	put<std::uint32_t>(&header[8], compressed ? VERSION_BLOCKS : VERSION_RAW);
+	put<std::uint32_t>(&header[12], static_cast<std::uint32_t>(columns.size()));
+	put<std::uint64_t>(&header[16], num_samples);
+	put<std::uint64_t>(&header[24], std::max<std::size_t>(chunk_samples, 1));
+	put<std::uint64_t>(&header[32], data_offset);
+	put<double>(&header[40], options.t0_s);
+	put<double>(&header[48], options.dt_s);
+	put<std::uint64_t>(&header[56], compressed ? (closed ? block_offset : 0) : chunk_bytes);
+
+	for (std::size_t j = 0; j < columns.size(); ++j)
+	{
+		std::byte* record = &header[HEADER_BYTES + j * CHANNEL_BYTES];
+		std::memcpy(record, columns[j].name.data(), columns[j].name.size());
+		std::memcpy(record + NAME_BYTES, columns[j].units.data(), columns[j].units.size());
+		put<std::uint16_t>(record + NAME_BYTES + UNITS_BYTES, static_cast<std::uint16_t>(columns[j].type));
+		put<std::uint16_t>(record + NAME_BYTES + UNITS_BYTES + 2, static_cast<std::uint16_t>(columns[j].codec));
+		if (compressed)
+		{
+			put<double>(record + 56, columns[j].max_error);
+		}
+		else
+		{
+			put<std::uint64_t>(record + 56, column_offsets[j]);
+		}
+	}
+
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+}
+
+void TrajectoryFileWriter::write_chunk()
+{
+	if (compressed)
+	{
+		std::size_t capacity = chunk.size() / columns.size();
+		for (std::size_t j = 0; j < columns.size(); ++j)
+		{
+			write_block(j, std::span<const double>(chunk.data() + j * capacity, chunk_fill));
+		}
+		++num_written_chunks;
+		chunk_fill = 0;
+		return;
+	}
+
+	chunk_bytes = layout_columns(columns, chunk_samples, column_offsets);
+	column_bytes.assign(chunk_bytes, std::byte{ 0 });
+
+	std::size_t capacity = chunk.size() / columns.size();
+	for (std::size_t j = 0; j < columns.size(); ++j)
+	{
+		const double* values = chunk.data() + j * capacity;
+		std::byte* column = column_bytes.data() + column_offsets[j];
+		if (columns[j].type == ColumnType::Float64)
+		{
+			std::memcpy(column, values, chunk_fill * sizeof(double));
+		}
+		else
+		{
+			for (std::size_t k = 0; k < chunk_fill; ++k)
+			{
+				put<float>(column + k * sizeof(float), static_cast<float>(values[k]));
+			}
+		}
+	}
+
+	out.seekp(static_cast<std::streamoff>(data_offset + num_written_chunks * chunk_bytes));
+	out.write(reinterpret_cast<const char*>(column_bytes.data()), static_cast<std::streamsize>(column_bytes.size()));
+	if (!out)
+	{
+		throw std::runtime_error("TrajectoryFileWriter: write failed for " + path);
+	}
+
+	++num_written_chunks;
+	chunk_fill = 0;
+}
+
+void TrajectoryFileWriter::write_block(std::size_t j, std::span<const double> values)
+{
+	column_bytes.clear();
+	if (columns[j].type == ColumnType::Float32)
+	{
+		column_bytes.resize(values.size() * sizeof(float));
+		for (std::size_t k = 0; k < values.size(); ++k)
+		{
+			put<float>(column_bytes.data() + k * sizeof(float), static_cast<float>(values[k]));
+		}
+	}
+	else
+	{
+		encode_block(columns[j].codec, values, columns[j].max_error, column_bytes);
+	}
+
+	out.seekp(static_cast<std::streamoff>(block_offset));
+	out.write(reinterpret_cast<const char*>(column_bytes.data()), static_cast<std::streamsize>(column_bytes.size()));
+	if (!out)
+	{
+		throw std::runtime_error("TrajectoryFileWriter: write failed for " + path);
+	}
+
+	block_index.push_back(block_offset);
+	block_index.push_back(column_bytes.size());
+	block_offset = round_up(block_offset + column_bytes.size(), COLUMN_ALIGNMENT);
+}
+
+void write_trajectory_file(const std::string& path, const Trajectory& trajectory, const std::vector<ChannelSpec>& channels, double dt_s)
+{
+	/*  Arguments:
+
+		path - file to create (overwritten)
+
+		trajectory - samples to write; the first time becomes t0_s
+
+		channels - one per state of the trajectory
+
+		dt_s - fixed sample spacing [s]; 0 stores the trajectory times
+	*/
+
+	TrajectoryFileOptions options;
+	options.t0_s = trajectory.num_times() > 0 ? trajectory.time(0) : 0.0;
+	options.dt_s = dt_s;
+	options.chunk_samples = 0;
+
+	TrajectoryFileWriter writer(path, channels, options);
+	writer.write(trajectory);
+	writer.close();
+}
+
+TrajectoryFileReader::TrajectoryFileReader(const std::string& path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("TrajectoryFileReader: cannot open " + path);
+	}
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	mapped_size = static_cast<std::size_t>(size.QuadPart);
+
+	// The view keeps the mapping alive once both handles are closed
+	HANDLE mapping = mapped_size > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	if (mapping != nullptr)
+	{
+		mapped = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::runtime_error("TrajectoryFileReader: cannot open " + path);
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) == 0)
+	{
+		mapped_size = static_cast<std::size_t>(status.st_size);
+	}
+
+	// The mapping outlives the descriptor
+	if (mapped_size > 0)
+	{
+		void* p = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+		mapped = p == MAP_FAILED ? nullptr : static_cast<const std::byte*>(p);
+	}
+	::close(fd);
+#endif
+
+	if (mapped == nullptr)
+	{
+		throw std::runtime_error("TrajectoryFileReader: cannot map " + path);
+	}
+
+	try
+	{
+		parse_header(path);
+	}
+	catch (...)
+	{
+		unmap();
+		throw;
+	}
+}
+
+TrajectoryFileReader::~TrajectoryFileReader()
+{
+	unmap();
+}
+
+void TrajectoryFileReader::parse_header(const std::string& path)
+{
+	if (mapped_size < HEADER_BYTES || std::memcmp(mapped, MAGIC, sizeof(MAGIC)) != 0)
+	{
+		throw std::runtime_error("TrajectoryFileReader: not a trajectory file: " + path);
+	}
+	version = get<std::uint32_t>(mapped + 8);
+	if (version != VERSION_RAW && version != VERSION_BLOCKS)
+	{
+		throw std::runtime_error("TrajectoryFileReader: unsupported version in " + path);
+	}
+
+	std::size_t nc = get<std::uint32_t>(mapped + 12);
+	samples = static_cast<std::size_t>(get<std::uint64_t>(mapped + 16));
+	samples_per_chunk = static_cast<std::size_t>(get<std::uint64_t>(mapped + 24));
+	data_offset = get<std::uint64_t>(mapped + 32);
+	t0 = get<double>(mapped + 40);
+	dt = get<double>(mapped + 48);
+	if (version == VERSION_RAW)
+	{
+		chunk_bytes = get<std::uint64_t>(mapped + 56);
+	}
+	else
+	{
+		index_offset = get<std::uint64_t>(mapped + 56);
+	}
+
+	bool truncated = version == VERSION_RAW
+		? data_offset + num_chunks() * chunk_bytes > mapped_size
+		: index_offset < data_offset || index_offset + num_chunks() * nc * INDEX_ENTRY_BYTES > mapped_size;
+	if (samples_per_chunk == 0 || data_offset < HEADER_BYTES + nc * CHANNEL_BYTES || truncated)
+	{
+		throw std::runtime_error("TrajectoryFileReader: truncated or inconsistent file: " + path);
+	}
+
+	for (std::size_t j = 0; j < nc; ++j)
+	{
+		const std::byte* record = mapped + HEADER_BYTES + j * CHANNEL_BYTES;
+		const char* name = reinterpret_cast<const char*>(record);
+		const char* units = reinterpret_cast<const char*>(record + NAME_BYTES);
+
+		ChannelSpec spec;
+		spec.name.assign(name, std::find(name, name + NAME_BYTES, '\0'));
+		spec.units.assign(units, std::find(units, units + UNITS_BYTES, '\0'));
+		spec.type = static_cast<ColumnType>(get<std::uint16_t>(record + NAME_BYTES + UNITS_BYTES));
+		spec.codec = static_cast<ColumnCodec>(get<std::uint16_t>(record + NAME_BYTES + UNITS_BYTES + 2));
+		type_size(spec.type);
+
+		if (version == VERSION_RAW)
+		{
+			std::uint64_t offset = get<std::uint64_t>(record + 56);
+			if (spec.codec != ColumnCodec::None || offset + samples_per_chunk * type_size(spec.type) > chunk_bytes)
+			{
+				throw std::runtime_error("TrajectoryFileReader: column outside its chunk in " + path);
+			}
+			column_offsets.push_back(offset);
+		}
+		else
+		{
+			spec.max_error = get<double>(record + 56);
+			if (spec.codec > ColumnCodec::QuantizedDelta || (spec.codec != ColumnCodec::None && spec.type != ColumnType::Float64))
+			{
+				throw std::runtime_error("TrajectoryFileReader: unknown codec for channel " + spec.name + " in " + path);
+			}
+		}
+		channels.push_back(spec);
+	}
+
+	if (dt == 0.0 && (channels.empty() || channels[0].name != "t_s" || channels[0].type != ColumnType::Float64 || channels[0].codec != ColumnCodec::None))
+	{
+		throw std::runtime_error("TrajectoryFileReader: no fixed step and no t_s channel in " + path);
+	}
+}
+
+void TrajectoryFileReader::unmap()
+{
+	if (mapped == nullptr)
+	{
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(mapped);
+#else
+	munmap(const_cast<std::byte*>(mapped), mapped_size);
+#endif
+	mapped = nullptr;
+}
+
+std::size_t TrajectoryFileReader::find_channel(const std::string& name) const
+{
+	for (std::size_t j = 0; j < channels.size(); ++j)
+	{
+		if (channels[j].name == name)
+		{
+			return j;
+		}
+	}
+	throw std::out_of_range("TrajectoryFileReader: no channel named " + name);
+}
+
+double TrajectoryFileReader::time(std::size_t k) const
+{
+	if (dt != 0.0)
+	{
+		return t0 + static_cast<double>(k) * dt;
+	}
+	return column<double>(0, k / samples_per_chunk)[k % samples_per_chunk];
+}
+
+std::span<const double> TrajectoryFileReader::channel(std::size_t j) const
+{
+	if (num_chunks() > 1)
+	{
+		throw std::logic_error("TrajectoryFileReader: channel() needs a single-chunk file; use column() or read()");
+	}
+	return samples == 0 ? std::span<const double>() : column<double>(j, 0);
+}
+
+void TrajectoryFileReader::decode_chunk(std::size_t j, std::size_t c, std::span<double> out) const
+{
+	if (out.size() != chunk_length(c))
+	{
+		throw std::invalid_argument("TrajectoryFileReader: decode_chunk needs room for exactly one chunk");
+	}
+
+	if (channels.at(j).codec != ColumnCodec::None)
+	{
+		decode_block(channels[j].codec, block(j, c), channels[j].max_error, out);
+	}
+	else if (channels[j].type == ColumnType::Float64)
+	{
+		std::span<const double> values = column<double>(j, c);
+		std::copy(values.begin(), values.end(), out.begin());
+	}
+	else
+	{
+		std::span<const float> values = column<float>(j, c);
+		std::copy(values.begin(), values.end(), out.begin());
+	}
+}
+
+void TrajectoryFileReader::read(std::size_t j, std::size_t first, std::span<double> out) const
+{
+	if (first + out.size() > samples)
+	{
+		throw std::out_of_range("TrajectoryFileReader: read past the last sample");
+	}
+
+	std::vector<double> decoded;
+	std::size_t done = 0;
+	while (done < out.size())
+	{
+		std::size_t k = first + done;
+		std::size_t c = k / samples_per_chunk;
+		std::size_t begin = k % samples_per_chunk;
+		std::size_t count = std::min(out.size() - done, chunk_length(c) - begin);
+
+		if (channels.at(j).codec != ColumnCodec::None)
+		{
+			decoded.resize(chunk_length(c));
+			decode_chunk(j, c, decoded);
+			std::copy_n(decoded.begin() + begin, count, out.begin() + done);
+		}
+		else if (channels[j].type == ColumnType::Float64)
+		{
+			std::span<const double> values = column<double>(j, c);
+			std::copy_n(values.begin() + begin, count, out.begin() + done);
+		}
+		else
+		{
+			std::span<const float> values = column<float>(j, c);
+			std::copy_n(values.begin() + begin, count, out.begin() + done);
+		}
+		done += count;
+	}
+}
+
+std::span<const std::byte> TrajectoryFileReader::block(std::size_t j, std::size_t c) const
+{
+	if (c >= num_chunks() || j >= channels.size())
+	{
+		throw std::out_of_range("TrajectoryFileReader: block index past the last chunk or channel");
+	}
+
+	const std::byte* entry = mapped + index_offset + (c * channels.size() + j) * INDEX_ENTRY_BYTES;
+	std::uint64_t offset = get<std::uint64_t>(entry);
+	std::uint64_t bytes = get<std::uint64_t>(entry + 8);
+	if (offset < data_offset || offset + bytes > index_offset)
+	{
+		throw std::runtime_error("TrajectoryFileReader: block outside the data of the file");
+	}
+	return std::span<const std::byte>(mapped + offset, bytes);
+}
+
+const std::byte* TrajectoryFileReader::column_data(std::size_t j, std::size_t c) const
+{
+	if (c >= std::max<std::size_t>(num_chunks(), 1))
+	{
+		throw std::out_of_range("TrajectoryFileReader: chunk index past the last chunk");
+	}
+	if (version == VERSION_RAW)
+	{
+		return mapped + data_offset + c * chunk_bytes + column_offsets.at(j);
+	}
+	if (num_chunks() == 0)
+	{
+		return mapped + data_offset;
+	}
+
+	std::span<const std::byte> raw = block(j, c);
+	if (raw.size() < chunk_length(c) * type_size(channels[j].type))
+	{
+		throw std::runtime_error("TrajectoryFileReader: raw block shorter than its chunk");
+	}
+	return raw.data();
+}
+
+std::size_t TrajectoryFileReader::chunk_length(std::size_t c) const
+{
+	return std::min(samples_per_chunk, samples - std::min(samples, c * samples_per_chunk));
+}
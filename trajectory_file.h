@@ -0,0 +1,213 @@
+#pragma once
+#ifndef TRAJECTORY_FILE_H
+#define TRAJECTORY_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "trajectory.h"
+#include "trajectory_codec.h"
+
+/*  Columnar trajectory files (.fetraj), read back through mmap.
+
+	Little-endian throughout. All offsets are from the start of the file.
+
+	File header, 64 bytes:
+
+		 0  char[8]   magic "FETRAJ\0\1"
+		 8  uint32    version: 1 raw chunks, 2 compressed blocks
+		12  uint32    num_channels
+		16  uint64    num_samples
+		24  uint64    chunk_samples      samples per chunk
+		32  uint64    data_offset        first chunk; a multiple of 4096
+		40  float64   t0_s
+		48  float64   dt_s               0: times are stored in channel 0, "t_s"
+		56  uint64    v1: chunk_bytes    size of one chunk
+		              v2: index_offset   block index, see below
+
+	Channel table, 64 bytes per channel, right after the header:
+
+		 0  char[40]  name, NUL padded
+		40  char[12]  units, NUL padded
+		52  uint16    type: 1 float64, 2 float32
+		54  uint16    codec (0 in v1): 0 raw, 1 Gorilla, 2 QuantizedDelta
+		56  uint64    v1: column offset within a chunk; a multiple of 64
+		    float64   v2: max_error of QuantizedDelta
+
+	Version 1 data: ceil(num_samples / chunk_samples) chunks of chunk_bytes each. Within
+	a chunk every channel is one contiguous column of chunk_samples values,
+	starting on a 64-byte boundary. The last chunk is padded to full size.
+	A file written in one piece has one chunk, so every channel is a single
+	contiguous array; a streamed file holds one chunk of every channel in
+	memory while writing.
+
+	Version 2 is written when any channel has a codec (see trajectory_codec.h).
+	Each chunk of each channel is one block, encoded as the chunk is flushed,
+	and blocks follow each other from data_offset on 64-byte boundaries. Raw
+	blocks hold chunk_length values of the column type, unpadded. The block
+	index at index_offset, written on close, holds for every chunk c and
+	channel j (at [c * num_channels + j]) the uint64 offset and uint64 size of
+	the block. "t_s" is always raw so time(k) stays a lookup.
+
+	TrajectoryFileReader maps the file and hands out spans into the mapping,
+	so opening a multi-GB ensemble file and reading one channel only pages in
+	that channel's columns.
+*/
+
+enum class ColumnType : std::uint32_t
+{
+	Float64 = 1,
+	Float32 = 2
+};
+
+struct ChannelSpec
+{
+	std::string name;                    // at most 39 characters
+	std::string units;                   // at most 11 characters
+	ColumnType type = ColumnType::Float64;
+	ColumnCodec codec = ColumnCodec::None;  // compressed channels must be Float64
+	double max_error = 0.0;              // QuantizedDelta bound, in the channel's units
+};
+
+struct TrajectoryFileOptions
+{
+	double t0_s = 0.0;
+	double dt_s = 0.0;                   // fixed output step [s]; 0 stores each sample's time in a "t_s" channel
+	std::size_t chunk_samples = 65536;   // 0 buffers the whole run and writes a single chunk on close
+};
+
+// The 12 states of flat_earth_eom with their units, all of one column type
+std::vector<ChannelSpec> flat_earth_state_channels(ColumnType type = ColumnType::Float64);
+
+// Streams samples to a .fetraj file. It is an observer, so it can be handed
+// straight to integrate_observed(); the sample count is patched into the
+// header by close() (or the destructor).
+class TrajectoryFileWriter
+{
+public:
+	TrajectoryFileWriter(const std::string& path, const std::vector<ChannelSpec>& channels, const TrajectoryFileOptions& options = {});
+	~TrajectoryFileWriter();
+
+	TrajectoryFileWriter(const TrajectoryFileWriter&) = delete;
+	TrajectoryFileWriter& operator=(const TrajectoryFileWriter&) = delete;
+
+	// x holds one value per channel passed to the constructor
+	void operator()(double t, std::span<const double> x);
+
+	// Every row of a trajectory with num_states() == channels.size()
+	void write(const Trajectory& trajectory);
+
+	std::size_t samples_written() const { return num_samples; }
+
+	// Writes the buffered chunk and the final header; later writes throw
+	void close();
+
+private:
+	void write_header();
+	void write_chunk();
+	void write_block(std::size_t j, std::span<const double> values);
+
+	std::ofstream out;
+	std::string path;
+	std::vector<ChannelSpec> columns;    // as stored, "t_s" first when dt_s == 0
+	std::vector<std::uint64_t> column_offsets;
+	TrajectoryFileOptions options;
+	std::size_t chunk_samples;
+	std::uint64_t chunk_bytes = 0;
+	std::uint64_t data_offset = 0;
+	std::size_t num_samples = 0;
+	std::size_t num_written_chunks = 0;
+	std::vector<double> chunk;           // chunk[column * capacity + sample], capacity = chunk.size() / columns.size()
+	std::size_t chunk_fill = 0;
+	std::vector<std::byte> column_bytes;
+	bool compressed = false;             // version 2
+	std::uint64_t block_offset = 0;      // where the next v2 block goes
+	std::vector<std::uint64_t> block_index;
+	bool closed = false;
+};
+
+// Whole trajectory in one chunk, so each channel reads back as one span
+void write_trajectory_file(const std::string& path, const Trajectory& trajectory, const std::vector<ChannelSpec>& channels, double dt_s = 0.0);
+
+// Read-only view of a .fetraj file through a memory mapping
+class TrajectoryFileReader
+{
+public:
+	explicit TrajectoryFileReader(const std::string& path);
+	~TrajectoryFileReader();
+
+	TrajectoryFileReader(const TrajectoryFileReader&) = delete;
+	TrajectoryFileReader& operator=(const TrajectoryFileReader&) = delete;
+
+	std::size_t num_channels() const { return channels.size(); }
+	std::size_t num_samples() const { return samples; }
+	std::size_t chunk_samples() const { return samples_per_chunk; }
+	std::size_t num_chunks() const { return (samples + samples_per_chunk - 1) / samples_per_chunk; }
+	double t0_s() const { return t0; }
+	double dt_s() const { return dt; }
+
+	const ChannelSpec& channel_spec(std::size_t j) const { return channels.at(j); }
+
+	// Index of the channel called name; throws std::out_of_range if there is none
+	std::size_t find_channel(const std::string& name) const;
+
+	// Time of sample k [s]
+	double time(std::size_t k) const;
+
+	// Samples of channel j in chunk c, straight from the mapping. T must match
+	// the column type (double for Float64, float for Float32), and the channel
+	// must be stored raw.
+	template <class T>
+	std::span<const T> column(std::size_t j, std::size_t c = 0) const
+	{
+		static_assert(std::is_same_v<T, double> || std::is_same_v<T, float>, "columns are double or float");
+		if (channels.at(j).type != (std::is_same_v<T, double> ? ColumnType::Float64 : ColumnType::Float32))
+		{
+			throw std::invalid_argument("TrajectoryFileReader: column type does not match channel '" + channels[j].name + "'");
+		}
+		if (channels[j].codec != ColumnCodec::None)
+		{
+			throw std::invalid_argument("TrajectoryFileReader: channel '" + channels[j].name + "' is compressed; use decode_chunk() or read()");
+		}
+		return std::span<const T>(reinterpret_cast<const T*>(column_data(j, c)), chunk_length(c));
+	}
+
+	// A whole raw Float64 channel of a single-chunk file, without a copy
+	std::span<const double> channel(std::size_t j) const;
+
+	// Chunk c of channel j, decoded or widened to double; out.size() must be
+	// the chunk's length
+	void decode_chunk(std::size_t j, std::size_t c, std::span<double> out) const;
+
+	// Samples [first, first + out.size()) of channel j, widened to double and
+	// gathered across chunks; compressed chunks are decoded whole
+	void read(std::size_t j, std::size_t first, std::span<double> out) const;
+
+private:
+	void parse_header(const std::string& path);
+	void unmap();
+	std::span<const std::byte> block(std::size_t j, std::size_t c) const;
+	const std::byte* column_data(std::size_t j, std::size_t c) const;
+	std::size_t chunk_length(std::size_t c) const;
+
+	const std::byte* mapped = nullptr;
+	std::size_t mapped_size = 0;
+
+	std::vector<ChannelSpec> channels;
+	std::vector<std::uint64_t> column_offsets;
+	std::size_t samples = 0;
+	std::size_t samples_per_chunk = 1;
+	std::uint32_t version = 1;
+	std::uint64_t data_offset = 0;
+	std::uint64_t chunk_bytes = 0;
+	std::uint64_t index_offset = 0;
+	double t0 = 0.0;
+	double dt = 0.0;
+};
+
+#endif // TRAJECTORY_FILE_H
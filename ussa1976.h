@@ -3,6 +3,8 @@
 
 #include <unordered_map>
 #include <string>
+#include <cmath>
+#include "scalar_traits.h"
 
 // Constants
 const double R = 8.314462618;  // Universal gas constant (J/(mol*K))
@@ -13,7 +15,55 @@ const double P0 = 101325;      // Sea level standard pressure (Pa)
 const double L = 0.0065;       // Temperature lapse rate (K/m)
 const double R_specific = R / M; // Specific gas constant for dry air (J/(kg*K))
 
+// Properties needed by the equations of motion. Returned by value so the
+// EoM hot path does not allocate a map on every call. Generic over the scalar
+// type so float and Dual (sensitivity) kernels can evaluate it too.
+template <class T>
+struct BasicAtmosphereProperties {
+    T temperature;           // (K)
+    T pressure;              // (Pa)
+    T air_density;           // (kg/m^3)
+    T air_density_gradient;  // d(air_density)/d(altitude) (kg/m^4)
+    T speed_of_sound;        // (m/s)
+};
+
+using AtmosphereProperties = BasicAtmosphereProperties<double>;
+
 // Function Declaration
 std::unordered_map<std::string, double> computeProperties(double altitude);
 
+template <class T>
+BasicAtmosphereProperties<T> computeAtmosphere(T altitude) {
+    using S = scalar_t<T>;
+    using std::pow;
+    using std::exp;
+    using std::sqrt;
+
+    BasicAtmosphereProperties<T> atmosphere;
+
+    // Temperature and pressure based on altitude
+    if (altitude < S(11000)) { // Troposphere
+        atmosphere.temperature = S(T0) - S(L) * altitude;
+        atmosphere.pressure = S(P0) * pow((S(1) - S(L) * altitude / S(T0)), S(g / (R_specific * L)));
+    }
+    else { // Simplified for altitudes above 11 km
+        atmosphere.temperature = T(S(216.65));
+        atmosphere.pressure = S(P0) * exp(S(-g) * (altitude - S(11000)) / (S(R_specific) * atmosphere.temperature));
+    }
+
+    atmosphere.air_density = atmosphere.pressure / (S(R_specific) * atmosphere.temperature);
+
+    // rho ~ T^(g / (R L) - 1) in the troposphere, rho ~ exp(-g h / (R T)) above it
+    if (altitude < S(11000)) {
+        atmosphere.air_density_gradient = -atmosphere.air_density * S(g / (R_specific * L) - 1) * S(L) / atmosphere.temperature;
+    }
+    else {
+        atmosphere.air_density_gradient = -atmosphere.air_density * S(g) / (S(R_specific) * atmosphere.temperature);
+    }
+
+    atmosphere.speed_of_sound = sqrt(S(1.4 * R_specific) * atmosphere.temperature);
+
+    return atmosphere;
+}
+
 #endif // USSA1976_H
\ No newline at end of file
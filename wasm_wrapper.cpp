@@ -1,30 +1,67 @@
 #include <emscripten/bind.h>
+#include <emscripten/val.h>
+#include <array>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include <cmath>
+#include <span>
+#include <algorithm>
 
 #include "flat_earth_eom.h"
 #include "numerical_integration_methods.h"
+#include "integrator_observers.h"
 #include "ussa1976.h"
 #include "spheres.h"
 
 using namespace emscripten;
 
-// Store simulation results
-struct SimulationResult {
-    std::vector<double> time;
-    std::vector<double> x;
-    std::vector<double> y;
-    std::vector<double> z;
-    std::vector<double> roll;
-    std::vector<double> pitch;
-    std::vector<double> yaw;
-    std::vector<double> velocity;
-    std::vector<double> mach;
+// Exported result channels
+enum ResultChannel : std::size_t {
+    NORTH, ALTITUDE, EAST, ROLL, PITCH, YAW, VELOCITY, MACH,
+    RESULT_CHANNELS
 };
 
-SimulationResult g_result;
+// Store simulation results, one contiguous column per channel
+static Trajectory empty_result() {
+    return Trajectory(RESULT_CHANNELS, 0, TrajectoryLayout::ChannelMajor);
+}
+
+Trajectory g_result = empty_result();
+
+// Samples kept per run. Longer runs are decimated while they integrate, so
+// memory stays bounded however large duration / timeStep gets.
+// web/src/main.js plays back by sample index and estimates the bounce
+// velocity from getX(i) - getX(i - 10), both assuming one sample per
+// timeStep. Past MAX_RESULT_POINTS steps (duration / timeStep > 20000) the
+// playback runs faster and that estimate grows by the decimation factor;
+// use getTime(i) for the real spacing. The web defaults (120 s at 0.01 s)
+// stay below the cap.
+static constexpr std::size_t MAX_RESULT_POINTS = 20000;
+
+// Append one state at time t to g_result
+static void store_point(double t, StridedView<const double> x, double speed_of_sound) {
+    std::array<double, RESULT_CHANNELS> out;
+    out[NORTH] = x[9];
+    out[ALTITUDE] = -x[11];   // convert from down to up
+    out[EAST] = x[10];
+    out[ROLL] = x[6];         // phi
+    out[PITCH] = x[7];        // theta
+    out[YAW] = x[8];          // psi
+    out[VELOCITY] = std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+    out[MACH] = out[VELOCITY] / speed_of_sound;
+
+    g_result.append(t, out);
+}
+
+// Append every point of a trajectory to g_result
+static void store_results(const Trajectory& trajectory, double speed_of_sound) {
+    g_result.reserve(g_result.num_times() + trajectory.num_times());
+    for (std::size_t k = 0; k < trajectory.num_times(); ++k) {
+        store_point(trajectory.time(k), trajectory.row(k), speed_of_sound);
+    }
+}
 
 // Run the simulation and store results
 void runSimulation(
@@ -37,7 +74,7 @@ void runSimulation(
     double timeStep
 ) {
     // Clear previous results
-    g_result = SimulationResult();
+    g_result = empty_result();
 
     // Select vehicle
    std::unordered_map<std::string, double> amod = NASA_Atmos03_Brick();
@@ -50,24 +87,56 @@ void runSimulation(
         0.0, 0.0, -altitude   // position (NED, so altitude is negative)
     };
 
-    // Time vector
-    std::vector<double> t_s;
-    for (double t = 0; t <= duration; t += timeStep) {
-        t_s.push_back(t);
-    }
+    // Atmosphere
+    std::unordered_map<std::string, double> atmosphere = computeProperties(altitude);
+    std::unordered_map<std::string, double> airmod = {
+        {"alt_m", altitude},
+        {"rho_kgpm3", atmosphere.at("air_density")},
+        {"c_mps", atmosphere.at("speed_of_sound")},
+        {"g_mps2", 9.81}
+    };
 
-    std::size_t nt_s = t_s.size();
-    std::size_t nx0 = x0.size();
+    auto eom = [&](double t, std::span<const double> x, std::span<double> dx) {
+        std::vector<double> f_x = flat_earth_eom(t, std::vector<double>(x.begin(), x.end()), amod, airmod);
+        std::copy(f_x.begin(), f_x.end(), dx.begin());
+    };
 
-    // Preallocate solution array
-    std::vector<std::vector<double>> x(nx0, std::vector<double>(nt_s));
+    // Run integration, streaming every k-th step into g_result so at most
+    // MAX_RESULT_POINTS samples are stored
+    double speed_of_sound = atmosphere.at("speed_of_sound");
+    std::size_t num_steps = static_cast<std::size_t>(std::ceil(duration / timeStep));
+    std::size_t every = std::max<std::size_t>(1, (num_steps + MAX_RESULT_POINTS - 1) / MAX_RESULT_POINTS);
+    g_result.reserve(num_steps / every + 2);
+    ForwardEulerStepper stepper(eom, x0.size());
+    integrate_observed(stepper, 0.0, x0, duration, Decimator(every, [&](double t, std::span<const double> x) {
+        store_point(t, x, speed_of_sound);
+    }), timeStep);
+}
 
-    // Set initial conditions
-    for (std::size_t i = 0; i < nx0; ++i) {
-        x[i][0] = x0[i];
-    }
+// Same simulation, integrated with RK4 at timeStep but reported on the
+// playback clock: one sample every 1 / outputRate seconds, interpolated
+// within the steps (60 for 60 fps playback)
+void runSimulationSampled(
+    std::string vehicleType,
+    double altitude,
+    double u0, double v0, double w0,
+    double p0, double q0, double r0,
+    double phi0, double theta0, double psi0,
+    double duration,
+    double timeStep,
+    double outputRate
+) {
+    g_result = empty_result();
+
+    std::unordered_map<std::string, double> amod = NASA_Atmos03_Brick();
+
+    std::vector<double> x0 = {
+        u0, v0, w0,
+        p0, q0, r0,
+        phi0, theta0, psi0,
+        0.0, 0.0, -altitude
+    };
 
-    // Atmosphere
     std::unordered_map<std::string, double> atmosphere = computeProperties(altitude);
     std::unordered_map<std::string, double> airmod = {
         {"alt_m", altitude},
@@ -76,49 +145,51 @@ void runSimulation(
         {"g_mps2", 9.81}
     };
 
-    // Run integration
-    auto [ut_s, ux] = forward_euler(flat_earth_eom, t_s, x, timeStep, amod, airmod);
+    auto eom = [&](double t, std::span<const double> x, std::span<double> dx) {
+        std::vector<double> f_x = flat_earth_eom(t, std::vector<double>(x.begin(), x.end()), amod, airmod);
+        std::copy(f_x.begin(), f_x.end(), dx.begin());
+    };
 
-    // Store results
-    double speed_of_sound = atmosphere.at("speed_of_sound");
+    RK4Stepper stepper(eom, x0.size());
+    Trajectory trajectory = integrate_sampled(stepper, 0.0, x0, timeStep, sample_times(0.0, duration, outputRate));
 
-    for (std::size_t i = 0; i < nt_s; ++i) {
-        g_result.time.push_back(ut_s[i]);
-        g_result.x.push_back(ux[9][i]);       // North
-        g_result.y.push_back(-ux[11][i]);     // Altitude (convert from down to up)
-        g_result.z.push_back(ux[10][i]);      // East
-        g_result.roll.push_back(ux[6][i]);    // phi
-        g_result.pitch.push_back(ux[7][i]);   // theta
-        g_result.yaw.push_back(ux[8][i]);     // psi
-
-        double vel = std::sqrt(
-            ux[0][i] * ux[0][i] +
-            ux[1][i] * ux[1][i] +
-            ux[2][i] * ux[2][i]
-        );
-        g_result.velocity.push_back(vel);
-        g_result.mach.push_back(vel / speed_of_sound);
-    }
+    store_results(trajectory, atmosphere.at("speed_of_sound"));
 }
 
 // Accessor functions for JavaScript
 int getResultLength() {
-    return g_result.time.size();
+    return g_result.num_times();
 }
 
-double getTime(int i) { return g_result.time[i]; }
-double getX(int i) { return g_result.x[i]; }
-double getY(int i) { return g_result.y[i]; }
-double getZ(int i) { return g_result.z[i]; }
-double getRoll(int i) { return g_result.roll[i]; }
-double getPitch(int i) { return g_result.pitch[i]; }
-double getYaw(int i) { return g_result.yaw[i]; }
-double getVelocity(int i) { return g_result.velocity[i]; }
-double getMach(int i) { return g_result.mach[i]; }
+double getTime(int i) { return g_result.time(i); }
+double getX(int i) { return g_result(i, NORTH); }
+double getY(int i) { return g_result(i, ALTITUDE); }
+double getZ(int i) { return g_result(i, EAST); }
+double getRoll(int i) { return g_result(i, ROLL); }
+double getPitch(int i) { return g_result(i, PITCH); }
+double getYaw(int i) { return g_result(i, YAW); }
+double getVelocity(int i) { return g_result(i, VELOCITY); }
+double getMach(int i) { return g_result(i, MACH); }
+
+// Whole columns as Float64Array views of WASM memory, without a copy or a
+// call per sample. Channels: 0 North, 1 Altitude, 2 East, 3 Roll, 4 Pitch,
+// 5 Yaw, 6 Velocity, 7 Mach. A view is only valid until the next run.
+val getTimeView() {
+    return val(typed_memory_view(g_result.num_times(), g_result.times().data()));
+}
+
+val getChannelView(int channel) {
+    if (channel < 0 || channel >= static_cast<int>(RESULT_CHANNELS)) {
+        return val::undefined();
+    }
+    std::span<const double> column = std::as_const(g_result).channel(channel).span();
+    return val(typed_memory_view(column.size(), column.data()));
+}
 
 // Bind functions to JavaScript
 EMSCRIPTEN_BINDINGS(simulation_module) {
     function("runSimulation", &runSimulation);
+    function("runSimulationSampled", &runSimulationSampled);
     function("getResultLength", &getResultLength);
     function("getTime", &getTime);
     function("getX", &getX);
@@ -129,4 +200,6 @@ EMSCRIPTEN_BINDINGS(simulation_module) {
     function("getYaw", &getYaw);
     function("getVelocity", &getVelocity);
     function("getMach", &getMach);
+    function("getTimeView", &getTimeView);
+    function("getChannelView", &getChannelView);
 }
\ No newline at end of file